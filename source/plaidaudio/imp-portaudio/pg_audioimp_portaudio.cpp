@@ -3,8 +3,11 @@
 #include <iostream>
 #include <iomanip>
 #include <cstring>
+#include <cwctype>
 #include <fstream>
 #include <vector>
+#include <atomic>
+#include <algorithm>
 
 //#include <SDL/SDL.h>
 
@@ -30,14 +33,39 @@ static int MixAudio(const void *input, void *output,
 	PaStreamCallbackFlags statusFlags, void *userData);
 
 
+namespace
+{
+	/*
+		Automatic latency starts with buffers this small, and doubles them
+			whenever the device underruns, up to the limit.  Underruns
+			right after opening are ignored, as most devices glitch then.
+	*/
+	const unsigned long AUTO_FRAMES = 64, AUTO_FRAMES_MAX = 4096;
+	const double AUTO_SETTLE = 0.5;
+
+	//Case-insensitive search for part of a name.
+	bool Matches(const char *name, const plaidgadget::String &part)
+	{
+		std::wstring a, b;
+		for (const char *c = name; *c; ++c) a += wchar_t(std::towlower(*c));
+		for (size_t i = 0; i < part.size(); ++i)
+			b += wchar_t(std::towlower(part[i]));
+		return a.find(b) != std::wstring::npos;
+	}
+}
+
+
 namespace plaidgadget
 {
 	class AudioImp_PortAudio : public AudioImp
 	{
 	public:
 		AudioImp_PortAudio(Audio &audio, AudioScheduler &scheduler) :
-			AudioImp(audio, scheduler)
+			AudioImp(audio, scheduler), stream(NULL), underflows(0),
+			measured(0.0), callbackFrames(0), counted(0), opened(0.0)
 		{
+			const AudioSettings &settings = audio.settings();
+
 			//Initialize PortAudio
 			PaError err = Pa_Initialize();
 			if (err)
@@ -73,85 +101,66 @@ namespace plaidgadget
 				}
 			} describeAPI;
 
-			cout << "AVAILABLE AUDIO APIs: " << Pa_GetHostApiCount() << endl;
-			for (PaHostApiIndex i = 0, e = Pa_GetHostApiCount(); i != e; ++i)
+			if (settings.listDevices)
 			{
-				describeAPI(i);
+				cout << "AVAILABLE AUDIO APIs: " << Pa_GetHostApiCount() << endl;
+				for (PaHostApiIndex i = 0, e = Pa_GetHostApiCount(); i != e; ++i)
+				{
+					describeAPI(i);
+				}
+				cout << "-------------------------" << endl;
 			}
-			cout << "-------------------------" << endl;
 
 			//Get audio device
-			PaDeviceIndex inDev, outDev;
-			PaHostApiIndex api = -1;
-
-#if 0 //defined(_WIN32) || defined(WIN32)
-			//WASAPI
-			api = Pa_HostApiTypeIdToHostApiIndex(paASIO);
-			if (api >= 0)
+			PaHostApiIndex api = Pa_GetDefaultHostApi();
+			if (settings.api.size())
 			{
-				cout << "Using preferred API, ASIO..." << endl;
+				PaHostApiIndex i = 0, e = Pa_GetHostApiCount();
+				while (i != e && !Matches(Pa_GetHostApiInfo(i)->name, settings.api))
+					++i;
+				if (i != e) api = i;
+				else cout << "No audio API matches the one requested; "
+					"using the default." << endl;
+			}
 
-				const PaHostApiInfo *info = Pa_GetHostApiInfo(api);
-				inDev  = info->defaultInputDevice;
-				outDev = info->defaultOutputDevice;
+			const PaHostApiInfo *apiInfo = Pa_GetHostApiInfo(api);
+			inDev  = apiInfo ? apiInfo->defaultInputDevice : paNoDevice;
+			outDev = apiInfo ? apiInfo->defaultOutputDevice : paNoDevice;
 
-				if (!inDev || !outDev)
-				{
-					cout << "But no suitable pairing existed..." << endl;
-					api = -1;
-				}
-				else
+			if (settings.device.size() && apiInfo)
+			{
+				int i = 0, e = apiInfo->deviceCount;
+				for (; i != e; ++i)
 				{
-					output.rate = Pa_GetDeviceInfo(outDev)->defaultSampleRate;
-					output.channels = 2;
+					PaDeviceIndex did = Pa_HostApiDeviceIndexToDeviceIndex(api, i);
+					const PaDeviceInfo *dev = Pa_GetDeviceInfo(did);
+					if (dev->maxOutputChannels >= 2
+						&& Matches(dev->name, settings.device))
+					{
+						outDev = did;
+						break;
+					}
 				}
-
-				output.rate = 48000;
-				output.channels = 2;
+				if (i == e) cout << "No audio device matches the one requested; "
+					"using the default." << endl;
 			}
 
-#else
-			if (api < 0)
-			{
-				inDev  = Pa_GetDefaultInputDevice();
-				outDev = Pa_GetDefaultOutputDevice();
+			//Output format
+			output.rate = settings.rate ? settings.rate : 48000;
+			output.channels = 2;
 
-				//Output format
-				output.rate = 48000;
-				output.channels = 2;
-			}
-#endif
+			//Buffering
+			autoLatency = settings.autoLatency;
+			frameCount = settings.frames;
+			if (autoLatency && !frameCount) frameCount = AUTO_FRAMES;
+			suggested = settings.latency;
 
-		/*#ifdef _WIN32
-			{
-				int bestAPI = -1;
-				for (PaHostApiIndex i = 0, e = Pa_GetHostApiCount(); i!=e; ++i)
-				{
-					const PaHostApiInfo *info = Pa_GetHostApiInfo(i);
-				}
-			}
-		#else*/
-
-			//Open stream
-			PaStreamParameters
-				inParam = {inDev, 1, paInt16,
-					Pa_GetDeviceInfo(inDev)->defaultLowInputLatency, NULL},
-				outParam = {outDev, 2, paInt16|paNonInterleaved,
-					Pa_GetDeviceInfo(outDev)->defaultLowOutputLatency, NULL};
-			err = Pa_OpenStream(&stream, &inParam, &outParam, output.rate,
-				paFramesPerBufferUnspecified, paNoFlag, &MixAudio, (void*)this);
-			if (err)
-			{
-				cout << "Error initializing PortAudio: "
-					<< Pa_GetErrorText(err) << endl;
-			}
-		//#endif
+			openStream();
 		}
 		~AudioImp_PortAudio()
 		{
 			//Kill output stream
-			Pa_StopStream(stream);
-			Pa_CloseStream(stream);
+			closeStream();
 
 			//Close PortAudio
 			PaError err = Pa_Terminate();
@@ -165,22 +174,23 @@ namespace plaidgadget
 		virtual void startStream()
 		{
 			//Start audio pull thread
-			PaError err = Pa_StartStream(stream);
+			PaError err = stream ? Pa_StartStream(stream) : paBadStreamPtr;
 			if (err)
 			{
 				cout << "Error starting audio stream: "
 					<< Pa_GetErrorText(err) << endl;
 			}
+			opened = time();
 		}
 
 		virtual double time()
 		{
-			return Pa_GetStreamTime(stream);
+			return stream ? Pa_GetStreamTime(stream) : 0.0;
 		}
 
 		virtual float load()
 		{
-			return Pa_GetStreamCpuLoad(stream);
+			return stream ? Pa_GetStreamCpuLoad(stream) : 0.0f;
 		}
 
 		virtual AudioFormat format()
@@ -188,45 +198,169 @@ namespace plaidgadget
 			return output;
 		}
 
+		virtual Uint64 xruns()
+		{
+			return underflows.load(std::memory_order_relaxed);
+		}
+
+		virtual Uint32 frames()
+		{
+			return callbackFrames.load(std::memory_order_relaxed);
+		}
+
+		virtual double latency()
+		{
+			//Prefer what the callbacks see; some APIs leave timestamps at zero.
+			double m = measured.load(std::memory_order_relaxed);
+			if (m > 0.0 || !stream) return m;
+			const PaStreamInfo *info = Pa_GetStreamInfo(stream);
+			return info ? info->outputLatency : 0.0;
+		}
+
 		virtual void update()
 		{
-			//Nothin'
+			if (!autoLatency || !stream || frameCount >= AUTO_FRAMES_MAX) return;
+
+			//Grow the buffers if the device has underrun since it settled
+			Uint64 u = underflows.load(std::memory_order_relaxed);
+			if (u == counted) return;
+			counted = u;
+			if (time() - opened < AUTO_SETTLE) return;
+
+			frameCount *= 2;
+			cout << "Audio underrun; growing buffers to " << frameCount
+				<< " frames." << endl;
+			closeStream();
+			openStream();
+			startStream();
 		}
 
 
 		AudioFormat output;
 		PaStream *stream;
+		PaDeviceIndex inDev, outDev;
+
+		//Requested buffering; zeroes leave it to PortAudio
+		bool autoLatency;
+		unsigned long frameCount;
+		double suggested;
+
+		//Written by the callback
+		std::atomic<Uint64> underflows;
+		std::atomic<double> measured;
+		std::atomic<Uint32> callbackFrames;
+
+		//Automatic latency bookkeeping
+		Uint64 counted;
+		double opened;
+
+
+		void openStream()
+		{
+			if (outDev == paNoDevice)
+			{
+				cout << "No audio output device available." << endl;
+				return;
+			}
+
+			const PaDeviceInfo *out = Pa_GetDeviceInfo(outDev);
+			PaStreamParameters outParam = {outDev, 2, paInt16|paNonInterleaved,
+				suggested > 0.0 ? suggested : out->defaultLowOutputLatency, NULL};
+
+			//The microphone is optional
+			PaError err = paInvalidDevice;
+			if (inDev != paNoDevice)
+			{
+				PaStreamParameters inParam = {inDev, 1, paInt16,
+					Pa_GetDeviceInfo(inDev)->defaultLowInputLatency, NULL};
+				err = Pa_OpenStream(&stream, &inParam, &outParam, output.rate,
+					frameCount ? frameCount : paFramesPerBufferUnspecified,
+					paNoFlag, &MixAudio, (void*)this);
+			}
+			if (err)
+			{
+				err = Pa_OpenStream(&stream, NULL, &outParam, output.rate,
+					frameCount ? frameCount : paFramesPerBufferUnspecified,
+					paNoFlag, &MixAudio, (void*)this);
+			}
+			if (err)
+			{
+				cout << "Error initializing PortAudio: "
+					<< Pa_GetErrorText(err) << endl;
+				stream = NULL;
+				return;
+			}
+
+			const PaStreamInfo *info = Pa_GetStreamInfo(stream);
+			cout << "Audio: " << Pa_GetHostApiInfo(out->hostApi)->name
+				<< " `" << out->name << "', " << output.rate << " Hz, ";
+			if (frameCount) cout << frameCount << " frames, ";
+			cout << std::fixed << std::setprecision(1)
+				<< (info ? info->outputLatency*1000.0 : 0.0)
+				<< " ms latency" << std::defaultfloat << endl;
+		}
+
+		void closeStream()
+		{
+			if (!stream) return;
+			Pa_StopStream(stream);
+			Pa_CloseStream(stream);
+			stream = NULL;
+		}
 
 
 		void mix(const void *_mike, void *_speaker,
 			unsigned long frameCount, const PaStreamCallbackTimeInfo* timeInfo,
 			PaStreamCallbackFlags statusFlags)
 		{
+			//Device state
+			if (statusFlags & paOutputUnderflow)
+				underflows.fetch_add(1, std::memory_order_relaxed);
+			if (timeInfo->outputBufferDacTime > timeInfo->currentTime)
+				measured.store(timeInfo->outputBufferDacTime
+					- timeInfo->currentTime, std::memory_order_relaxed);
+			callbackFrames.store(Uint32(frameCount), std::memory_order_relaxed);
+
 			//Buffers
-			static Sint32 mbuff[24000],
-				obuff[48000], *ochan[4] = {obuff, obuff+24000, NULL, NULL};
+			const unsigned long MAX = AudioSettings::MAX_FRAMES;
+			static Sint32 mbuff[MAX],
+				obuff[2*MAX], *ochan[4] = {obuff, obuff+MAX, NULL, NULL};
 			Sint16 **speaker = (Sint16**) _speaker;
+			const Sint16 *mike = (const Sint16*) _mike;
 
-			//Mike data 32->24 conversion
-			Sint32 *pos = mbuff;
-			for (Sint16 *i=(Sint16*)_mike, *e=i+frameCount; i!=e; ++i)
-				*(pos++) = Sint32(*i << 8);
-
-			//Render audio
-			//std::cout << "Demand from scheduler: frames x " << frameCount << std::endl;
-			scheduler.render(ochan, mbuff, frameCount,
-				timeInfo->currentTime, timeInfo->outputBufferDacTime);
-			//std::cout << "Completed scheduler" << std::endl;
-
-			//Speaker data 24->16 conversion
-			Sint32 samp;
-			for (Uint32 c = 0; c < output.channels; ++c)
-				for (Sint16 *i = speaker[c], *e=i+frameCount; i!=e; ++i)
+			//Hosts may hand over more than the buffers hold; mix it in pieces.
+			for (unsigned long done = 0; done < frameCount;)
 			{
-				samp = (ochan[c][(i-speaker[c])]) >> 8;
-				if (samp > +32767) samp = +32767;
-				if (samp < -32767) samp = -32767;
-				*i = samp; // (intptr_t(i)&4)?30000:-30000;
+				unsigned long count = std::min(frameCount - done, MAX);
+				double offset = double(done) / output.rate;
+
+				//Mike data 32->24 conversion
+				Sint32 *pos = mbuff;
+				if (mike)
+				{
+					for (const Sint16 *i = mike+done, *e=i+count; i!=e; ++i)
+						*(pos++) = Sint32(*i << 8);
+				}
+				else std::memset((void*)mbuff, 0, 4*count);
+
+				//Render audio
+				scheduler.render(ochan, mbuff, count,
+					timeInfo->currentTime + offset,
+					timeInfo->outputBufferDacTime + offset,
+					done + count == frameCount);
+
+				//Speaker data 24->16 conversion
+				Sint32 samp;
+				for (Uint32 c = 0; c < output.channels; ++c)
+					for (Sint16 *i = speaker[c]+done, *e=i+count; i!=e; ++i)
+				{
+					samp = (ochan[c][(i-speaker[c]-done)]) >> 8;
+					if (samp > +32767) samp = +32767;
+					if (samp < -32767) samp = -32767;
+					*i = samp;
+				}
+
+				done += count;
 			}
 
 			/*if (Pa_GetStreamTime(stream) > criticalTime)
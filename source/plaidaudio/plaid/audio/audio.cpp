@@ -1,6 +1,8 @@
 #include <cassert>
 #include <ctime>
 #include <cstring>
+#include <atomic>
+#include <algorithm>
 
 #include "audio.h"
 #include "implementation.h"
@@ -246,23 +248,38 @@ private:
 class Audio::Scratch
 {
 public:
-	Scratch();
+	Scratch(Uint32 size);
 	~Scratch();
 
+	//Render thread: stack-style allocation within the current block
 	void alloc(Sint32 **ptr, Uint32 length, Uint32 channels);
 	void release(Sint32 **ptr);
 
-	typedef std::vector<Sint32> Buffer;
-	typedef std::map<Sint32*, Uint32> Allocs;
-	typedef Allocs::value_type Alloc;
+	//Render thread, between callbacks: adopt a bigger block if one's ready
+	void swap();
 
-	struct Back
+	//Main thread: provide a bigger block if an allocation was denied
+	void grow();
+
+	struct Block
 	{
-		Buffer buffer;
-		Allocs allocs;
-		Uint32 resize;
+		Block(Uint32 _size) : data(new Sint32[_size]), size(_size) {}
+		~Block() {delete[] data;}
+		Sint32 *data;
+		Uint32 size;
 	};
-	Back *back;
+
+	//Owned by the render thread
+	Block *block;
+	Uint32 top;
+
+	//Most ever in use, in samples
+	std::atomic<Uint32> peak;
+
+	//Handoff between threads
+	std::atomic<Uint32> wanted;
+	std::atomic<Block*> incoming, outgoing;
+	Uint32 offered;
 };
 
 
@@ -270,9 +287,13 @@ public:
 	Audio::Audio(const ModuleSet &modules, bool headless) :
 		Module(modules)
 #else
-	Audio::Audio(bool headless)
+	Audio::Audio(bool headless, const AudioSettings &settings) :
+		setup(settings)
 #endif //PLAIDGADGET
 {
+	//The backend mixes into buffers of a fixed size
+	setup.frames = std::min(setup.frames, Uint32(AudioSettings::MAX_FRAMES));
+
 	scheduler = new AudioScheduler(*this);
 
 	//headless = true;
@@ -292,8 +313,12 @@ public:
 	vol = 1.0f;
 	master->volume(1.0f);
 
-	//Create scratch buffer
-	scratch = new Scratch;
+	//Create scratch buffer, big enough for a few nested chunks of the
+	//	longest frame the scheduler will render.
+	{
+		AudioFormat format = imp->format();
+		scratch = new Scratch((format.rate/4) * format.channels * 8);
+	}
 
 	//Start the audio stream
 	imp->startStream();
@@ -318,6 +343,7 @@ void Audio::update()
 
 	scheduler->tick(imp->time());
 	imp->update();
+	scratch->grow();
 }
 
 Audio::~Audio()
@@ -332,6 +358,20 @@ float Audio::load()
 	return imp->load();
 }
 
+AudioStats Audio::stats()
+{
+	AudioStats stats;
+	scheduler->stats(stats);
+	stats.load = imp->load();
+	stats.voices = master->mixing();
+	stats.stalls = Prefetch::stalls();
+	stats.scratchPeak = scratch->peak.load(std::memory_order_relaxed) * 4;
+	stats.xruns = imp->xruns();
+	stats.frames = imp->frames();
+	stats.latency = imp->latency();
+	return stats;
+}
+
 #if PLAIDGADGET
 void Audio::handle(Command &command)
 {
@@ -439,6 +479,36 @@ void Audio::volume(Sound stream, float volume)
 {
 	master->volume(stream, volume);
 }
+void Audio::playAt(Sound stream, Uint64 time)
+{
+	master->playAt(stream, time);
+}
+void Audio::stopAt(Sound stream, Uint64 time)
+{
+	master->stopAt(stream, time);
+}
+
+Sound Audio::bus()
+{
+	return master->addBus();
+}
+void Audio::busReturn(Sound bus, Sound chain)
+{
+	master->returnBus(bus, chain);
+}
+void Audio::send(Sound stream, Sound bus, float level)
+{
+	master->send(stream, bus, level);
+}
+float Audio::send(Sound stream, Sound bus)
+{
+	return master->send(stream, bus);
+}
+
+Uint64 Audio::sampleClock()
+{
+	return scheduler->clock();
+}
 
 bool Audio::playing(Sound stream)
 {
@@ -483,18 +553,26 @@ float plaidgadget::ToSemitones(float mult)
 //------------------------------------------------------------------------
 
 /*
-	A very simple nonfragmenting allocator designed for stack-type allocations.
-
-	Used to get scratch space for audio processors.
+	A linear arena for stack-type allocations, used to get scratch space for
+		audio processors.  Chunks are released in reverse order of
+		allocation, so releasing one just rewinds the top to its start.
+
+	The render thread never allocates memory or blocks.  An allocation that
+		doesn't fit is denied and the size it needed is noted; the main
+		thread then makes a bigger block, which the render thread adopts at
+		the start of its next callback, when nothing is allocated.
 */
-Audio::Scratch::Scratch()
+Audio::Scratch::Scratch(Uint32 size) :
+	block(new Block(size)), top(0), peak(0), wanted(0),
+	incoming(NULL), outgoing(NULL), offered(size)
 {
-	back = NULL;
 }
 
 Audio::Scratch::~Scratch()
 {
-	if (back) delete back;
+	delete block;
+	delete incoming.load();
+	delete outgoing.load();
 }
 
 void Audio::Scratch::alloc(Sint32 **ptr, Uint32 length, Uint32 channels)
@@ -502,68 +580,65 @@ void Audio::Scratch::alloc(Sint32 **ptr, Uint32 length, Uint32 channels)
 	Uint32 size = length*channels;
 	if (!size) return;
 
-	//Possibly initialize
-	if (!back)
-	{
-		back = new Back();
-		back->buffer.resize(1024*128); //1 MB, about 2.7 seconds at stereo 48K
-		back->resize = 0;
-	}
-
-	//Find starting position, after most recent alloc
-	Uint32 start = 0, end;
-	if (back->allocs.size()) start = back->allocs.rbegin()->second;
-	end = start+size;
-
 	//Is there enough space?
-	if (end > back->buffer.size())
+	if (size > block->size - top)
 	{
-		std::cout << back->allocs.size()
-			<< " stacked allocs -- Expanding audio-scratch to "
-			<< ((end+1023)/1024) << " KB";
-
-		if (!start)
-		{
-			//Buffer is free; we can resize now
-			std::cout << " (immediate)" << std::endl;
-			back->buffer.resize(end);
-		}
-		else
-		{
-			//Unsafe to resize with buffer in use
-			std::cout << " (delayed)" << std::endl;
-			back->resize = std::max(back->resize, end);
-			return;
-		}
+		Uint32 want = top + size;
+		if (want > wanted.load(std::memory_order_relaxed))
+			wanted.store(want, std::memory_order_relaxed);
+		return;
 	}
 
 	//Allocate
 	for (Uint32 i = 0; i < channels; ++i)
-		ptr[i] = &back->buffer[start + i*length];
-	back->allocs.insert(Alloc(ptr[0], end));
+		ptr[i] = block->data + top + i*length;
+	top += size;
+	if (top > peak.load(std::memory_order_relaxed))
+		peak.store(top, std::memory_order_relaxed);
 }
 void Audio::Scratch::release(Sint32 **ptr)
 {
-	Allocs::iterator i = back->allocs.find(ptr[0]);
-	if (i == back->allocs.end())
+	top = Uint32(ptr[0] - block->data);
+}
+
+void Audio::Scratch::swap()
+{
+	if (top) return;
+
+	Block *b = incoming.exchange(NULL, std::memory_order_acquire);
+	if (b)
 	{
-		std::cout << "WARNING: NO SUCH ALLOC ON AUDIO SCRATCH" << std::endl;
-		return;
+		outgoing.store(block, std::memory_order_release);
+		block = b;
 	}
-	back->allocs.erase(i);
-	if (back->allocs.size() == 0 && back->resize)
+}
+
+void Audio::Scratch::grow()
+{
+	//Free the block the render thread let go of
+	Block *old = outgoing.exchange(NULL, std::memory_order_acquire);
+	if (old) delete old;
+	else if (outgoing.load(std::memory_order_relaxed)) return;
+
+	//Only one new block in flight at a time
+	Uint32 want = wanted.load(std::memory_order_relaxed);
+	if (want > offered && !incoming.load(std::memory_order_relaxed))
 	{
-		back->buffer.resize(back->resize);
-		back->resize = 0;
+		//Leave some headroom, so a slowly rising need doesn't reallocate
+		//	every frame.
+		offered = want + want/2;
+		incoming.store(new Block(offered), std::memory_order_release);
 	}
 }
 
 void Audio::alloc  (Sint32 **p, Uint32 s, Uint32 c)  {scratch->alloc(p,s,c);}
 void Audio::release(Sint32 **p)                      {scratch->release(p);}
+void Audio::swapScratch()                            {scratch->swap();}
 
 AudioChunk::AudioChunk(Audio &_audio, const AudioFormat &format,
-	Sint32 **data, Uint32 length, Uint64 frame, float a, float b) :
-	audio(_audio), _format(format), _frame(frame),
+	Sint32 **data, Uint32 length, Uint64 frame, float a, float b,
+	Uint64 time) :
+	audio(_audio), _format(format), _frame(frame), _time(time),
 	_a(a), _b(b), _length(length), _scratch(!data), _cutoff(0)
 {
 	//TODO move this check to AudioFormat
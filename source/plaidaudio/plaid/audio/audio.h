@@ -28,6 +28,53 @@ namespace plaidgadget
 	class AudioImp;
 	class Mixer;
 
+	/*
+		Requests for how the audio device should be opened.  Zeroes and empty
+			strings leave the choice to the backend, which may also ignore
+			anything it can't do.
+	*/
+	struct AudioSettings
+	{
+		//The most frames per callback the backend will mix at once.
+		enum {MAX_FRAMES = 24000};
+
+		AudioSettings() : rate(0), frames(0), latency(0.0),
+			autoLatency(false), listDevices(false) {}
+
+		Uint32 rate;        //Output sample rate
+		Uint32 frames;      //Frames per callback, up to MAX_FRAMES
+		double latency;     //Suggested output latency in seconds
+		String api;         //Host API, matched by part of its name
+		String device;      //Output device, matched by part of its name
+
+		//Start with small buffers and grow them whenever the device underruns.
+		bool autoLatency;
+
+		//Print every host API and device found while starting up.
+		bool listDevices;
+	};
+
+	/*
+		A snapshot of how rendering is going, from Audio::stats().
+
+		Callback times cover the callbacks since the previous call to stats();
+			everything else counts from startup or is current.
+	*/
+	struct AudioStats
+	{
+		float load;                 //CPU usage of the callback; 1.0 is 100%
+		Uint64 callbacks;           //Render callbacks so far
+		double minTime, avgTime, maxTime; //Callback duration in seconds
+		Uint64 underruns;           //Callbacks that ran out of queued frames
+		Uint64 overflows;           //Callbacks that shed samples to catch up
+		Uint32 voices;              //Sounds being mixed by the master mixer
+		Uint32 stalls;              //Prefetched streams that came up short
+		Uint32 scratchPeak;         //Most scratch space in use, in bytes
+		Uint64 xruns;               //Underruns reported by the device
+		Uint32 frames;              //Frames per callback; 0 if unknown
+		double latency;             //Output latency in seconds; 0 if unknown
+	};
+
 #if PLAIDGADGET
 	class File;
 #endif
@@ -49,7 +96,8 @@ namespace plaidgadget
         Audio(const ModuleSet &modules, bool headless = false);
 #else
 		//Standalone audio system
-		Audio(bool headless = false);
+		Audio(bool headless = false,
+			const AudioSettings &settings = AudioSettings());
 #endif
         virtual ~Audio();
 
@@ -69,6 +117,29 @@ namespace plaidgadget
         void stop   (Sound stream);
         void volume (Sound stream, float volume);
 
+		/*
+			Start or stop a sound at an exact sample of the clock.  Schedule
+				at least a frame and a buffer ahead; later is fine, and times
+				already past act as soon as possible.  See Mixer::playAt().
+		*/
+        void playAt (Sound stream, Uint64 time);
+        void stopAt (Sound stream, Uint64 time);
+
+		/*
+			Send buses on the master mixer; see Mixer::addBus().  bus() makes
+				one and returns its input, to build an effect chain on.
+		*/
+        Sound bus();
+        void  busReturn (Sound bus, Sound chain);
+        void  send      (Sound stream, Sound bus, float level);
+        float send      (Sound stream, Sound bus);
+
+		/*
+			Samples rendered so far, at the hardware rate.  Rendering runs
+				ahead of what's heard by the output latency.
+		*/
+        Uint64 sampleClock();
+
         //Check sound statuses
         bool  playing (Sound stream); //True if sound is playing (not paused)
         bool  has     (Sound stream); //True if sound is playing or paused
@@ -78,6 +149,12 @@ namespace plaidgadget
         //Get audio stream CPU load -- keep this well under 1.0!
         float load();
 
+		//Get render statistics; restarts the window for callback times.
+		AudioStats stats();
+
+		//The settings the audio system was started with.
+		const AudioSettings &settings() const    {return setup;}
+
 
         //Buffer a file or prep it for streaming.
 		//  (These return null sounds when loading fails)
@@ -109,13 +186,16 @@ namespace plaidgadget
 		AudioScheduler *scheduler;
 		Mixer *master;
 		float vol;
+		AudioSettings setup;
 
 		//Scratch buffer (used internally)
 		friend class AudioChunk;
+		friend class AudioScheduler;
 		class Scratch;
 		Scratch *scratch;
 		void alloc(Sint32 **, Uint32, Uint32);
 		void release(Sint32**);
+		void swapScratch();
     };
 }
 
@@ -14,13 +14,13 @@ using namespace std;
 Bandpass::Bandpass(Signal source, float low, float high) :
 	AudioEffect<Bandpass_Node>(source, Bandpass_Node(low, high))
 {
-	hpD = new float[source.format().channels];
-	lpP = new float[source.format().channels];
+	hpD = new float[source.format().channels]();
+	lpP = new float[source.format().channels]();
 }
 Bandpass::~Bandpass()
 {
-	delete hpD;
-	delete lpP;
+	delete[] hpD;
+	delete[] lpP;
 }
 
 
@@ -1,5 +1,7 @@
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
 
 #include "../effects.h"
 
@@ -50,11 +52,129 @@ static Bindings bindings(L"Audio_Pitch", pitchBindings);
 #endif
 
 
+namespace
+{
+	//Samples carried over between chunks; enough for the widest filter.
+	const Uint32 HISTORY = 2*Pitch::DELAY;
+
+	//Sinc filters are tabulated at this many positions between samples.
+	const Uint32 PHASES = 512;
+
+	/*
+		A polyphase table of Blackman-windowed sinc filters.  Row p holds the
+			taps for reading p/PHASES of the way past a sample, scaled to unit
+			gain.  The shorter filter has a gentler cutoff, so its wide
+			transition band still lands below Nyquist.
+	*/
+	template<Uint32 TAPS>
+	class SincTable
+	{
+	public:
+		SincTable()
+		{
+			const double cutoff = (TAPS < 32) ? .85 : .95;
+			for (Uint32 p = 0; p <= PHASES; ++p)
+			{
+				float *row = taps + p*TAPS;
+				double frac = double(p) / double(PHASES), sum = 0.0;
+				for (Uint32 t = 0; t < TAPS; ++t)
+				{
+					double x = double(t) - double(TAPS/2 - 1) - frac,
+						s = (x == 0.0) ? 1.0 :
+							std::sin(M_PI*cutoff*x) / (M_PI*cutoff*x),
+						w = .42 + .5*std::cos(2.0*M_PI*x/TAPS)
+							+ .08*std::cos(4.0*M_PI*x/TAPS);
+					row[t] = float(s*w);
+					sum += row[t];
+				}
+				for (Uint32 t = 0; t < TAPS; ++t) row[t] = float(row[t]/sum);
+			}
+		}
+
+		const float *row(float frac) const
+			{return taps + Uint32(frac*PHASES + .5f)*TAPS;}
+
+	private:
+		float taps[(PHASES+1)*TAPS];
+	};
+
+	//Built at startup so the render thread never waits on them.
+	const SincTable<8> sinc8;
+	const SincTable<32> sinc32;
+
+	/*
+		Resampling kernels.  Each reads around in[0] for a position frac
+			(0 to 1) of the way to in[1].
+	*/
+	struct Nearest
+	{
+		Sint32 operator()(const Sint32 *in, float frac) const
+			{return in[0];}
+	};
+
+	struct Linear
+	{
+		Sint32 operator()(const Sint32 *in, float frac) const
+			{return Sint32(in[0] + (in[1]-in[0])*frac);}
+	};
+
+	struct Hermite
+	{
+		Sint32 operator()(const Sint32 *in, float frac) const
+		{
+			//4-point, 3rd order hermite resampling
+			float c1 = .5f*(in[1]-in[-1]),
+				c2 = in[-1] - 2.5f*in[0] + 2.0f*in[1] - .5f*in[2],
+				c3 = .5f*(in[2]-in[-1]) + 1.5f*(in[0]-in[1]);
+			return Sint32(in[0] + ((c3*frac+c2)*frac+c1)*frac);
+		}
+	};
+
+	template<Uint32 TAPS>
+	struct Sinc
+	{
+		Sinc(const SincTable<TAPS> &_table) : table(_table) {}
+
+		Sint32 operator()(const Sint32 *in, float frac) const
+		{
+			//Four running sums, so the loop maps straight onto SIMD lanes.
+			const float *row = table.row(frac);
+			const Sint32 *src = in - (TAPS/2 - 1);
+			float acc[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+			for (Uint32 t = 0; t < TAPS; t += 4)
+				for (Uint32 k = 0; k < 4; ++k)
+					acc[k] += float(src[t+k]) * row[t+k];
+			return Sint32((acc[0]+acc[1]) + (acc[2]+acc[3]));
+		}
+
+		const SincTable<TAPS> &table;
+	};
+
+	/*
+		Render one channel.  The read position starts at 'pos' and advances
+			by 'rate' per output sample, with the rate ramping by 'step'.
+			Reads never go past in[last].
+	*/
+	template<typename Kernel>
+	void resample(const Kernel &kernel, const Sint32 *in, Uint32 last,
+		Sint32 *out, Uint32 length, double pos, double rate, double step)
+	{
+		for (Uint32 i = 0; i < length; ++i)
+		{
+			pos += rate; rate += step;
+			Uint32 base = std::min(Uint32(pos), last);
+			float frac = std::min(float(pos - base), 1.0f);
+			out[i] = kernel(in + base, frac);
+		}
+	}
+}
+
+
 Pitch::Pitch(Signal source, float rate, Uint32 alg) :
 	AudioEffect<Pitch_Node>(source, Pitch_Node(rate, alg))
 {
-	offset = 0.0f;
-	for (int i = 4*source.format().channels; i--;) mem.push_back(0);
+	offset = 0.0;
+	mem.assign(HISTORY*source.format().channels, 0);
 }
 Pitch::~Pitch()
 {
@@ -65,33 +185,25 @@ void Pitch::resampling(Uint32 alg)
 	settings.alg = alg;
 }
 
+void Pitch::reset()
+{
+	AudioEffect<Pitch_Node>::reset();
+	offset = 0.0;
+	mem.assign(HISTORY*source.format().channels, 0);
+}
+
 
 void Pitch::pull(AudioChunk &chunk, const Pitch_Node &a, const Pitch_Node &b)
 {
 	Uint32 length = chunk.length(), chan = source.format().channels;
 
-	/*{
-		static float sanity = 0.0f;
-		if (a.rate != sanity)
-			std::cout << "TIME BREAK " << sanity << " -> " << a.rate << std::endl;
-		sanity = b.rate;
-	}*/
-
-	//Compute rate and offset
-	float rate = a.rate, inc = std::pow(b.rate/a.rate, 1.0f/float(length));
-	float off = offset;
-
-	//"simulate" the render to figure out how many samples are needed.
-	Uint32 count = 0, steps;
-	for (Uint32 i = length; i--;)
-	{
-		off += rate; rate *= inc;
-		steps = off; off -= steps;
-		count += steps;
-	}
+	//The rate ramps linearly, so the samples consumed have a closed form.
+	double rate = a.rate, step = (double(b.rate) - rate) / double(length),
+		total = offset + rate*length + step*(double(length)*(length-1)/2.0);
+	Uint32 count = Uint32(std::max(total, 0.0));
 
 	//Allocate temp buffer from scratch pool; account for failure
-	AudioChunk sub(chunk.audio, source.format(), NULL, (4 + count),
+	AudioChunk sub(chunk.audio, source.format(), NULL, (HISTORY + count),
 		chunk.frame(), chunk.a(), chunk.b());
 	if (!sub.ok()) {chunk.silence(); return;}
 
@@ -99,60 +211,56 @@ void Pitch::pull(AudioChunk &chunk, const Pitch_Node &a, const Pitch_Node &b)
 	{
 		//Copy from memory to beginning of buffer
 		Sint32 *forward[PG_MAX_CHANNELS];
-		for (Uint32 i=0; i<chunk.format().channels; ++i)
+		for (Uint32 i=0; i<chan; ++i)
 		{
-			std::memcpy((void*) sub.start(i), (void*) &mem[4*i], 4*4);
-			forward[i]=sub.start(i)+4;
+			std::memcpy((void*) sub.start(i), (void*) &mem[HISTORY*i],
+				4*HISTORY);
+			forward[i]=sub.start(i)+HISTORY;
 		}
 
 		//Fill rest of buffer with new data from source stream
-		AudioChunk subsub(chunk.audio, chunk.format(), forward, sub.length()-4,
-			sub.frame(), sub.a(), sub.b());
+		AudioChunk subsub(chunk.audio, chunk.format(), forward,
+			sub.length()-HISTORY, sub.frame(), sub.a(), sub.b());
 		source.pull(subsub);
 
 		//Copy from end of buffer to memory
-		for (Uint32 i=0; i<chunk.format().channels; ++i)
+		for (Uint32 i=0; i<chan; ++i)
 		{
-			std::memcpy((void*) &mem[4*i], (void*) (sub.end(i)-4), 4*4);
+			std::memcpy((void*) &mem[HISTORY*i],
+				(void*) (sub.end(i)-HISTORY), 4*HISTORY);
 		}
 	}
 
-	//Resample
+	//Resample; reads are centered half a filter into the buffer
+	double pos = double(HISTORY/2 - 1) + offset;
+	Uint32 last = HISTORY/2 - 1 + count;
 	for (Uint32 i = 0; i < chan; ++i)
 	{
-		float c1, c2, c3;
-		rate = a.rate;
-		off = offset;
-		Sint32 *in = sub.start(i), *out = chunk.start(i), *end = chunk.end(i);
+		const Sint32 *in = sub.start(i);
+		Sint32 *out = chunk.start(i);
 
-		while (out < end)
+		switch (b.alg)
 		{
-			//4-point, 3rd order hermite resampling
-			off += rate; rate *= inc;
-			steps = off; off -= steps;
-			in += steps;
-
-			//*data++ = s0;
-
-			/*sampL = l1*off + l0*(1.0f-off);
-			sampR = r1*off + r0*(1.0f-off);
-			*data++ = Sint16(sampL + .5f - (sampL < 0.0f));
-			*data++ = Sint16(sampR + .5f - (sampR < 0.0f));*/
-
-			c1 = .5f*(in[2]-in[0]);
-			c2 = in[0] - 2.5f*in[1] + 2.0f*in[2] - .5f*in[3];
-			c3 = .5f*(in[3]-in[0]) + 1.5f*(in[1]-in[2]);
-			*out = in[1] + ((c3*off+c2)*off+c1)*off;
-
-			++out;
+		case NONE:
+			resample(Nearest(), in, last, out, length, pos, rate, step); break;
+		case LINEAR:
+			resample(Linear(), in, last, out, length, pos, rate, step); break;
+		case SINC_8:
+			resample(Sinc<8>(sinc8), in, last, out, length, pos, rate, step);
+			break;
+		case SINC_32:
+			resample(Sinc<32>(sinc32), in, last, out, length, pos, rate, step);
+			break;
+		default:
+			resample(Hermite(), in, last, out, length, pos, rate, step); break;
 		}
 	}
 
-	offset = off;
+	offset = total - count;
 }
 
 Pitch_Node Pitch::interpolate(const Pitch_Node &a, const Pitch_Node &b,
 	float mid)
 {
-	return Pitch_Node(a.rate*std::pow(b.rate/a.rate, mid), b.alg);
+	return Pitch_Node(a.rate + (b.rate-a.rate)*mid, b.alg);
 }
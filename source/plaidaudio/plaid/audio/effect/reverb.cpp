@@ -1,15 +1,31 @@
+#include <cmath>
+#include <algorithm>
+
 #include "../effects.h"
 
 
 using namespace plaidgadget;
 
 
-//TODO fix
+namespace
+{
+	//Total feedback gain is kept under this, so nothing rings forever.
+	const float MAX_FEEDBACK = .95f;
+
+	//Samples are stored in 32-bit integers.
+	const float SAMPLE_LIMIT = 2147483520.0f;
+}
 
 
 Reverb::Reverb(Signal source, float dry, float wet, float depth) :
-	AudioEffect<int>(source, 0)
+	AudioEffect<Reverb_Node>(source, Reverb_Node())
 {
+	//About a second of memory per channel, in a power-of-two ring
+	memorySize = 1;
+	while (memorySize < source.format().rate) memorySize *= 2;
+	memory.assign(memorySize * source.format().channels, 0.0f);
+	memoryPos = 0;
+
 	reverb(dry, wet, depth);
 }
 Reverb::~Reverb()
@@ -35,21 +51,13 @@ void Reverb::echo(float distance, float decay)
 	clearDelays();
 
 	addDelaySamples(0, 1.0f);
-	addDelaySeconds(distance/343.0f, decay);
+	addDelaySeconds(distance/343.0f,
+		std::min(std::max(decay, -MAX_FEEDBACK), MAX_FEEDBACK));
 }
 
 void Reverb::clearDelays()
 {
-	delays.clear();
-	echoes.clear();
-	delays.push_back(0);
-	echoes.push_back(0);
-
-	if (memory.size() < 32)
-	{
-		memoryPos = 0;
-		for (int i = 32; i--;) memory.push_back(0);
-	}
+	settings = Reverb_Node();
 }
 
 void Reverb::addDelaySeconds(float seconds, float amp)
@@ -58,84 +66,55 @@ void Reverb::addDelaySeconds(float seconds, float amp)
 	addDelaySamples(samples, amp);
 }
 
-void Reverb::addDelaySamples(Uint32 _samples, float amp)
+void Reverb::addDelaySamples(Uint32 samples, float amp)
 {
-	_samples *= 2;
-
-	Sint32 samples = _samples;
-
-	//Memory is power-of-two sized; make sure it's big enough.
-	while (memory.size() < _samples)
-		for (size_t i=0, s=memory.size(); i<s; ++i) memory.push_back(memory[i]);
+	//Delay line 0 is the dry signal
+	if (!samples) {settings.dry += amp; return;}
+	samples = std::min(samples, memorySize-1);
 
 	//Possibly this is an existing delay line
-	for (Uint32 i = 0; i < delays.size(); ++i)
-		if (delays[i] == samples)
+	for (Uint32 i = 0; i < settings.taps; ++i)
+		if (settings.delay[i] == samples)
 	{
-		echoes[i] = Sint32(echoes[i] + 32768.0f * amp);
+		settings.amp[i] += amp;
 		return;
 	}
 
-	//Otherwise add it
-	delays.push_back(samples);
-	echoes.push_back(Sint32(32768.0f * amp));
+	//Otherwise add it, if there's room
+	if (amp == 0.0f || settings.taps == Reverb_Node::TAPS) return;
+	settings.delay[settings.taps] = samples;
+	settings.amp[settings.taps] = amp;
+	++settings.taps;
 }
 
-void Reverb::pull(AudioChunk &chunk, const int &a, const int &b)
+void Reverb::pull(AudioChunk &chunk, const Reverb_Node &a, const Reverb_Node &b)
 {
 	//Pull source to destination buffer
 	source.pull(chunk);
 
-	//Sint32 *data = chunk.start(), *end = chunk.end();
-
-	return;
-
-	#if 0
+	Uint32 mask = memorySize-1, pos = memoryPos,
+		chans = std::min(chunk.channels(), Uint32(memory.size()/memorySize));
 
-	Sint32 memPos = memoryPos, memMask = memory.size()-1;
-	Sint16 *memBuff = &memory[0];
-	int curLine = 0, lines = delays.size();//lastLine = delays.size()-1;
-	//int advance;
-	Sint32 *echoBuff = &echoes[0], *delayBuff = &delays[0];
+	//Scale the taps down if they'd feed back more than they take in
+	float amp[Reverb_Node::TAPS], total = 0.0f;
+	for (Uint32 t = 0; t < b.taps; ++t) total += std::abs(b.amp[t]);
+	float scale = (total > MAX_FEEDBACK) ? MAX_FEEDBACK / total : 1.0f;
+	for (Uint32 t = 0; t < b.taps; ++t) amp[t] = b.amp[t] * scale;
 
-	//Sint16 raw, add;
-	Sint32 samp;
-
-	//This is actually a 2D loop, but it's tricky about that.
-	//  (Possible this optimization is completely ineffective, but it's fun)
-	while (data < end)
+	for (Uint32 c = 0; c < chans; ++c)
 	{
-		samp = 0;
-		for (curLine = 1; curLine < lines; ++curLine)
+		float *mem = &memory[c*memorySize];
+		pos = memoryPos;
+		for (Sint32 *data = chunk.start(c), *end = chunk.end(c); data != end; ++data)
 		{
-			samp += Sint32(memBuff[(memPos-delayBuff[curLine])&memMask])
-				* echoBuff[curLine];
+			float in = float(*data), wet = 0.0f;
+			for (Uint32 t = 0; t < b.taps; ++t)
+				wet += mem[(pos - b.delay[t]) & mask] * amp[t];
+			mem[pos] = in + wet;
+			float out = in * b.dry + wet;
+			*data = Sint32(std::min(std::max(out, -SAMPLE_LIMIT), SAMPLE_LIMIT));
+			pos = (pos + 1) & mask;
 		}
-		memBuff[memPos] = (samp + *data * 32768) >> 15;
-		*data = (samp + (*data * *echoBuff)) >> 15;
-		memPos = (memPos + 1) & memMask;
-		++data;
-
-		//
-		/*advance = (curLine==lastLine);
-
-		//Calculate this delay line
-		raw = memBuff[(memPos-delayBuff[curLine])&memMask];
-		add = (Sint32(raw) * echoBuff[curLine]) >> 15;
-
-		//Mix in delay line
-		*data += add;
-		memBuff[memPos] += add + (raw-add)*(!curLine);
-
-		//Advance
-		curLine = (curLine + 1) * !advance;
-			memPos = (memPos + advance) & memMask;
-			data += advance;
-			memBuff[memPos] *= !advance;
-			*data *= !advance;*/
 	}
-
-	memoryPos = memPos;
-
-	#endif
+	memoryPos = pos;
 }
@@ -21,13 +21,34 @@ namespace plaidgadget
 			this effect stream.  Each frame, the value of 'settings' will be
 			queued; it will be used as the 'b' value for that frame and the 'a'
 			value of the next, facilitating easy frame-to-frame interpolation.
+
+		Queued settings are tagged with their frame.  An effect that sits out
+			some frames (eg. waiting on a scheduled start) skips ahead to the
+			current ones instead of lagging behind, and one that starts partway
+			through a frame picks up its settings there.
 	*/
 	template<typename Settings>
 	class AudioEffect : public AudioStream
 	{
+	public:
+		/*
+			Reset and rebind let an effect be reused instead of rebuilt.
+				Reset throws away any settings queued up for the render
+				thread; rebind also swaps in a new source stream.
+
+			Only safe while nothing is pulling from the effect: before it's
+				played, or once its mixer has finished dropping it.
+		*/
+		virtual void reset()
+			{Settings t; while (queue.pull(t, ~Uint64(0))) {}
+			_a = _b = _m = settings;}
+		void rebind(Signal _source)
+			{source = _source; reset();}
+
 	protected:
 		AudioEffect(Signal _source, Settings defaults) :
-			source(_source), settings(defaults), _a(defaults), _b(defaults) {}
+			source(_source), settings(defaults),
+			_a(defaults), _b(defaults), _m(defaults), _frame(0) {}
 		virtual ~AudioEffect() {}
 
 		//Override these variants
@@ -41,14 +62,17 @@ namespace plaidgadget
 
 		//Tick and pull
 		virtual void pull(AudioChunk &chunk)
-			{if (chunk.first()) {_a = _b; if(!queue.pull(_b))
-				std::cout << "AUDIO EFFECT QUEUE STARVED" << std::endl;}
+			{if (chunk.frame() != _frame) {_frame = chunk.frame(); _a = _b;
+				Settings t; bool got = false;
+				while (queue.pull(t, _frame)) {_a = _b; _b = t; got = true;}
+				if (!got) std::cout << "AUDIO EFFECT QUEUE STARVED" << std::endl;
+				if (!chunk.first()) _m = interpolate(_a,_b,chunk.a());}
 			Settings pm = _m;
 			//std::cout << chunk.a() << "/" << chunk.b() << std::endl;
 			pull(chunk, chunk.extra() ? _b : (chunk.first() ? _a : pm),
 				chunk.last() ? _b : (_m = interpolate(_a,_b,chunk.b())));}
 		virtual void tick(Uint64 frame)
-			{source.tick(frame); queue.push(settings); effectTick(frame);}
+			{source.tick(frame); queue.push(settings, frame); effectTick(frame);}
 
 		//Base this stuff on the source stream, generally
 		virtual bool exhausted()        {return source.exhausted();}
@@ -61,8 +85,9 @@ namespace plaidgadget
 		Settings settings;
 
 	private:
-		LockFreeQueue<Settings> queue;
+		TimedEventQueue<Settings> queue;
 		Settings _a, _b, _m;
+		Uint64 _frame;
 	};
 
 
@@ -111,6 +136,10 @@ namespace plaidgadget
 
 		Frequency modulation can be constant, based on another
 
+		The rate ramps linearly across each chunk.  Output lags the source by
+			15 samples, the half-width of the widest filter, whichever
+			resampler is chosen; this keeps switching between them seamless.
+
 		WARNING:  Pitch takes in audio from the source stream at an altered
 			rate; thus, performance issues will arise from the use of very
 			high Pitches as large amounts of data are consumed, and certain
@@ -124,10 +153,15 @@ namespace plaidgadget
 			{
 			NONE=0, //Bottom-of-the-barrel
 			LINEAR=1, //Low-quality linear
-			HERMITE=2, HERMITE_43=2, //4-point 3rd order hermite.
-			//Coming: sinc interpolation
+			HERMITE=2, HERMITE_43=2, CUBIC=2, //4-point 3rd order hermite.
+			SINC_8=3, //8-tap windowed sinc; cleaner, about twice the cost
+			SINC_32=4, //32-tap windowed sinc; for when it really matters
 			};
 
+		//How many samples the output lags the source by; half the history
+		//  kept for the interpolation window.
+		static const Uint32 DELAY = 16;
+
 	public:
 		//Bind to signal
 		Pitch(Signal source, float rate=1.0f, Uint32 alg=HERMITE);
@@ -136,6 +170,9 @@ namespace plaidgadget
 		//Choose the resampling algorithm.  Default is HERMITE.
 		void resampling(Uint32 alg);
 
+		//Also forgets the samples kept over from the old source.
+		virtual void reset();
+
 		//Set and interpolate to the given pitch.  "Note" is in semitones.
 		void rate(float factor)   {settings.rate = std::max(factor,.0f);}
 		void note(float note)     {settings.rate = Semitones(note);}
@@ -153,7 +190,7 @@ namespace plaidgadget
 		virtual void effectTick(Uint64) {}
 
 	private:
-		float offset;
+		double offset;
 		std::vector<Sint32> mem;
 	};
 
@@ -204,11 +241,20 @@ namespace plaidgadget
 	};
 
 
+	class Reverb_Node {public: enum {TAPS = 8}; Reverb_Node() :
+		dry(0.0f), taps(0) {} float dry; Uint32 taps, delay[TAPS];
+		float amp[TAPS];};
 	/*
 		A simple but efficient and easily-customized delay line reverberator.
 			Also suffices for echoes; see the preset function.
+
+		Each delay line taps a memory of what went in plus what came back
+			out, so the sound keeps recirculating as it fades.  Delays are
+			capped at about a second and there can be up to eight of them.
+			If their amplitudes add up to more than .95 they're scaled down
+			to that, so the feedback always dies away.
 	*/
-	class Reverb : public AudioEffect<int>
+	class Reverb : public AudioEffect<Reverb_Node>
 	{
 	public:
 		//Bind to signal
@@ -243,17 +289,16 @@ namespace plaidgadget
 		void addDelaySamples(Uint32 samples, float amp);
 
 	protected:
-		virtual void pull(AudioChunk &chunk, const int &a, const int &b);
-		virtual int interpolate(const int &a, const int &b, float mid)
-			{return b;}
+		virtual void pull(AudioChunk &chunk,
+			const Reverb_Node &a, const Reverb_Node &b);
+		virtual Reverb_Node interpolate(
+			const Reverb_Node &a, const Reverb_Node &b, float mid) {return b;}
 
 		virtual void effectTick(Uint64) {}
 
 	private:
-		std::vector<Sint32> delays;
-		std::vector<Sint32> echoes;
-		std::vector<Sint16> memory;
-		Sint32 memoryPos;
+		std::vector<float> memory;
+		Uint32 memorySize, memoryPos;
 	};
 
 
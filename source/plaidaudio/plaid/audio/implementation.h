@@ -27,11 +27,15 @@ namespace plaidgadget
 			'time' should correspond to AudioImp::time().
 			'capTime' should suggest the 'latest' time the callback should exit.
 
+			A device callback may be rendered in several pieces; pass 'last'
+				false for all but the final one, so stats() counts and times
+				the callback once.
+
 			This HAS to be called to avert a pileup of audio data; in the case
 				of dummy behavior ask for zero bytes in AudioImp::update().
 		*/
 		void render(Sint32 **speaker, const Sint32 *mic, Uint32 moments,
-			double time, double capTime);
+			double time, double capTime, bool last = true);
 
 	private:
 		friend class Audio;
@@ -40,6 +44,8 @@ namespace plaidgadget
 		void tick(double time);
 		void setupFront(AudioFormat format, double time);
 		void setupBack(double time);
+		void stats(AudioStats &stats);
+		Uint64 clock();
 
 		Sound microphone();
 
@@ -51,8 +57,10 @@ namespace plaidgadget
 
 		struct Front;
 		struct Back;
+		struct Telemetry;
 		Front *front;
 		Back  *back;
+		Telemetry *telemetry;
 	};
 
 
@@ -81,6 +89,12 @@ namespace plaidgadget
 		//Return the CPU usage of the audio callback, where 1.0 is 100%.
 		virtual float load() = 0;
 
+		//Optionally report device underruns, the frames per callback and the
+		//  output latency in seconds, as measured by the device.
+		virtual Uint64 xruns()    {return 0;}
+		virtual Uint32 frames()   {return 0;}
+		virtual double latency()  {return 0.0;}
+
 		//Return the format for input and output.
 		virtual AudioFormat format() = 0;
 
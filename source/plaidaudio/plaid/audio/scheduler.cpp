@@ -1,9 +1,10 @@
-#include <iomanip>
 #include <cstring>
 #include <fstream>
 #include <vector>
 #include <deque>
-#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <limits>
 
 #include "audio.h"
 #include "implementation.h"
@@ -37,10 +38,6 @@ namespace plaidgadget
 
 	struct AudioScheduler::Back
 	{
-		//Queues from the audio mixer back to the game thread (shared)
-		struct MixReport {char rep[120];};
-		LockFreeQueue<MixReport> feedback;
-
 		//Frame timing
 		std::deque<double> queued;
 		Uint64 mixFrame, ackFrame;
@@ -48,6 +45,9 @@ namespace plaidgadget
 		Uint64 sampleCount;
 		Uint64 overflow;
 
+		//Samples rendered so far; see Audio::sampleClock()
+		Uint64 clock;
+
 		//Frame splitting
 		Uint32 frameSamples, leftover;
 		float frameCut;
@@ -63,6 +63,47 @@ namespace plaidgadget
 	};
 
 
+	/*
+		Counters written by the render thread once per callback and read by
+			the game thread, without locks.  The callback-time window is
+			restarted by whoever reads it.
+	*/
+	struct AudioScheduler::Telemetry
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		Telemetry() : clock(0), callbacks(0), underruns(0), overflows(0),
+			windowCount(0), windowTotal(0),
+			windowMin(std::numeric_limits<Uint64>::max()), windowMax(0),
+			open(false), openUnderrun(false), openOverflow(false) {}
+
+		void publish(Uint64 nanos, bool underrun, bool overflow)
+		{
+			callbacks.fetch_add(1, std::memory_order_relaxed);
+			if (underrun) underruns.fetch_add(1, std::memory_order_relaxed);
+			if (overflow) overflows.fetch_add(1, std::memory_order_relaxed);
+
+			windowCount.fetch_add(1, std::memory_order_relaxed);
+			windowTotal.fetch_add(nanos, std::memory_order_relaxed);
+			Uint64 m = windowMin.load(std::memory_order_relaxed);
+			while (nanos < m && !windowMin.compare_exchange_weak(m, nanos,
+				std::memory_order_relaxed)) {}
+			m = windowMax.load(std::memory_order_relaxed);
+			while (nanos > m && !windowMax.compare_exchange_weak(m, nanos,
+				std::memory_order_relaxed)) {}
+		}
+
+		std::atomic<Uint64> clock;
+		std::atomic<Uint64> callbacks, underruns, overflows;
+		std::atomic<Uint64> windowCount, windowTotal, windowMin, windowMax;
+
+		//Render thread only: a callback rendered in several pieces is
+		//	published as one, timed from the start of its first piece.
+		bool open, openUnderrun, openOverflow;
+		Clock::time_point openStarted;
+	};
+
+
 	class MikeStream : public AudioStream
 	{
 	public:
@@ -126,6 +167,7 @@ AudioScheduler::AudioScheduler(Audio &_audio) :
 	front = NULL;
 	back = NULL;
 	master = NULL;
+	telemetry = new Telemetry;
 }
 
 AudioScheduler::~AudioScheduler()
@@ -136,6 +178,7 @@ AudioScheduler::~AudioScheduler()
 
 	delete front;
 	delete back;
+	delete telemetry;
 }
 
 void AudioScheduler::setupFront(AudioFormat _format, double time)
@@ -166,6 +209,7 @@ void AudioScheduler::setupBack(double time)
 	back->mixFrame = back->ackFrame = 0;
 	back->sampleCount = 0;
 	back->overflow = 0;
+	back->clock = 0;
 	back->frameSamples = back->leftover = 0;
 	back->frameCut = 0.0f;
 
@@ -194,23 +238,10 @@ void AudioScheduler::tick(double time)
 	++front->prepFrame;
 	signal.tick(front->prepFrame);
 	front->frames.push(time);
-
-	//Feedback from mixer
-	if (back)
-	{
-		Back::MixReport rep;
-		while (back->feedback.pull(rep))
-		{
-#if PLAIDGADGET
-			if (audio.console.monitoring())
-				std::cout << "audio: " << rep.rep << std::endl;
-#endif // PLAIDGADGET
-		}
-	}
 }
 
 void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
-	Uint32 moments, double time, double capTime)
+	Uint32 moments, double time, double capTime, bool last)
 {
 	//Debug tone (highlights underflows)
 	/*{
@@ -222,12 +253,23 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 	}*/
 
 
+	if (!telemetry->open)
+	{
+		telemetry->open = true;
+		telemetry->openUnderrun = telemetry->openOverflow = false;
+		telemetry->openStarted = Telemetry::Clock::now();
+	}
+	bool underrun = false, overflow = false;
+
 	//Possibly setup backend data
 	if (!back)
 	{
 		setupBack(time);
 	}
 
+	//Nothing is using scratch space between callbacks, so it can grow now
+	audio.swapScratch();
+
 
 	//Microphone stuff
 	back->mikeData = microphone;
@@ -244,11 +286,6 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 		pos[i] = speaker[i];
 	}
 
-	//A little output
-	std::stringstream mixReport;
-	mixReport << std::setw(5) << require << ' ';
-
-
 	//Main rendering loop
 	while (require)
 	{
@@ -299,6 +336,7 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 			//Overflow countermeasure
 			if (back->overflow)
 			{
+				overflow = true;
 				int reduc = std::min(
 					int(back->frameSamples-1), //Very aggressive
 					int(back->overflow));
@@ -317,7 +355,6 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 		if (length > require)
 		{
 			//We can't fit this whole frame in...
-			mixReport << (back->leftover?'-':'[');
 			back->leftover = length - require;
 			b = back->frameCut = 1.0f-back->leftover/float(back->frameSamples);
 			length = require;
@@ -325,7 +362,6 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 		else
 		{
 			//Smooth sailing.
-			mixReport << (back->leftover?']':'#');
 			b = 1.0f;
 			back->leftover = 0;
 		}
@@ -334,25 +370,25 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 		if (length)
 		{
 			AudioChunk chunk(audio, format, pos, length,
-				back->mixFrame, a, b);
+				back->mixFrame, a, b, back->clock);
 			signal.pull(chunk);
 			//chunk.silence();
 			for (unsigned i = 0; i < format.channels; ++i) pos[i] += length;
 			require -= length;
+			back->clock += length;
 		}
 	}
 
 	if (require)
 	{
-		//EXTRA RENDARR
-		mixReport << "+" << require;
-		if (back->leftover) std::cout <<
-			"FRAME LEFTOVER DETECTED DURING EXTRA-MIX" << std::endl;
+		//EXTRA RENDARR; the game thread hasn't queued enough frames
+		underrun = true;
 		AudioChunk chunk(audio, format, pos, require,
-			back->mixFrame, 1.0f, 1.0f);
+			back->mixFrame, 1.0f, 1.0f, back->clock);
 		signal.pull(chunk);
 		//chunk.silence();
 		for (unsigned i = 0; i < format.channels; ++i) pos[i] += require;
+		back->clock += require;
 	}
 
 	//Gather up extra frames
@@ -361,20 +397,10 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 		while (front->frames.pull(hold)) back->queued.push_back(hold);
 	}
 
-	mixReport << " // ";
-
 	//Calculate overflow (tolerance of one frame-length)
 	if (back->queued.size() > 1)
 	{
 		back->overflow = format.rate*(*(back->queued.end()-2)-back->lastFrame);
-		mixReport << " -" << std::setw(5) << back->overflow;
-	}
-	/*mixReport << " LATENCY > " << fixed << setprecision(2)
-		<< (capTime-back->lastFrame);*/
-	if (back->queued.size())
-	{
-		double waste = back->queued.back()-back->lastFrame;
-		mixReport << ", WASTE = " << waste;
 	}
 
 
@@ -389,9 +415,36 @@ void AudioScheduler::render(Sint32 **speaker, const Sint32 *microphone,
 	if (obFill != obSize) mixReport << " (INCOMPLETE RENDER)";*/
 
 
-	//Compose report and send back
-	std::string s = mixReport.str();
-	Back::MixReport rep;
-	std::memcpy(rep.rep, s.c_str(), std::min(s.length()+1,size_t(120)));
-	back->feedback.push(rep);
+	//Publish timing, once the whole callback is done
+	telemetry->clock.store(back->clock, std::memory_order_relaxed);
+	telemetry->openUnderrun = telemetry->openUnderrun || underrun;
+	telemetry->openOverflow = telemetry->openOverflow || overflow;
+	if (last)
+	{
+		telemetry->publish(Uint64(std::chrono::duration_cast<
+			std::chrono::nanoseconds>(Telemetry::Clock::now()
+				- telemetry->openStarted).count()),
+			telemetry->openUnderrun, telemetry->openOverflow);
+		telemetry->open = false;
+	}
+}
+
+Uint64 AudioScheduler::clock()
+{
+	return telemetry->clock.load(std::memory_order_relaxed);
+}
+
+void AudioScheduler::stats(AudioStats &stats)
+{
+	Uint64 count = telemetry->windowCount.exchange(0),
+		total = telemetry->windowTotal.exchange(0),
+		low = telemetry->windowMin.exchange(std::numeric_limits<Uint64>::max()),
+		high = telemetry->windowMax.exchange(0);
+
+	stats.callbacks = telemetry->callbacks.load();
+	stats.underruns = telemetry->underruns.load();
+	stats.overflows = telemetry->overflows.load();
+	stats.minTime = count ? low * 1e-9 : 0.0;
+	stats.avgTime = count ? (total * 1e-9) / count : 0.0;
+	stats.maxTime = high * 1e-9;
 }
@@ -92,16 +92,9 @@ void Signal::bind(Ref<AudioStream> stream, AudioFormat form,
 		data = new Data;
 		data->stream = stream;
 
-		//Attach transcoder
+		//Attach transcoder; it resamples as well
 		subsig = new Transcoder(subsig, form);
 
-		//Resample?
-		if (form.rate != src.rate)
-		{
-			//std::cout << " with pitch shift";
-			subsig = new Pitch(subsig, float(src.rate)/float(form.rate));
-		}
-
 		data->trans = new Signal(subsig);
 		//std::cout << std::endl;
 	}
@@ -93,6 +93,10 @@ namespace plaidgadget
 		Note that constructs are also planned which will facilitate timelines
 			separate from engine framerate, such as musical tempos.  These can
 			have arbitrarily large or small frame lengths and request sizes!
+
+		'time' is the sample clock at the start of the chunk; see
+			Audio::sampleClock().  Only chunks pulled straight from the
+			scheduler or a Mixer carry it; anything else gets 0.
 	*/
 	class AudioChunk
 	{
@@ -104,15 +108,19 @@ namespace plaidgadget
 				(usually what you want for mixers/effects)
 
 				*** NOTE ***
-				The scratch pool can't be resized while it's in use.
+				The scratch pool only grows between render callbacks.
 				Thus, it's possible for an allocation to be denied.
 				This will produce a NULL-data, 0-length chunk.
 				Account for this in your code!
+
+				Scratch chunks must be destroyed in reverse order of
+				creation, which locals in a pull() are anyway.
 		*/
 		AudioChunk(Audio &audio,
 			const AudioFormat &format,       //Formatting
 			Sint32 **data, Uint32 length,    //Buffer
-			Uint64 frame, float a, float b); //Timing parameters
+			Uint64 frame, float a, float b,  //Timing parameters
+			Uint64 time = 0);                //Sample clock
 
 		~AudioChunk();
 
@@ -141,6 +149,9 @@ namespace plaidgadget
 		//Frame ID
 		Uint64 frame()              {return _frame;}
 
+		//Sample clock at the start of this chunk, or 0 if unknown
+		Uint64 time()               {return _time;}
+
 
 		/*
 			Get the 'A' and 'B' values for this chunk.  They range from 0 to 1
@@ -199,7 +210,7 @@ namespace plaidgadget
 	private:
 		//Metadata
 		AudioFormat _format;
-		Uint64 _frame;
+		Uint64 _frame, _time;
 		float _a, _b;
 		bool _scratch;
 		Uint32 _cutoff;
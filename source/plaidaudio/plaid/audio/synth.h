@@ -21,13 +21,14 @@ namespace plaidgadget
 			this effect stream.  Each frame, the value of 'settings' will be
 			queued; it will be used as the 'b' value for that frame and the 'a'
 			value of the next, facilitating easy frame-to-frame interpolation.
+			Like AudioEffect's settings, states are tagged with their frame.
 	*/
 	template<typename State>
 	class AudioSynth : public AudioStream
 	{
 	protected:
 		AudioSynth(AudioFormat f, State s) :
-			output(f), state(s), _a(s), _b(s) {}
+			output(f), state(s), _a(s), _b(s), _m(s), _frame(0) {}
 		virtual ~AudioSynth() {}
 
 		//Override these variants
@@ -39,12 +40,16 @@ namespace plaidgadget
 
 		//Tick and pull
 		virtual void pull(AudioChunk &chunk)
-			{if (chunk.first()) {_a = _b; if(!queue.pull(_b))
-				std::cout << "SYNTH QUEUE STARVED" << std::endl;}
+			{if (chunk.frame() != _frame) {_frame = chunk.frame(); _a = _b;
+				State t; bool got = false;
+				while (queue.pull(t, _frame)) {_a = _b; _b = t; got = true;}
+				if (!got) std::cout << "SYNTH QUEUE STARVED" << std::endl;
+				if (!chunk.first()) _m = interpolate(_a,_b,chunk.a());}
 			State pm = _m;
 			pull(chunk, chunk.first() ? _a : pm,
 				chunk.last() ? _b : (_m = interpolate(_a,_b,chunk.b())));}
-		virtual void tick(Uint64 frame) {queue.push(state);synthTick(frame);}
+		virtual void tick(Uint64 frame)
+			{queue.push(state, frame); synthTick(frame);}
 
 		//Base this stuff on the source stream, generally
 		virtual bool exhausted()        {return false;}
@@ -57,8 +62,9 @@ namespace plaidgadget
 		State state;
 
 	private:
-		LockFreeQueue<State> queue;
+		TimedEventQueue<State> queue;
 		State _a, _b, _m;
+		Uint64 _frame;
 	};
 
 	/*
@@ -4,6 +4,7 @@
 
 #include "../thread/lockfree.h"
 #include <map>
+#include <atomic>
 #include <vector>
 
 #include "audio.h"
@@ -26,6 +27,8 @@ namespace plaidgadget
 		Sounds:
 			Can be volume-controlled, muted or paused.
 			Can be paused individually.
+			Can be started and stopped at an exact sample.
+			Can send some of their output to buses.
 			Are automatically dropped when they exhaust.  (When they finish)
 	*/
 	class Mixer : public AudioStream
@@ -52,6 +55,39 @@ namespace plaidgadget
 		void pause(Sound sound);
 		void volume(Sound sound, float volume);
 
+		/*
+			Start or stop a sound at a sample on the clock its chunks carry
+				(see Audio::sampleClock()); the mix is split there.  Times
+				already past take effect at the start of the next chunk.
+
+			Scheduling again replaces the earlier time.  play() or pause()
+				cancel a scheduled start, and dropping a sound cancels both.
+				The sound counts as playing from when playAt() is called.
+
+			Up to MAX_SCHEDULED actions can wait at once, so the render
+				thread never allocates; any more are ignored.
+		*/
+		void playAt(Sound sound, Uint64 time);
+		void stopAt(Sound sound, Uint64 time);
+
+		/*
+			Send buses let many sounds share one effect chain.
+
+			addBus() gives back the bus's input, a stream of everything sent
+				to it; build an effect chain on it and pass the end of the chain
+				to returnBus().  The return plays on this mixer like any other
+				sound, but is mixed after the sounds that feed it.  Sends are
+				taken after each sound's own volume, and returns can't send.
+
+			addBus() returns a null Sound once there are MAX_BUSES.
+		*/
+		static const Uint32 MAX_BUSES = 8;
+		static const Uint32 MAX_SCHEDULED = 256;
+		Sound addBus();
+		void returnBus(Sound input, Sound chain);
+		void send(Sound sound, Sound input, float level);
+		float send(Sound sound, Sound input);
+
 		/*
 			Query sound settings.
 			Note that dropped sounds will often not appear as such until after
@@ -61,6 +97,9 @@ namespace plaidgadget
 		bool playing(Sound sound);
 		float volume(Sound sound);
 
+		//How many sounds the render thread mixed last time; safe anywhere.
+		Uint32 mixing() const   {return mixed.load(std::memory_order_relaxed);}
+
 		//Check if mixer is clipping
 		//bool clipping(bool reset = false);
 
@@ -72,14 +111,23 @@ namespace plaidgadget
 		virtual void tick(Uint64 frame);
 
 	private:
+		class Bus;
+
 		Signal *findOrAdd(Sound sound);
+		Sint32 findBus(Sound input);
+
+		//Render-side helpers
+		void mix(AudioChunk &chunk);
 
 	private:
 		class Channel
 		{
 		public:
-			Channel() : play(false), drop(false), volume(1.0f) {}
+			Channel() : play(false), drop(false), volume(1.0f), bus(-1)
+				{for (Uint32 i = 0; i < MAX_BUSES; ++i) sends[i] = 0.0f;}
 			bool play, drop; float volume;
+			float sends[MAX_BUSES];
+			Sint32 bus; //Which bus this returns, if any
 		};
 
 		typedef std::map<Sound, Signal> Signals;
@@ -89,17 +137,24 @@ namespace plaidgadget
 		typedef std::pair<Signal*, Channel> ChannelsEntry;
 
 		enum ACTIONS {NONE=0,
-			GPLAY=1, GVOLUME=2, ADD=3, DROP=4, PLAY=5, VOLUME=6};
+			GPLAY=1, GVOLUME=2, ADD=3, DROP=4, PLAY=5, VOLUME=6,
+			SEND=7, RETURN=8};
 		struct Action
 		{
 			Uint32 code;
 			Signal *signal;
 			float value;
+			Uint64 time; //Sample to act on, or 0 for the start of the frame
+			Uint32 bus;  //For SEND and RETURN
 
-			Action(Uint32 _c=0, Signal *_s=NULL, float _v=0.0f) :
-				code(_c), signal(_s), value(_v) {}
+			Action(Uint32 _c=0, Signal *_s=NULL, float _v=0.0f, Uint64 _t=0) :
+				code(_c), signal(_s), value(_v), time(_t), bus(0) {}
 		};
 
+		void apply(const Action &action);
+		void schedule(const Action &action);
+		void cancel(Signal *signal, Uint32 code = NONE);
+
 	private:
 		//Static settings
 		AudioFormat output;
@@ -110,12 +165,25 @@ namespace plaidgadget
 		float extPlay; float extVolume;
 		Channels external;
 		TimedEventQueue<Action> actions;
+
+		//Bus inputs; each is set before any action refers to it
+		std::vector<Sound> busInputs;
+		Bus *buses[MAX_BUSES];
 		//bool clipped;
 
 		//Mixer-side data
 		bool intPlay; float intVolume;
 		Channels internal;
 		LockFreeQueue<Signal*> drops;
+
+		//Scheduled actions, latest first; never grown past MAX_SCHEDULED
+		std::vector<Action> pending;
+
+		//How many bus slots the sends need
+		Uint32 intBuses;
+
+		//Published for mixing()
+		std::atomic<Uint32> mixed;
 	};
 
 	/*
@@ -199,12 +267,11 @@ namespace plaidgadget
 	/*
 		A transcoder.  Used to change audio from one sample format to another.
 
-		The 'Pitch' class should be used to change the sample rate, if that is
-			also necessary.
-			The Transcoder "spoofs" the sample rate in any case, however.
+		Sample rates are converted with an internal Pitch using the 8-tap sinc
+			resampler, so 44.1 KHz assets play cleanly on a 48 KHz output.
 
-		This class is useful enough that it (and Pitch) are automatically added
-			by some constructors in the Signal class.
+		This class is useful enough that it is automatically added by some
+			constructors in the Signal class.
 	*/
 	class Transcoder : public AudioStream
 	{
@@ -227,7 +294,55 @@ namespace plaidgadget
 		Signal source;
 		AudioFormat dest;
 		Function *function;
-		float ratio, offset;
+	};
+
+
+	/*
+		A Prefetch decodes another stream ahead of time on a shared background
+			thread, keeping a ring buffer of up to 'seconds' of audio filled.
+			Pulling from it only copies, so expensive decodes (Vorbis packets,
+			tracker pattern changes) never land in the render callback.
+
+		The source is pulled from the decoder thread rather than the render
+			thread, so it must not need tick() or scratch space.  Codec streams
+			fit the bill; effects and mixers should wrap the Prefetch instead.
+
+		If the decoder falls behind, the missing audio is played as silence and
+			counted in stalls().
+	*/
+	class Prefetch : public AudioStream
+	{
+	public:
+		Prefetch(Audio &audio, Sound source, float seconds = .5f);
+		virtual ~Prefetch();
+
+		//Total number of times any Prefetch ran dry before its source ended.
+		static Uint32 stalls();
+
+	protected:
+		virtual AudioFormat format();
+		virtual void pull(AudioChunk &chunk);
+		virtual bool exhausted();
+		virtual void tick(Uint64 frame);
+
+	private:
+		friend class PrefetchThread;
+
+		//Decodes as much as fits in the ring; called from the decoder thread.
+		void fill();
+		//Decodes one block, returning false once the ring is full or done.
+		bool fillBlock();
+
+		Audio &audio;
+		Signal source;
+		AudioFormat output;
+		Sint32 *ring[PG_MAX_CHANNELS];
+		Uint32 capacity;
+
+		//Positions count frames since the start, so they never wrap.
+		//  The decoder only writes 'written', the renderer only 'read'.
+		std::atomic<Uint64> written, read;
+		std::atomic<bool> finished;
 	};
 
 
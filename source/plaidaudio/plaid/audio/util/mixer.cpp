@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 #include "../util.h"
 
@@ -7,6 +8,35 @@
 using namespace plaidgadget;
 
 
+/*
+	The input of a send bus.  While a return is being pulled the mixer
+		points this at everything sent to its bus; otherwise it's silent.
+*/
+class Mixer::Bus : public AudioStream
+{
+public:
+	Bus(AudioFormat format) : length(0), output(format)
+		{for (Uint32 i = 0; i < PG_MAX_CHANNELS; ++i) data[i] = NULL;}
+
+	Sint32 *data[PG_MAX_CHANNELS];
+	Uint32 length;
+
+protected:
+	virtual AudioFormat format()    {return output;}
+	virtual void tick(Uint64 frame) {}
+	virtual bool exhausted()        {return false;}
+	virtual void pull(AudioChunk &chunk)
+	{
+		Uint32 have = std::min(length, chunk.length());
+		if (have) for (Uint32 i = 0; i < chunk.channels(); ++i)
+			std::memcpy((void*) chunk.start(i), (void*) data[i], 4*have);
+		if (have < chunk.length()) chunk.silence(have);
+	}
+
+private:
+	AudioFormat output;
+};
+
 
 
 void Mixer::play()
@@ -120,6 +150,91 @@ void Mixer::volume(Sound sound, float volume)
 	}
 }
 
+void Mixer::playAt(Sound sound, Uint64 time)
+{
+	//Autobind
+	Signal *p = findOrAdd(sound);
+	if (!p) return;
+
+	//Ticking starts now, so the sound is ready when its time comes
+	external[p].play = true;
+	actions.push(Action(PLAY, p, true, time), extFrame);
+}
+void Mixer::stopAt(Sound sound, Uint64 time)
+{
+	//Find the thing
+	Signals::iterator it = signals.find(sound);
+	if (it == signals.end()) return;
+	if (external[&it->second].drop) return;
+
+	//Notify pull thread
+	actions.push(Action(DROP, &it->second, 0.0f, time), extFrame);
+}
+
+Sint32 Mixer::findBus(Sound input)
+{
+	for (Uint32 i = 0; i < busInputs.size(); ++i)
+		if (busInputs[i] == input) return i;
+	return -1;
+}
+
+Sound Mixer::addBus()
+{
+	if (busInputs.size() >= MAX_BUSES) return Sound::Null();
+	buses[busInputs.size()] = new Bus(output);
+	busInputs.push_back(Sound(buses[busInputs.size()]));
+	return busInputs.back();
+}
+
+void Mixer::returnBus(Sound input, Sound chain)
+{
+	Sint32 bus = findBus(input);
+	if (bus < 0) return;
+
+	//Autobind
+	Signal *p = findOrAdd(chain);
+	if (!p) return;
+	Channel &c = external[p];
+
+	if (c.bus != bus)
+	{
+		Action act(RETURN, p);
+		act.bus = bus;
+		actions.push(act, extFrame);
+		c.bus = bus;
+	}
+	play(chain);
+}
+
+void Mixer::send(Sound sound, Sound input, float level)
+{
+	if (level < 0.0f) level = 0.0f;
+	Sint32 bus = findBus(input);
+	if (bus < 0) return;
+
+	//Autobind
+	Signal *p = findOrAdd(sound);
+	if (!p) return;
+	Channel &c = external[p];
+
+	//State change
+	if (c.sends[bus] != level)
+	{
+		Action act(SEND, p, level);
+		act.bus = bus;
+		actions.push(act, extFrame);
+		c.sends[bus] = level;
+	}
+}
+
+float Mixer::send(Sound sound, Sound input)
+{
+	Sint32 bus = findBus(input);
+	Signals::iterator it = signals.find(sound);
+	if (bus < 0 || it == signals.end()) return 0.0f;
+	return external[&it->second].sends[bus];
+}
+
 bool Mixer::has(Sound sound)
 {
 	return (signals.find(sound) != signals.end());
@@ -154,6 +269,10 @@ Mixer::Mixer(AudioFormat format) :
 	extVolume = intVolume = 1.0f;
 	extPlay = intPlay = true;
 	extFrame = 0;
+	mixed = 0;
+	pending.reserve(MAX_SCHEDULED);
+	intBuses = 0;
+	for (Uint32 i = 0; i < MAX_BUSES; ++i) buses[i] = NULL;
 }
 
 Mixer::~Mixer()
@@ -198,74 +317,165 @@ void Mixer::tick(Uint64 frame)
 	}*/
 }
 
+void Mixer::apply(const Action &act)
+{
+	Channels::iterator i = internal.find(act.signal), e = internal.end();
+	switch (act.code)
+	{
+	case GPLAY:   intPlay =   act.value; break;
+	case GVOLUME: intVolume = act.value; break;
+	case PLAY:    if (i!=e) i->second.play =   act.value; break;
+	case VOLUME:  if (i!=e) i->second.volume = act.value; break;
+	case SEND:    if (i!=e) i->second.sends[act.bus] = act.value; break;
+	case RETURN:
+		if (i!=e) i->second.bus = act.bus;
+		intBuses = std::max(intBuses, act.bus+1);
+		break;
+	case ADD:
+		//std::cout << "Mixer added a sound!" << std::endl;
+		if (i==e) internal.insert(ChannelsEntry(act.signal,Channel()));
+		break;
+	case DROP:
+		//std::cout << "Mixer stopped a sound!" << std::endl;
+		if (i!=e) {internal.erase(i); drops.push(act.signal);}
+		cancel(act.signal);
+		break;
+	}
+	/*std::cout << "  " << "0PVadpv"[act.code] << " "
+		<< " " << act.signal << " " << act.value << std::endl;*/
+}
+
+void Mixer::schedule(const Action &act)
+{
+	cancel(act.signal, act.code);
+	if (pending.size() >= MAX_SCHEDULED) return;
+
+	//Keep the earliest action at the back; ties go in the order given
+	std::vector<Action>::iterator i = pending.begin();
+	while (i != pending.end() && i->time > act.time) ++i;
+	pending.insert(i, act);
+}
+
+void Mixer::cancel(Signal *signal, Uint32 code)
+{
+	for (Uint32 i = 0; i < pending.size();)
+	{
+		if (pending[i].signal == signal && (!code || pending[i].code == code))
+			pending.erase(pending.begin()+i);
+		else ++i;
+	}
+}
+
 void Mixer::pull(AudioChunk &chunk)
 {
+	Uint32 length = chunk.length();
+	Uint64 start = chunk.time();
+
 	//First handle state changes
 	if (chunk.first())
 	{
 		//std::cout << "Mixer:" << now << std::endl;
 		Action act;
-		Channels::iterator i, e = internal.end();
 		//if (pend.frame > now) std::cout << " wait: " << pend.frame << std::endl;
 		while (actions.pull(act, chunk.frame()))
 		{
-			i = internal.find(act.signal);
-			switch (act.code)
+			if (act.time > start) schedule(act);
+			else
 			{
-			case GPLAY:   intPlay =   act.value; break;
-			case GVOLUME: intVolume = act.value; break;
-			case PLAY:    if (i!=e) i->second.play =   act.value; break;
-			case VOLUME:  if (i!=e) i->second.volume = act.value; break;
-			case ADD:
-				//std::cout << "Mixer added a sound!" << std::endl;
-				if (i==e) internal.insert(ChannelsEntry(act.signal,Channel()));
-				break;
-			case DROP:
-				//std::cout << "Mixer stopped a sound!" << std::endl;
-				if (i!=e) {internal.erase(i); drops.push(act.signal);}
-				break;
+				//Immediate plays and pauses override a scheduled start
+				if (act.code == PLAY) cancel(act.signal, PLAY);
+				apply(act);
 			}
-			/*std::cout << "  " << "0PVadpv"[act.code] << " "
-				<< " " << act.signal << " " << act.value << " "
-				<< "/" << now << std::endl;*/
 		}
 	}
 
+	//Mix, splitting wherever a scheduled action lands
+	for (Uint32 done = 0;;)
+	{
+		while (pending.size() && pending.back().time <= start+done)
+		{
+			Action act = pending.back();
+			pending.pop_back();
+			apply(act);
+		}
+
+		Uint32 end = length;
+		if (pending.size() && pending.back().time < start+length)
+			end = Uint32(pending.back().time - start);
+
+		if (!done && end == length) {mix(chunk); break;}
+
+		float a = chunk.a(), span = chunk.b() - a;
+		Sint32 *data[PG_MAX_CHANNELS];
+		for (Uint32 c = 0; c < chunk.channels(); ++c)
+			data[c] = chunk.start(c) + done;
+		AudioChunk part(chunk.audio, chunk.format(), data, end-done,
+			chunk.frame(), done ? a + span*done/length : a,
+			(end == length) ? chunk.b() : a + span*end/length, start+done);
+		mix(part);
+
+		done = end;
+		if (done == length) break;
+	}
+
+	mixed.store(Uint32(internal.size()), std::memory_order_relaxed);
+}
 
+void Mixer::mix(AudioChunk &chunk)
+{
 	//Prep mix
-	AudioChunk temp(chunk.audio, chunk.format(),
-		NULL, chunk.length(), chunk.frame(), chunk.a(), chunk.b());
+	AudioChunk temp(chunk.audio, chunk.format(), NULL, chunk.length(),
+		chunk.frame(), chunk.a(), chunk.b(), chunk.time());
 	bool tempOK = temp.ok();
 
 	Uint32 count = chunk.length(), chans = chunk.format().channels;
 
+	//Sends are summed here, a slice per bus, for the bus returns to pull
+	AudioChunk sends(chunk.audio, chunk.format(), NULL, count*intBuses,
+		chunk.frame(), chunk.a(), chunk.b(), chunk.time());
+	bool sendsOK = intBuses && sends.ok();
+	if (sendsOK) sends.silence();
+
 	bool first = true;
 
-	//GET ON WITH THE MIXIN'
-	if (intPlay)
+	//GET ON WITH THE MIXIN'  (sounds first, then the bus returns they feed)
+	if (intPlay) for (int pass = 0; pass < 2; ++pass)
 		for (Channels::iterator i=internal.begin(), e=internal.end(); i!=e;)
 	{
-		//Skip paused sounds
-		if (!i->second.play) {++i; continue;}
+		//Skip paused sounds, and anything not mixed in this pass
+		if (!i->second.play || (i->second.bus >= 0) != (pass == 1))
+			{++i; continue;}
+
+		//Hand a bus return everything sent to its bus
+		Bus *bus = (pass == 1) ? buses[i->second.bus] : NULL;
+		if (bus)
+		{
+			bus->length = sendsOK ? count : 0;
+			for (Uint32 chan = 0; sendsOK && chan < chans; ++chan)
+				bus->data[chan] = sends.start(chan) + i->second.bus*count;
+		}
 
 		//Compute volume
 		float v = i->second.volume*intVolume;
 		Sint32 mult = Sint32(256.0f * v);
+		AudioChunk *out = &temp;
 
 		if (first && mult == 256)
 		{
 			//Shortcut!
 			i->first->pull(chunk);
+			out = &chunk;
 			//break;
 		}
 		else
 		{
-			if (!tempOK) continue;
+			if (!tempOK) {++i; continue;}
 
 			//Render channel chunk
 			i->first->pull(temp);
 
 			//Compute volume and (if not silent) mix!
+			if (!mult && first) chunk.silence();
 			if (mult) for (Uint32 chan = 0; chan < chans; ++chan)
 			{
 				//Core mixer code lives here!
@@ -289,11 +499,25 @@ void Mixer::pull(AudioChunk &chunk)
 		}
 
 		first = false;
+		if (bus) bus->length = 0;
+
+		//Feed the buses this sound sends to, after its own volume
+		if (pass == 0 && sendsOK) for (Uint32 b = 0; b < intBuses; ++b)
+		{
+			Sint32 send = Sint32(256.0f * i->second.volume * i->second.sends[b]);
+			if (send) for (Uint32 chan = 0; chan < chans; ++chan)
+			{
+				Sint32 *ip = out->start(chan), *op = sends.start(chan) + b*count;
+				for (Sint32 *e = op+count; op != e; ++op, ++ip)
+					*op += (send*(*ip))>>8;
+			}
+		}
 
 		//Drop if exhausted
 		if (i->first->exhausted())
 		{
 			drops.push(i->first);
+			cancel(i->first);
 			internal.erase(i++);
 		}
 		else ++i;
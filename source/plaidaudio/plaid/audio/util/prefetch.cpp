@@ -0,0 +1,197 @@
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <condition_variable>
+
+#include "../util.h"
+
+
+using namespace plaidgadget;
+
+
+namespace plaidgadget
+{
+	//How often the decoder thread wakes up, in milliseconds.
+	static const int PrefetchInterval = 20;
+
+	/*
+		The one thread that tops up every Prefetch.  It wakes up a few times
+			per buffer length, which is plenty when buffers last ~half a second.
+	*/
+	class PrefetchThread
+	{
+	public:
+		static PrefetchThread &get()    {static PrefetchThread t; return t;}
+
+		void add(Prefetch *p)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			streams.push_back(p);
+			wake.notify_one();
+		}
+		void remove(Prefetch *p)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			streams.erase(std::remove(streams.begin(), streams.end(), p),
+				streams.end());
+
+			//Wait out a fill already under way, so the caller can delete it.
+			while (busy == p) idle.wait(lock);
+		}
+
+		std::atomic<Uint32> stalls;
+
+	private:
+		PrefetchThread() : busy(NULL), stopping(false)
+		{
+			stalls = 0;
+			thread = std::thread([this]() {run();});
+		}
+		~PrefetchThread()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+				wake.notify_one();
+			}
+			thread.join();
+		}
+
+		void run()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			while (!stopping)
+			{
+				//Decode without the lock, so add() and remove() needn't wait.
+				for (Uint32 i = 0; i < streams.size(); ++i)
+				{
+					busy = streams[i];
+					lock.unlock();
+					busy->fill();
+					lock.lock();
+					busy = NULL;
+					idle.notify_all();
+				}
+				wake.wait_for(lock, std::chrono::milliseconds(PrefetchInterval));
+			}
+		}
+
+		std::vector<Prefetch*> streams;
+		Prefetch *busy;
+		std::mutex mutex;
+		std::condition_variable wake, idle;
+		bool stopping;
+		std::thread thread;
+	};
+}
+
+
+Prefetch::Prefetch(Audio &_audio, Sound _source, float seconds) :
+	audio(_audio), source(_source)
+{
+	output = source.format();
+	capacity = std::max(Uint32(seconds * output.rate), Uint32(1024));
+	for (Uint32 i = 0; i < PG_MAX_CHANNELS; ++i)
+	{
+		if (i < output.channels) ring[i] = new Sint32[capacity];
+		else ring[i] = NULL;
+	}
+	written = 0;
+	read = 0;
+	finished = false;
+
+	//Have the first block ready before anyone pulls, so playback starts
+	//	promptly; the decoder thread does the rest.
+	fillBlock();
+	PrefetchThread::get().add(this);
+}
+
+Prefetch::~Prefetch()
+{
+	PrefetchThread::get().remove(this);
+	for (Uint32 i = 0; i < PG_MAX_CHANNELS; ++i) delete[] ring[i];
+}
+
+Uint32 Prefetch::stalls()
+{
+	return PrefetchThread::get().stalls;
+}
+
+AudioFormat Prefetch::format()
+{
+	return output;
+}
+
+bool Prefetch::exhausted()
+{
+	return finished.load(std::memory_order_acquire) && read == written;
+}
+
+void Prefetch::tick(Uint64 frame)
+{
+}
+
+void Prefetch::fill()
+{
+	while (fillBlock()) {}
+}
+
+bool Prefetch::fillBlock()
+{
+	//Decode in modest blocks, so no single call hogs the thread.
+	static const Uint32 Block = 4096;
+
+	if (finished.load(std::memory_order_relaxed)) return false;
+
+	Uint64 w = written.load(std::memory_order_relaxed);
+	Uint32 space = capacity - Uint32(w - read.load(std::memory_order_acquire));
+	if (!space) return false;
+
+	//Decode straight into the ring, up to its end.
+	Uint32 start = Uint32(w % capacity);
+	Uint32 length = std::min(std::min(space, capacity - start), Block);
+	Sint32 *data[PG_MAX_CHANNELS];
+	for (Uint32 i = 0; i < output.channels; ++i) data[i] = ring[i] + start;
+
+	AudioChunk chunk(audio, output, data, length, 0, 0.0f, 1.0f);
+	source.pull(chunk);
+
+	//An exhausted source reports how much it managed with a cutoff.
+	//	The data goes out before the news that it's the last of it.
+	bool ended = source.exhausted();
+	written.store(w + (ended ? chunk.cutoff() : length),
+		std::memory_order_release);
+	if (ended) finished.store(true, std::memory_order_release);
+	return !ended;
+}
+
+void Prefetch::pull(AudioChunk &chunk)
+{
+	Uint64 r = read.load(std::memory_order_relaxed);
+	//Read before 'written', so a finished stream's last block is seen.
+	bool done = finished.load(std::memory_order_acquire);
+	Uint32 available = Uint32(written.load(std::memory_order_acquire) - r);
+	Uint32 length = std::min(available, chunk.length());
+
+	//Copy out, in up to two pieces if the data wraps around the ring.
+	Uint32 start = Uint32(r % capacity);
+	Uint32 first = std::min(length, capacity - start);
+	for (Uint32 i = 0; i < output.channels; ++i)
+	{
+		std::memcpy((void*) chunk.start(i), (void*) (ring[i] + start), 4*first);
+		std::memcpy((void*) (chunk.start(i) + first), (void*) ring[i],
+			4*(length - first));
+	}
+	read.store(r + length, std::memory_order_release);
+
+	if (length < chunk.length())
+	{
+		if (done) chunk.cutoff(length);
+		else
+		{
+			chunk.silence(length);
+			++PrefetchThread::get().stalls;
+		}
+	}
+}
@@ -2,6 +2,7 @@
 #include <cstring>
 
 #include "../util.h"
+#include "../effects.h"
 
 
 using namespace plaidgadget;
@@ -103,11 +104,16 @@ Transcoder::Transcoder(Signal _source, AudioFormat _dest) :
 	if (source.format().rate == 0)
 		reportError("BAD SOURCE SAMPLERATE IN TRANSCODER");
 
-	ratio = float(_dest.rate) / float(_source.format().rate);
-	offset = 0.0f;
+	//Convert the rate first, so channel mapping sees the final sample count.
+	AudioFormat src = source.format();
+	if (dest.rate != src.rate)
+	{
+		source = Signal(new Pitch(source, float(src.rate)/float(dest.rate),
+			Pitch::SINC_8));
+	}
 
 
-	Uint32 srcChannels = _source.format().channels;
+	Uint32 srcChannels = src.channels;
 
 	if (srcChannels == dest.channels)
 	{
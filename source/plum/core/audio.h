@@ -3,14 +3,71 @@
 
 #include <string>
 #include <memory>
+#include <cstdint>
+#include <map>
 
 namespace plum
 {
     class Engine;
     class Channel;
     class Sound;
+    class Bus;
     class Audio;
 
+    // How to pick which voice to cut off when too many sounds are playing.
+    // Lower priority voices always go first, and this settles ties between voices of the same priority.
+    enum class VoiceSteal
+    {
+        Oldest,
+        Quietest
+    };
+
+    // How channels are resampled when their pitch changes. Later ones sound cleaner but cost more.
+    enum class Resampler
+    {
+        Linear,
+        Cubic,
+        Sinc8,
+        Sinc32
+    };
+
+    // How the audio thread is keeping up. Callback times are in milliseconds, and cover the callbacks since stats were last read.
+    struct AudioStats
+    {
+        double load;
+        uint64_t callbacks;
+        double minCallback, averageCallback, maxCallback;
+        // Callbacks that ran out of frames from the game, and ones that had to skip ahead because frames backed up.
+        uint64_t underruns, overflows;
+        int voices;
+        // Times a prefetched track couldn't be decoded in time.
+        unsigned int stalls;
+        size_t scratchPeak;
+        // Underruns reported by the device itself, the frames in its last callback, and its measured output latency in milliseconds.
+        uint64_t xruns;
+        unsigned int frames;
+        double latency;
+    };
+
+    // How to open the audio device. Zeroes and empty strings leave the choice to the backend.
+    struct AudioSettings
+    {
+        int rate;
+        int frames;
+        // Suggested output latency, in milliseconds.
+        int latency;
+        // Picked by part of their name, ignoring case, eg. "alsa" and "hw:0".
+        std::string api, device;
+        // Starts with small buffers and grows them whenever the device underruns.
+        bool autoLatency;
+        bool listDevices;
+
+        AudioSettings()
+            : rate(0), frames(0), latency(0), autoLatency(false), listDevices(false)
+        {
+        }
+    };
+
     class Channel
     {
         public:
@@ -20,6 +77,10 @@ namespace plum
             void play();
             void pause();
             void stop();
+            // Start or stop on an exact sample, at a time from Audio::getTime(). Schedule at least a frame ahead;
+            // times already past act as soon as they can.
+            void playAt(double time);
+            void stopAt(double time);
 
             bool isPlaying() const;
             bool isLooped() const;
@@ -30,6 +91,38 @@ namespace plum
             void setPitch(double value);
             void setVolume(double value);
 
+            // How much of this channel goes to each bus, after its own volume and pan.
+            const std::map<std::string, double>& getSends() const;
+            double getSend(const std::string& bus) const;
+            // Sending to a bus that doesn't exist yet makes it.
+            void setSend(const std::string& bus, double level);
+
+            class Impl;
+            std::shared_ptr<Impl> impl;
+    };
+
+    // An effect chain shared by every channel that sends to it, so one filter or reverb serves all of them.
+    // Sends go through the filter, then the reverb or echo, and what comes out is mixed with everything else.
+    class Bus
+    {
+        public:
+            Bus();
+            ~Bus();
+
+            double getVolume() const;
+            double getLowpass() const;
+            double getHighpass() const;
+            void setVolume(double value);
+            // Cutoff frequencies in hertz, or 0 to turn the filter off.
+            void setLowpass(double value);
+            void setHighpass(double value);
+            // Replaces any echo. Depth is the size of the space in meters. A wet of 0 turns it off, so the sends
+            // come through untouched.
+            void setReverb(double wet, double depth);
+            // Replaces any reverb. Distance is in meters, and decay is how loud each repeat is compared to the last.
+            // Decays of 1 or more are brought down to 0.95, so the echo always fades.
+            void setEcho(double distance, double decay);
+
             class Impl;
             std::shared_ptr<Impl> impl;
     };
@@ -40,6 +133,13 @@ namespace plum
             Sound();
             ~Sound();
 
+            // The most copies of this sound that can play at once, or 0 for no limit.
+            int getPolyphony() const;
+            // Voices can only be stolen by sounds of the same or higher priority.
+            int getPriority() const;
+            void setPolyphony(int value);
+            void setPriority(int value);
+
             class Impl;
             std::shared_ptr<Impl> impl;
     };
@@ -47,11 +147,31 @@ namespace plum
     class Audio
     {
         public:
-            Audio(Engine& engine, bool disabled);
+            Audio(Engine& engine, bool disabled, const AudioSettings& settings = AudioSettings());
             ~Audio();
 
             void loadSound(const std::string& filename, Sound& sound);
-            void loadChannel(const Sound& sound, bool looped, Channel& channel);
+            // Prefetched channels are decoded ahead of time on a background thread, which suits long music tracks.
+            // Other channels are voices, which count towards the voice limits. If there's no voice that can be stolen
+            // to make room, the channel is left silent.
+            void loadChannel(const Sound& sound, bool looped, bool prefetch, Channel& channel);
+
+            // The most voices that can play at once, or 0 for no limit.
+            int getMaxVoices() const;
+            VoiceSteal getVoiceSteal() const;
+            int getVoiceCount() const;
+            Resampler getResampler() const;
+            AudioStats getStats();
+            // Seconds of audio mixed so far, which is the clock Channel::playAt and stopAt go by.
+            // It runs ahead of what's heard by the output latency.
+            double getTime() const;
+            void setMaxVoices(int value);
+            void setVoiceSteal(VoiceSteal value);
+            // Applies to every channel, including ones already playing.
+            void setResampler(Resampler value);
+
+            // Made the first time it's asked for. There can be up to 8 buses; any more stay silent.
+            Bus getBus(const std::string& name);
 
             double getPan() const;
             double getPitch() const;
@@ -0,0 +1,249 @@
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "buffer.h"
+
+namespace plum
+{
+    namespace
+    {
+        bool isHostBigEndian()
+        {
+            const uint16_t probe = 1;
+            return *(const uint8_t*) &probe == 0;
+        }
+
+        // Copies size bytes, reversing them if the requested order isn't the host's.
+        void orderBytes(void* dest, const void* source, size_t size, ByteOrder order)
+        {
+            if((order == ByteOrder::Big) == isHostBigEndian())
+            {
+                std::memcpy(dest, source, size);
+            }
+            else
+            {
+                auto d = (uint8_t*) dest;
+                auto s = (const uint8_t*) source;
+                for(size_t i = 0; i < size; ++i)
+                {
+                    d[i] = s[size - 1 - i];
+                }
+            }
+        }
+
+        template<typename T> double decode(const uint8_t* raw, ByteOrder order)
+        {
+            T value;
+            orderBytes(&value, raw, sizeof(T), order);
+            return double(value);
+        }
+
+        template<typename T> void encode(uint8_t* raw, ByteOrder order, T value)
+        {
+            orderBytes(raw, &value, sizeof(T), order);
+        }
+
+        // Converts to an integer that wraps around like the 32 bit types do, instead of being undefined when the
+        // value is out of range. NaN and infinities have no sensible low bits, so they become 0.
+        int64_t wrap(double value)
+        {
+            if(!std::isfinite(value))
+            {
+                return 0;
+            }
+            return int64_t(std::fmod(std::trunc(value), 4294967296.0));
+        }
+    }
+
+    size_t getDataTypeSize(DataType type)
+    {
+        switch(type)
+        {
+            case DataType::Unsigned8: return 1;
+            case DataType::Unsigned16: return 2;
+            case DataType::Unsigned32: return 4;
+            case DataType::Int8: return 1;
+            case DataType::Int16: return 2;
+            case DataType::Int32: return 4;
+            case DataType::Float: return 4;
+            case DataType::Double: return 8;
+            default: return 0;
+        }
+    }
+
+    double decodeValue(const uint8_t* raw, DataType type, ByteOrder order)
+    {
+        switch(type)
+        {
+            case DataType::Unsigned8: return raw[0];
+            case DataType::Unsigned16: return decode<uint16_t>(raw, order);
+            case DataType::Unsigned32: return decode<uint32_t>(raw, order);
+            case DataType::Int8: return int8_t(raw[0]);
+            case DataType::Int16: return decode<int16_t>(raw, order);
+            case DataType::Int32: return decode<int32_t>(raw, order);
+            case DataType::Float: return decode<float>(raw, order);
+            case DataType::Double: return decode<double>(raw, order);
+            default: return 0;
+        }
+    }
+
+    void encodeValue(uint8_t* raw, DataType type, ByteOrder order, double value)
+    {
+        switch(type)
+        {
+            case DataType::Unsigned8: raw[0] = uint8_t(wrap(value)); break;
+            case DataType::Unsigned16: encode(raw, order, uint16_t(wrap(value))); break;
+            case DataType::Unsigned32: encode(raw, order, uint32_t(wrap(value))); break;
+            case DataType::Int8: raw[0] = uint8_t(wrap(value)); break;
+            case DataType::Int16: encode(raw, order, int16_t(wrap(value))); break;
+            case DataType::Int32: encode(raw, order, int32_t(wrap(value))); break;
+            case DataType::Float: encode(raw, order, float(value)); break;
+            case DataType::Double: encode(raw, order, value); break;
+            default: break;
+        }
+    }
+
+    Buffer::Buffer(size_t size)
+        : storage(new Storage(size)), offset(0), length(size), view(false)
+    {
+    }
+
+    Buffer::Buffer(const void* raw, size_t size)
+        : storage(new Storage((const uint8_t*) raw, (const uint8_t*) raw + size)), offset(0), length(size), view(false)
+    {
+    }
+
+    Buffer::Buffer(std::shared_ptr<Storage> storage)
+        : storage(storage ? storage : std::make_shared<Storage>()), offset(0), length(this->storage->size()), view(false)
+    {
+    }
+
+    Buffer::~Buffer()
+    {
+    }
+
+    uint8_t* Buffer::getData()
+    {
+        return storage->data() + offset;
+    }
+
+    const uint8_t* Buffer::getData() const
+    {
+        return storage->data() + offset;
+    }
+
+    size_t Buffer::getSize() const
+    {
+        // A view can outlive part of its storage if the original buffer shrinks.
+        if(view)
+        {
+            return offset < storage->size() ? std::min(length, storage->size() - offset) : 0;
+        }
+        return storage->size();
+    }
+
+    bool Buffer::isView() const
+    {
+        return view;
+    }
+
+    bool Buffer::resize(size_t value)
+    {
+        if(view)
+        {
+            return false;
+        }
+        storage->resize(value);
+        length = value;
+        return true;
+    }
+
+    Buffer Buffer::slice(size_t offset, size_t length) const
+    {
+        size_t size = getSize();
+        offset = std::min(offset, size);
+        length = std::min(length, size - offset);
+
+        Buffer result(*this);
+        result.offset = this->offset + offset;
+        result.length = length;
+        result.view = true;
+        return result;
+    }
+
+    bool Buffer::get(size_t offset, DataType type, ByteOrder order, double& value) const
+    {
+        size_t size = getDataTypeSize(type);
+        if(offset > getSize() || getSize() - offset < size)
+        {
+            return false;
+        }
+        value = decodeValue(getData() + offset, type, order);
+        return true;
+    }
+
+    bool Buffer::set(size_t offset, DataType type, ByteOrder order, double value)
+    {
+        size_t size = getDataTypeSize(type);
+        if(offset > getSize() || getSize() - offset < size)
+        {
+            return false;
+        }
+        encodeValue(getData() + offset, type, order, value);
+        return true;
+    }
+
+    void Buffer::fill(uint8_t value, size_t offset, size_t length)
+    {
+        size_t size = getSize();
+        offset = std::min(offset, size);
+        length = std::min(length, size - offset);
+        std::memset(getData() + offset, value, length);
+    }
+
+    size_t Buffer::copy(size_t offset, const Buffer& source, size_t sourceOffset, size_t length)
+    {
+        size_t size = getSize();
+        size_t sourceSize = source.getSize();
+        if(offset >= size || sourceOffset >= sourceSize)
+        {
+            return 0;
+        }
+
+        length = std::min(length, std::min(size - offset, sourceSize - sourceOffset));
+        std::memmove(getData() + offset, source.getData() + sourceOffset, length);
+        return length;
+    }
+
+    int Buffer::compare(const Buffer& other) const
+    {
+        size_t size = getSize();
+        size_t otherSize = other.getSize();
+        int result = std::memcmp(getData(), other.getData(), std::min(size, otherSize));
+        if(result)
+        {
+            return result < 0 ? -1 : 1;
+        }
+        return size < otherSize ? -1 : size > otherSize ? 1 : 0;
+    }
+
+    std::shared_ptr<Buffer::Storage> Buffer::release()
+    {
+        std::shared_ptr<Storage> result;
+        if(!view && storage.unique())
+        {
+            result = storage;
+        }
+        else
+        {
+            result = std::make_shared<Storage>(getData(), getData() + getSize());
+        }
+
+        if(!view)
+        {
+            storage = std::make_shared<Storage>();
+            length = 0;
+        }
+        return result;
+    }
+}
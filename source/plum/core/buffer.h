@@ -0,0 +1,78 @@
+#ifndef PLUM_BUFFER_H
+#define PLUM_BUFFER_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace plum
+{
+    enum class DataType
+    {
+        Unsigned8,
+        Unsigned16,
+        Unsigned32,
+        Int8,
+        Int16,
+        Int32,
+        Float,
+        Double
+    };
+
+    enum class ByteOrder
+    {
+        Little,
+        Big
+    };
+
+    size_t getDataTypeSize(DataType type);
+    // Reads one value of the given type and byte order from raw memory.
+    double decodeValue(const uint8_t* raw, DataType type, ByteOrder order);
+    // Writes one value of the given type and byte order to raw memory. Integers wrap around.
+    void encodeValue(uint8_t* raw, DataType type, ByteOrder order, double value);
+
+    // A resizable array of bytes. A slice is a view of part of another buffer, sharing its storage,
+    // so writes to either show up in both. Offsets are in bytes, starting from 0.
+    class Buffer
+    {
+        public:
+            typedef std::vector<uint8_t> Storage;
+
+            Buffer(size_t size);
+            Buffer(const void* raw, size_t size);
+            // Takes over existing storage, without copying.
+            Buffer(std::shared_ptr<Storage> storage);
+            ~Buffer();
+
+            uint8_t* getData();
+            const uint8_t* getData() const;
+            size_t getSize() const;
+            bool isView() const;
+
+            // Only buffers which aren't views can be resized. Returns false otherwise.
+            bool resize(size_t value);
+            Buffer slice(size_t offset, size_t length) const;
+
+            bool get(size_t offset, DataType type, ByteOrder order, double& value) const;
+            bool set(size_t offset, DataType type, ByteOrder order, double value);
+            void fill(uint8_t value, size_t offset, size_t length);
+            // Copies from source, which may overlap this buffer. Returns the number of bytes copied.
+            size_t copy(size_t offset, const Buffer& source, size_t sourceOffset, size_t length);
+            // Compares bytes like memcmp, with a shorter buffer ordered first when it's a prefix of the other.
+            int compare(const Buffer& other) const;
+
+            // Gives up the storage so it can change hands (eg. to another thread) without being copied.
+            // The buffer is left empty. Views, and buffers that views still look into, hand over a copy instead,
+            // and a view keeps its contents, since they belong to another buffer.
+            std::shared_ptr<Storage> release();
+
+        private:
+            std::shared_ptr<Storage> storage;
+            size_t offset;
+            size_t length;
+            bool view;
+    };
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include "pack.h"
+#include "cache.h"
+
+namespace plum
+{
+    namespace
+    {
+        struct Entry
+        {
+            std::weak_ptr<void> resource;
+            // Only set while the cache limit allows keeping the resource alive after everyone else is done with it.
+            std::shared_ptr<void> retained;
+            size_t bytes;
+            uint64_t lastUse;
+
+            bool isUnused() const
+            {
+                return retained && retained.use_count() == 1;
+            }
+        };
+
+        struct Cache
+        {
+            std::unordered_map<std::string, Entry> entries;
+            size_t limit;
+            uint64_t clock;
+            uint64_t hits;
+            uint64_t misses;
+
+            Cache()
+                : limit(0), clock(0), hits(0), misses(0)
+            {
+            }
+
+            // Forgets entries whose resources are gone.
+            void prune()
+            {
+                for(auto it = entries.begin(); it != entries.end();)
+                {
+                    if(it->second.resource.expired())
+                    {
+                        it = entries.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+            // Lets go of unused resources, least recently used first, until no more than bytes of them are left.
+            void release(size_t bytes)
+            {
+                std::vector<Entry*> unused;
+                size_t total = 0;
+                for(auto& it : entries)
+                {
+                    if(it.second.isUnused())
+                    {
+                        unused.push_back(&it.second);
+                        total += it.second.bytes;
+                    }
+                }
+                if(total <= bytes)
+                {
+                    return;
+                }
+
+                std::sort(unused.begin(), unused.end(), [](const Entry* a, const Entry* b) { return a->lastUse < b->lastUse; });
+                for(auto e : unused)
+                {
+                    if(total <= bytes)
+                    {
+                        break;
+                    }
+                    total -= e->bytes;
+                    e->retained.reset();
+                }
+                prune();
+            }
+        };
+
+        Cache& getCache()
+        {
+            static Cache cache;
+            return cache;
+        }
+    }
+
+    std::shared_ptr<void> findCached(const std::string& key)
+    {
+        Cache& cache(getCache());
+        auto it = cache.entries.find(key);
+        if(it != cache.entries.end())
+        {
+            if(auto resource = it->second.resource.lock())
+            {
+                it->second.lastUse = ++cache.clock;
+                ++cache.hits;
+                return resource;
+            }
+            cache.entries.erase(it);
+        }
+        ++cache.misses;
+        return nullptr;
+    }
+
+    void addCached(const std::string& key, const std::shared_ptr<void>& resource, size_t bytes)
+    {
+        Cache& cache(getCache());
+        Entry& e(cache.entries[key]);
+        e.resource = resource;
+        e.retained = cache.limit ? resource : nullptr;
+        e.bytes = bytes;
+        e.lastUse = ++cache.clock;
+
+        if(cache.limit)
+        {
+            cache.release(cache.limit);
+        }
+        else
+        {
+            cache.prune();
+        }
+    }
+
+    std::string makeCacheKey(const char* kind, const std::string& filename)
+    {
+        return std::string(kind) + ":" + Pack::normalize(filename);
+    }
+
+    size_t getCacheLimit()
+    {
+        return getCache().limit;
+    }
+
+    void setCacheLimit(size_t bytes)
+    {
+        Cache& cache(getCache());
+        cache.limit = bytes;
+        if(bytes)
+        {
+            // Anything still in use can be kept from now on too.
+            for(auto& it : cache.entries)
+            {
+                if(!it.second.retained)
+                {
+                    it.second.retained = it.second.resource.lock();
+                }
+            }
+        }
+        trimCache(bytes);
+    }
+
+    void trimCache(size_t bytes)
+    {
+        Cache& cache(getCache());
+        cache.release(bytes);
+        if(!cache.limit)
+        {
+            // Nothing new gets retained without a limit, so anything still held was kept from before.
+            for(auto& it : cache.entries)
+            {
+                if(!it.second.isUnused())
+                {
+                    it.second.retained.reset();
+                }
+            }
+        }
+        cache.prune();
+    }
+
+    CacheStats getCacheStats()
+    {
+        Cache& cache(getCache());
+        // Resources only become unused when their last user lets go, which the cache doesn't hear about,
+        // so the limit is applied whenever the cache is looked at.
+        if(cache.limit)
+        {
+            cache.release(cache.limit);
+        }
+        cache.prune();
+
+        CacheStats stats = {0, 0, 0, 0, cache.hits, cache.misses};
+        for(auto& it : cache.entries)
+        {
+            ++stats.count;
+            stats.bytes += it.second.bytes;
+            if(it.second.isUnused())
+            {
+                ++stats.unusedCount;
+                stats.unusedBytes += it.second.bytes;
+            }
+        }
+        return stats;
+    }
+}
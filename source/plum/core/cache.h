@@ -0,0 +1,42 @@
+#ifndef PLUM_CACHE_H
+#define PLUM_CACHE_H
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace plum
+{
+    struct CacheStats
+    {
+        // Resources that are still alive, and roughly how much memory they hold.
+        size_t count;
+        size_t bytes;
+        // Of those, the ones only the cache is keeping alive.
+        size_t unusedCount;
+        size_t unusedBytes;
+        uint64_t hits;
+        uint64_t misses;
+    };
+
+    // Loaded resources are remembered by key (a kind, plus the path after Pack::normalize),
+    // so loading the same file twice hands back the resource that's already loaded.
+    // Entries only hold weak references, so a resource is freed as soon as the last user lets go of it,
+    // unless the cache limit lets it keep a few unused ones around in case they're loaded again.
+    // Only meant to be used from the main thread.
+    std::shared_ptr<void> findCached(const std::string& key);
+    void addCached(const std::string& key, const std::shared_ptr<void>& resource, size_t bytes);
+    // Makes a key for a file loaded as the given kind of resource.
+    std::string makeCacheKey(const char* kind, const std::string& filename);
+
+    // How many bytes of unused resources the cache may keep alive. 0 (the default) keeps none.
+    // It's enforced whenever something is loaded or the stats are read, so it can be overshot in between.
+    size_t getCacheLimit();
+    void setCacheLimit(size_t bytes);
+    // Frees unused resources, oldest first, until at most the given number of bytes of them are left.
+    void trimCache(size_t bytes);
+    CacheStats getCacheStats();
+}
+
+#endif
@@ -1,19 +1,19 @@
-#include <iostream>
-#include <fstream>
 #include <sstream>
 #include <string>
 
+#include "file.h"
 #include "config.h"
 
 namespace plum
 {
     Config::Config(const std::string& name)
     {
-        std::ifstream f(name);
-        if(f.good())
+        // Goes through File, so the config can be shipped inside a pack too.
+        File f(name, FileOpenMode::Read);
+        if(f.isActive())
         {
             std::string line;
-            while(std::getline(f, line))
+            while(f.readLine(line))
             {
                 size_t index = line.find_first_of(" \t");
                 std::string key, value;
@@ -1,4 +1,17 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <algorithm>
 #include "file.h"
+#include "pack.h"
 
 namespace plum
 {
@@ -11,6 +24,7 @@ namespace plum
                 case FileOpenMode::Write: return "wb";
                 case FileOpenMode::Append: return "ab";
                 case FileOpenMode::Read: return "rb";
+                case FileOpenMode::Map: return "rb";
                 default: return "rb";
             }
         }
@@ -22,15 +36,119 @@ namespace plum
                 case FileOpenMode::Write: return true;
                 case FileOpenMode::Append: return true;
                 case FileOpenMode::Read: return false;
+                case FileOpenMode::Map: return false;
                 default: return false;
             }
         }
     }
 
+    std::shared_ptr<const uint8_t> mapFile(const std::string& filename, size_t& size)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+        {
+            return nullptr;
+        }
+
+        LARGE_INTEGER length;
+        HANDLE mapping = nullptr;
+        if(GetFileSizeEx(file, &length) && length.QuadPart > 0)
+        {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        CloseHandle(file);
+        if(!mapping)
+        {
+            return nullptr;
+        }
+
+        // The view keeps the mapping open by itself.
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if(!view)
+        {
+            return nullptr;
+        }
+
+        size = size_t(length.QuadPart);
+        return std::shared_ptr<const uint8_t>((const uint8_t*) view, [](const uint8_t* p)
+        {
+            UnmapViewOfFile(p);
+        });
+#else
+        int fd = open(filename.c_str(), O_RDONLY);
+        if(fd == -1)
+        {
+            return nullptr;
+        }
+
+        struct stat info;
+        void* view = MAP_FAILED;
+        if(fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping keeps the file open by itself.
+        close(fd);
+        if(view == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        size_t length = size_t(info.st_size);
+        size = length;
+        return std::shared_ptr<const uint8_t>((const uint8_t*) view, [length](const uint8_t* p)
+        {
+            munmap((void*) p, length);
+        });
+#endif
+    }
+
     File::File(const std::string& filename, FileOpenMode mode)
-        : file(std::fopen(filename.c_str(), getModeFlags(mode))),
-        writing(isWriteMode(mode))
+        : file(nullptr),
+        writing(isWriteMode(mode)),
+        inMemory(false),
+        data(nullptr),
+        size(0),
+        cursor(0)
     {
+        if(!writing)
+        {
+            PackEntry entry;
+            auto pack = findPack(filename, entry);
+            if(pack)
+            {
+                // Uncompressed entries in a mapped pack can be read in place. Anything else gets unpacked.
+                mapping = pack->map(entry);
+                if(mapping)
+                {
+                    data = mapping.get();
+                    size = entry.size;
+                    inMemory = true;
+                }
+                else if(pack->read(entry, contents))
+                {
+                    data = contents.data();
+                    size = contents.size();
+                    inMemory = true;
+                }
+                return;
+            }
+        }
+
+        if(mode == FileOpenMode::Map)
+        {
+            mapping = mapFile(filename, size);
+            if(mapping)
+            {
+                data = mapping.get();
+                inMemory = true;
+                return;
+            }
+            // Empty files can't be mapped, and some filesystems don't support it, so fall back to reading normally.
+        }
+        file = std::fopen(filename.c_str(), getModeFlags(mode));
     }
 
     File::~File()
@@ -40,11 +158,20 @@ namespace plum
 
     bool File::isActive() const
     {
-        return file != nullptr;
+        return file != nullptr || inMemory;
     }
 
     bool File::close()
     {
+        if(inMemory)
+        {
+            inMemory = false;
+            data = nullptr;
+            size = 0;
+            std::vector<uint8_t>().swap(contents);
+            mapping.reset();
+            return true;
+        }
         if(isActive())
         {
             std::fclose(file);
@@ -54,13 +181,50 @@ namespace plum
         return false;
     }
 
+    size_t File::read(void* raw, size_t length)
+    {
+        if(inMemory)
+        {
+            auto source = readInPlace(length);
+            if(length)
+            {
+                std::memcpy(raw, source, length);
+            }
+            return length;
+        }
+        return std::fread(raw, 1, length, file);
+    }
+
+    const uint8_t* File::readInPlace(size_t& length)
+    {
+        if(!inMemory)
+        {
+            length = 0;
+            return nullptr;
+        }
+
+        length = cursor < size ? std::min(length, size - cursor) : 0;
+        if(!length)
+        {
+            return nullptr;
+        }
+        auto start = data + cursor;
+        cursor += length;
+        return start;
+    }
+
+    bool File::isInMemory() const
+    {
+        return inMemory;
+    }
+
     bool File::readUnsigned8(uint8_t& value)
     {
         if(writing || !isActive())
         {
             return false;
         }
-        return std::fread(&value, sizeof(uint8_t), 1, file) == 1;
+        return read(&value, sizeof(uint8_t)) == sizeof(uint8_t);
     }
 
     bool File::readUnsigned16(uint16_t& value)
@@ -69,7 +233,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value, sizeof(uint16_t), 1, file) == 1;
+        return read(&value, sizeof(uint16_t)) == sizeof(uint16_t);
     }
 
     bool File::readUnsigned32(uint32_t& value)
@@ -78,7 +242,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value, sizeof(uint32_t), 1, file) == 1;
+        return read(&value, sizeof(uint32_t)) == sizeof(uint32_t);
     }
 
     bool File::readInt8(int8_t& value)
@@ -87,7 +251,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value, sizeof(int8_t), 1, file) == 1;
+        return read(&value, sizeof(int8_t)) == sizeof(int8_t);
     }
 
     bool File::readInt16(int16_t& value)
@@ -96,7 +260,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value, sizeof(int16_t), 1, file) == 1;
+        return read(&value, sizeof(int16_t)) == sizeof(int16_t);
     }
 
     bool File::readInt32(int32_t& value)
@@ -105,7 +269,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value, sizeof(int32_t), 1, file) == 1;
+        return read(&value, sizeof(int32_t)) == sizeof(int32_t);
     }
 
     bool File::readFloat(float& value)
@@ -115,7 +279,7 @@ namespace plum
             return false;
         }
 
-        return std::fread(&value, sizeof(float), 1, file) == 1;
+        return read(&value, sizeof(float)) == sizeof(float);
     }
     
     bool File::readDouble(double& value)
@@ -125,7 +289,7 @@ namespace plum
             return false;
         }
 
-        return std::fread(&value, sizeof(double), 1, file) == 1;
+        return read(&value, sizeof(double)) == sizeof(double);
     }
 
     bool File::readString(std::string& value)
@@ -134,7 +298,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(&value[0], 1, value.size(), file) > 0;
+        return read(&value[0], value.size()) > 0;
     }
 
     size_t File::readRaw(void* raw, size_t length)
@@ -143,7 +307,7 @@ namespace plum
         {
             return false;
         }
-        return std::fread(raw, 1, length, file);
+        return read(raw, length);
     }
 
     /*
@@ -190,6 +354,24 @@ namespace plum
         }
 
         value.clear();
+        if(inMemory)
+        {
+            if(cursor >= size)
+            {
+                return false;
+            }
+
+            auto start = data + cursor;
+            auto end = std::find(start, data + size, '\n');
+            cursor = (end - data) + (end != data + size ? 1 : 0);
+            if(end != start && end[-1] == '\r')
+            {
+                --end;
+            }
+            value.assign(start, end);
+            return true;
+        }
+
         bool eol = false;
         bool eof = false;
         do
@@ -202,7 +384,7 @@ namespace plum
             else
             {
                 size_t len = std::strlen(buffer);
-                if(buffer[len - 2] == '\r' && buffer[len - 1] == '\n')
+                if(len >= 2 && buffer[len - 2] == '\r' && buffer[len - 1] == '\n')
                 {
                     buffer[len - 2] = 0;
                     eol = true;
@@ -335,6 +517,24 @@ namespace plum
         {
             return 0;
         }
+
+        if(inMemory)
+        {
+            long target;
+            switch(mode)
+            {
+                case FileSeekMode::Start:   target = position; break;
+                case FileSeekMode::Current: target = long(cursor) + position; break;
+                case FileSeekMode::End:     target = long(size) + position; break;
+                default: return false;
+            }
+            if(target < 0)
+            {
+                return false;
+            }
+            cursor = size_t(target);
+            return true;
+        }
         
         int m;
         switch(mode)
@@ -349,12 +549,16 @@ namespace plum
 
     long File::tell()
     {
+        if(inMemory)
+        {
+            return long(cursor);
+        }
         return isActive() ? std::ftell(file) : -1;
     }
 
     void File::flush()
     {
-        if(isActive())
+        if(file)
         {
             std::fflush(file);
         }
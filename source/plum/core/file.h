@@ -1,7 +1,9 @@
 #ifndef PLUM_FILE_H
 #define PLUM_FILE_H
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
@@ -13,6 +15,7 @@ namespace plum
         Read, // Load from a file. File must exist.
         Write, // Save to a file. Overwrite existing file, if any.
         Append, // Add to end of existing file, or create new.
+        Map, // Load from a file mapped into memory, so reads are just copies. File must exist.
     };
 
     enum class FileSeekMode
@@ -22,6 +25,11 @@ namespace plum
         End, // Relative to the end of the file.
     };
 
+    // Maps a whole file into memory, read-only. The mapping is released along with the last pointer to it.
+    // Returns nullptr if the file couldn't be mapped (eg. it's missing or empty).
+    std::shared_ptr<const uint8_t> mapFile(const std::string& filename, size_t& size);
+
+    // A file on disk, or inside a mounted pack (see pack.h) when opened for reading.
     class File
     {
         public:
@@ -42,6 +50,11 @@ namespace plum
             bool readString(std::string& value);
             bool readLine(std::string& value);
             size_t readRaw(void* raw, size_t length);
+            // For files held in memory (mapped, or from a pack), skips past the next length bytes and returns
+            // a pointer to them instead of copying. length is cut short at the end of the file.
+            // Returns nullptr if the file isn't in memory, or there's nothing left. The pointer is valid until the file is closed.
+            const uint8_t* readInPlace(size_t& length);
+            bool isInMemory() const;
             
             bool writeUnsigned8(uint8_t value);
             bool writeUnsigned16(uint16_t value);
@@ -63,6 +76,18 @@ namespace plum
         private:
             std::FILE* file;
             bool writing;
+
+            // Files that are mapped, or read out of a mounted pack, are held in memory instead of being opened.
+            // data points into either the mapping or contents.
+            bool inMemory;
+            const uint8_t* data;
+            size_t size;
+            size_t cursor;
+            std::vector<uint8_t> contents;
+            std::shared_ptr<const uint8_t> mapping;
+
+            // Reads up to length bytes from wherever the file lives, and returns how many were read.
+            size_t read(void* raw, size_t length);
     };
 }
 
@@ -0,0 +1,125 @@
+#include "file.h"
+#include "file_queue.h"
+
+namespace plum
+{
+    namespace
+    {
+        bool readWhole(const std::string& filename, std::vector<uint8_t>& data)
+        {
+            File f(filename, FileOpenMode::Read);
+            if(!f.isActive() || !f.seek(0, FileSeekMode::End))
+            {
+                return false;
+            }
+            long size = f.tell();
+            if(size < 0 || !f.seek(0, FileSeekMode::Start))
+            {
+                return false;
+            }
+
+            data.resize(size_t(size));
+            return f.readRaw(data.data(), data.size()) == data.size();
+        }
+
+        bool writeWhole(const std::string& filename, const std::vector<uint8_t>& data)
+        {
+            File f(filename, FileOpenMode::Write);
+            if(!f.isActive())
+            {
+                return false;
+            }
+            return f.writeRaw(data.data(), data.size()) == data.size() && f.close();
+        }
+    }
+
+    FileQueue::FileQueue()
+        : pending(0), stopping(false)
+    {
+        thread = std::thread([this](){ run(); });
+    }
+
+    FileQueue::~FileQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        signal.notify_all();
+        thread.join();
+    }
+
+    void FileQueue::submit(FileRequest&& request)
+    {
+        request.success = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            waiting.push_back(std::move(request));
+            ++pending;
+        }
+        signal.notify_all();
+    }
+
+    bool FileQueue::poll(FileRequest& request)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(finished.empty())
+        {
+            return false;
+        }
+
+        request = std::move(finished.front());
+        finished.pop_front();
+        --pending;
+        return true;
+    }
+
+    size_t FileQueue::getPending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+    void FileQueue::run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            while(waiting.empty() && !stopping)
+            {
+                signal.wait(lock);
+            }
+            if(waiting.empty())
+            {
+                return;
+            }
+
+            FileRequest request(std::move(waiting.front()));
+            waiting.pop_front();
+            if(stopping && request.kind == FileRequestKind::Read)
+            {
+                continue;
+            }
+
+            // The disk is only touched with the lock released, so submitting and polling never wait on it.
+            lock.unlock();
+            if(request.kind == FileRequestKind::Read)
+            {
+                request.success = readWhole(request.filename, request.data);
+                if(!request.success)
+                {
+                    request.data.clear();
+                }
+            }
+            else
+            {
+                request.success = writeWhole(request.filename, request.data);
+                // Nobody needs the written bytes back.
+                std::vector<uint8_t>().swap(request.data);
+            }
+            lock.lock();
+
+            finished.push_back(std::move(request));
+        }
+    }
+}
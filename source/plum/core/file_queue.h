@@ -0,0 +1,62 @@
+#ifndef PLUM_FILE_QUEUE_H
+#define PLUM_FILE_QUEUE_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+namespace plum
+{
+    enum class FileRequestKind
+    {
+        Read, // Load a whole file into data.
+        Write, // Save data as the whole file, replacing whatever was there.
+    };
+
+    struct FileRequest
+    {
+        FileRequestKind kind;
+        std::string filename;
+        std::vector<uint8_t> data;
+        // Set once the request is done.
+        bool success;
+        // Left alone by the queue, so the caller can tell its requests apart.
+        int tag;
+    };
+
+    // Reads and writes whole files on a thread of its own, so the caller never waits on the disk.
+    // Requests are handled in the order they're submitted, so a read after a write sees what was written.
+    class FileQueue
+    {
+        public:
+            FileQueue();
+            // Finishes any writes still waiting, so nothing queued to be saved is lost. Waiting reads are dropped.
+            ~FileQueue();
+
+            void submit(FileRequest&& request);
+            // Takes the next finished request, if there is one.
+            bool poll(FileRequest& request);
+            // Requests submitted and not yet polled.
+            size_t getPending() const;
+
+        private:
+            mutable std::mutex mutex;
+            std::condition_variable signal;
+            std::deque<FileRequest> waiting;
+            std::deque<FileRequest> finished;
+            size_t pending;
+            bool stopping;
+            std::thread thread;
+
+            void run();
+
+            FileQueue(const FileQueue&);
+            void operator =(const FileQueue&);
+    };
+}
+
+#endif
@@ -0,0 +1,241 @@
+#include <algorithm>
+#include "font.h"
+#include "image.h"
+
+namespace plum
+{
+    namespace
+    {
+        const int TabSize = 4;
+
+        bool isGlyph(int c)
+        {
+            return c >= Font::FirstGlyph && c < Font::FirstGlyph + Font::GlyphCount;
+        }
+
+        uint16_t kerningKey(int first, int second)
+        {
+            return uint16_t(((first & 0xFF) << 8) | (second & 0xFF));
+        }
+    }
+
+    Font::Font(Image& image, const Sheet& sheet)
+        : image(&image), sheet(sheet), letterSpacing(1), revision(0)
+    {
+        std::fill(widths, widths + GlyphCount, sheet.getWidth());
+    }
+
+    Font::Font(Image& image, int columns, int rows)
+        : image(&image), letterSpacing(1), revision(0)
+    {
+        // Read through a const reference, so a shared image isn't copied.
+        const Canvas& canvas(static_cast<const Image&>(image).canvas());
+        Color border = canvas.get(0, 0);
+        int cellWidth = canvas.getWidth() - 1;
+        int cellHeight = canvas.getHeight() - 1;
+
+        for(int w = 1; w < canvas.getWidth(); ++w)
+        {
+            if(canvas.get(w, 1) == border)
+            {
+                cellWidth = w - 1;
+                break;
+            }
+        }
+        for(int h = 1; h < canvas.getHeight(); ++h)
+        {
+            if(canvas.get(1, h) == border)
+            {
+                cellHeight = h - 1;
+                break;
+            }
+        }
+
+        sheet = Sheet(cellWidth, cellHeight, columns, rows);
+        sheet.setPadding(true);
+        std::fill(widths, widths + GlyphCount, cellWidth);
+    }
+
+    Font::~Font()
+    {
+    }
+
+    Image& Font::getImage() const
+    {
+        return *image;
+    }
+
+    const Sheet& Font::getSheet() const
+    {
+        return sheet;
+    }
+
+    int Font::getHeight() const
+    {
+        return sheet.getHeight();
+    }
+
+    int Font::getLetterSpacing() const
+    {
+        return letterSpacing;
+    }
+
+    int Font::getGlyphWidth(int c) const
+    {
+        return isGlyph(c) ? widths[c - FirstGlyph] : 0;
+    }
+
+    int Font::getKerning(int first, int second) const
+    {
+        auto it = kerning.find(kerningKey(first, second));
+        return it != kerning.end() ? it->second : 0;
+    }
+
+    unsigned int Font::getRevision() const
+    {
+        return revision;
+    }
+
+    void Font::setLetterSpacing(int value)
+    {
+        letterSpacing = value;
+        ++revision;
+    }
+
+    void Font::setGlyphWidth(int c, int width)
+    {
+        if(isGlyph(c))
+        {
+            widths[c - FirstGlyph] = width;
+            ++revision;
+        }
+    }
+
+    void Font::setKerning(int first, int second, int amount)
+    {
+        if(amount)
+        {
+            kerning[kerningKey(first, second)] = amount;
+        }
+        else
+        {
+            kerning.erase(kerningKey(first, second));
+        }
+        ++revision;
+    }
+
+    void Font::enableVariableWidth()
+    {
+        const Canvas& canvas(static_cast<const Image*>(image)->canvas());
+        const int width = sheet.getWidth();
+        const int height = sheet.getHeight();
+
+        // The space has nothing to measure, so give it a fraction of the cell.
+        widths[0] = width * 6 / 10;
+        for(int i = 1; i < GlyphCount; ++i)
+        {
+            int fx, fy;
+            widths[i] = widths[0];
+            if(!sheet.getFrame(i, fx, fy))
+            {
+                continue;
+            }
+
+            for(int x = width - 1; x >= 0; --x)
+            {
+                bool empty = true;
+                for(int y = 0; y < height && empty; ++y)
+                {
+                    empty = canvas.get(fx + x, fy + y)[ColorChannel::Alpha] == 0;
+                }
+                if(!empty)
+                {
+                    widths[i] = x + 1;
+                    break;
+                }
+            }
+        }
+        ++revision;
+    }
+
+    int Font::getTextWidth(const std::string& text) const
+    {
+        int width = 0;
+        size_t start = 0;
+        while(start <= text.size())
+        {
+            size_t end = std::min(text.find('\n', start), text.size());
+            width = std::max(width, getLineWidth(text, start, end));
+            start = end + 1;
+        }
+        return width;
+    }
+
+    void Font::layout(const std::string& text, TextAlign align, std::vector<Glyph>& glyphs, int& width, int& height) const
+    {
+        glyphs.clear();
+        width = 0;
+        height = 0;
+
+        size_t start = 0;
+        while(start <= text.size())
+        {
+            size_t end = std::min(text.find('\n', start), text.size());
+            int lineWidth = getLineWidth(text, start, end);
+            int x = 0;
+            switch(align)
+            {
+                case TextAlign::Left: x = 0; break;
+                case TextAlign::Center: x = -lineWidth / 2; break;
+                case TextAlign::Right: x = -lineWidth; break;
+                default: x = 0; break;
+            }
+
+            for(size_t i = start; i < end; ++i)
+            {
+                unsigned char c = text[i];
+                if(isGlyph(c))
+                {
+                    Glyph g;
+                    g.x = x;
+                    g.y = height;
+                    g.frame = c - FirstGlyph;
+                    glyphs.push_back(g);
+                }
+                x += getAdvance(c, i + 1 < end ? text[i + 1] : 0);
+            }
+
+            width = std::max(width, lineWidth);
+            height += sheet.getHeight();
+            start = end + 1;
+        }
+    }
+
+    int Font::getAdvance(unsigned char c, unsigned char next) const
+    {
+        if(c == '\t')
+        {
+            return widths[0] * TabSize;
+        }
+        else if(isGlyph(c))
+        {
+            int advance = widths[c - FirstGlyph] + letterSpacing;
+            if(!kerning.empty())
+            {
+                advance += getKerning(c, next);
+            }
+            return advance;
+        }
+        return 0;
+    }
+
+    int Font::getLineWidth(const std::string& text, size_t start, size_t end) const
+    {
+        int width = 0;
+        for(size_t i = start; i < end; ++i)
+        {
+            width += getAdvance(text[i], i + 1 < end ? text[i + 1] : 0);
+        }
+        return width;
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef PLUM_FONT_H
+#define PLUM_FONT_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "sheet.h"
+
+namespace plum
+{
+    class Image;
+
+    enum class TextAlign
+    {
+        Left,
+        Center,
+        Right
+    };
+
+    // A bitmap font, made of a sheet of glyphs in ASCII order starting at the space character.
+    class Font
+    {
+        public:
+            static const int FirstGlyph = 32;
+            static const int GlyphCount = 96;
+
+            // Where a glyph lands, relative to the position the text is drawn at.
+            struct Glyph
+            {
+                int x, y;
+                int frame;
+            };
+
+            Font(Image& image, const Sheet& sheet);
+            // Works out the cell size from the one pixel border drawn around every glyph.
+            Font(Image& image, int columns, int rows);
+            ~Font();
+
+            Image& getImage() const;
+            const Sheet& getSheet() const;
+            int getHeight() const;
+            int getLetterSpacing() const;
+            int getGlyphWidth(int c) const;
+            int getKerning(int first, int second) const;
+            // Bumped whenever a change would move glyphs around, so cached layouts know to redo their work.
+            unsigned int getRevision() const;
+
+            void setLetterSpacing(int value);
+            void setGlyphWidth(int c, int width);
+            void setKerning(int first, int second, int amount);
+
+            // Measures each glyph by its rightmost column of non-transparent pixels.
+            void enableVariableWidth();
+
+            // Returns the width of the widest line.
+            int getTextWidth(const std::string& text) const;
+            // Places every glyph in the text, one line per newline, and returns the size of the whole block.
+            void layout(const std::string& text, TextAlign align, std::vector<Glyph>& glyphs, int& width, int& height) const;
+
+        private:
+            Image* image;
+            Sheet sheet;
+            int letterSpacing;
+            int widths[GlyphCount];
+            std::unordered_map<uint16_t, int> kerning;
+            unsigned int revision;
+
+            int getAdvance(unsigned char c, unsigned char next) const;
+            int getLineWidth(const std::string& text, size_t start, size_t end) const;
+    };
+}
+
+#endif
@@ -19,6 +19,8 @@ namespace plum
             Image(const Canvas& source);
             ~Image();
 
+            // Fetching the canvas to write to a shared image copies its pixels and texture first,
+            // so the change doesn't show up in the other images using them.
             Canvas& canvas();
             const Canvas& canvas() const;
 
@@ -32,7 +34,11 @@ namespace plum
             void drawFrameRaw(const Sheet& sheet, int f, int x, int y, Screen& dest);
 
             class Impl;
+            // Shares the texture and pixels of an image that's already loaded.
+            Image(const std::shared_ptr<Impl>& impl);
             std::shared_ptr<Impl> impl;
+            // Set while impl may be in use by other images (or the resource cache), so it's copied before it changes.
+            bool shared;
     };
 }
 
@@ -0,0 +1,399 @@
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <unordered_set>
+#include <zlib.h>
+#include "file.h"
+#include "pack.h"
+
+namespace plum
+{
+    namespace
+    {
+        const char PackMagic[4] = {'P', 'P', 'A', 'K'};
+        const uint32_t PackVersion = 1;
+
+        struct PackHeader
+        {
+            char magic[4];
+            uint32_t version;
+            uint32_t count;
+            uint32_t reserved;
+            uint64_t tableOffset;
+        };
+
+        enum PackFlag : uint8_t
+        {
+            CompressedFlag = 1
+        };
+
+        struct Mounts
+        {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<Pack>> packs;
+        };
+
+        Mounts& getMounts()
+        {
+            static Mounts mounts;
+            return mounts;
+        }
+
+        template<typename T> bool readValue(std::FILE* file, T& value)
+        {
+            return std::fread(&value, sizeof(T), 1, file) == 1;
+        }
+
+        template<typename T> bool writeValue(std::FILE* file, const T& value)
+        {
+            return std::fwrite(&value, sizeof(T), 1, file) == 1;
+        }
+
+        bool readLooseFile(const std::string& filename, std::vector<uint8_t>& data)
+        {
+            std::FILE* file = std::fopen(filename.c_str(), "rb");
+            if(!file)
+            {
+                return false;
+            }
+
+            std::fseek(file, 0, SEEK_END);
+            long length = std::ftell(file);
+            std::fseek(file, 0, SEEK_SET);
+
+            data.resize(length > 0 ? size_t(length) : 0);
+            bool success = length >= 0 && std::fread(data.data(), 1, data.size(), file) == data.size();
+            std::fclose(file);
+            return success;
+        }
+    }
+
+    Pack::Pack(const std::string& filename)
+        : filename(filename), file(std::fopen(filename.c_str(), "rb"))
+    {
+        if(!file)
+        {
+            return;
+        }
+
+        PackHeader header;
+        if(!readValue(file, header)
+            || std::memcmp(header.magic, PackMagic, sizeof(header.magic))
+            || header.version != PackVersion
+            || std::fseek(file, long(header.tableOffset), SEEK_SET) != 0)
+        {
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+
+        entries.reserve(header.count);
+        for(uint32_t i = 0; i < header.count; ++i)
+        {
+            uint16_t nameLength;
+            uint8_t flags;
+            PackEntry entry;
+            std::string name;
+
+            if(!readValue(file, nameLength))
+            {
+                break;
+            }
+            name.resize(nameLength);
+            if(std::fread(&name[0], 1, nameLength, file) != nameLength
+                || !readValue(file, entry.offset)
+                || !readValue(file, entry.size)
+                || !readValue(file, entry.originalSize)
+                || !readValue(file, flags))
+            {
+                break;
+            }
+            entry.compressed = (flags & CompressedFlag) != 0;
+            entries[name] = entry;
+        }
+
+        // A truncated table means the pack can't be trusted.
+        if(entries.size() != header.count)
+        {
+            entries.clear();
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+
+        // Once the pack is mapped, entries are read straight out of memory, and the file isn't needed anymore.
+        size_t mappedSize = 0;
+        mapping = mapFile(filename, mappedSize);
+        if(mapping)
+        {
+            for(const auto& entry : entries)
+            {
+                if(entry.second.offset > mappedSize || entry.second.size > mappedSize - entry.second.offset)
+                {
+                    entries.clear();
+                    mapping.reset();
+                    break;
+                }
+            }
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    Pack::~Pack()
+    {
+        if(file)
+        {
+            std::fclose(file);
+        }
+    }
+
+    bool Pack::isActive() const
+    {
+        return file != nullptr || mapping != nullptr;
+    }
+
+    const std::string& Pack::getFilename() const
+    {
+        return filename;
+    }
+
+    size_t Pack::getCount() const
+    {
+        return entries.size();
+    }
+
+    bool Pack::find(const std::string& name, PackEntry& entry) const
+    {
+        auto it = entries.find(name);
+        if(it != entries.end())
+        {
+            entry = it->second;
+            return true;
+        }
+        return false;
+    }
+
+    bool Pack::read(const PackEntry& entry, std::vector<uint8_t>& data)
+    {
+        if(mapping)
+        {
+            const uint8_t* source = mapping.get() + entry.offset;
+            if(entry.compressed)
+            {
+                uLongf length = entry.originalSize;
+                data.resize(entry.originalSize);
+                return uncompress(data.data(), &length, source, entry.size) == Z_OK
+                    && length == entry.originalSize;
+            }
+            data.assign(source, source + entry.size);
+            return true;
+        }
+        if(!file)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> stored;
+        std::vector<uint8_t>& raw(entry.compressed ? stored : data);
+        raw.resize(entry.size);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(std::fseek(file, long(entry.offset), SEEK_SET) != 0
+                || std::fread(raw.data(), 1, raw.size(), file) != raw.size())
+            {
+                return false;
+            }
+        }
+
+        if(entry.compressed)
+        {
+            uLongf length = entry.originalSize;
+            data.resize(entry.originalSize);
+            if(uncompress(data.data(), &length, stored.data(), uLong(stored.size())) != Z_OK
+                || length != entry.originalSize)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::shared_ptr<const uint8_t> Pack::map(const PackEntry& entry) const
+    {
+        if(!mapping || entry.compressed)
+        {
+            return nullptr;
+        }
+        // Shares ownership of the whole mapping, so the pack can be unmounted while this is still in use.
+        return std::shared_ptr<const uint8_t>(mapping, mapping.get() + entry.offset);
+    }
+
+    void Pack::getNames(std::vector<std::string>& names) const
+    {
+        for(const auto& entry : entries)
+        {
+            names.push_back(entry.first);
+        }
+        std::sort(names.begin(), names.end());
+    }
+
+    std::string Pack::normalize(const std::string& name)
+    {
+        std::string result;
+        result.reserve(name.size());
+        for(auto c : name)
+        {
+            c = c == '\\' ? '/' : c;
+            // Collapse repeated slashes.
+            if(c != '/' || result.empty() || result.back() != '/')
+            {
+                result.push_back(c);
+            }
+        }
+        while(result.compare(0, 2, "./") == 0)
+        {
+            result.erase(0, 2);
+        }
+        return result;
+    }
+
+    bool mountPack(const std::string& filename)
+    {
+        auto pack = std::make_shared<Pack>(filename);
+        if(!pack->isActive())
+        {
+            return false;
+        }
+
+        Mounts& mounts(getMounts());
+        std::lock_guard<std::mutex> lock(mounts.mutex);
+        mounts.packs.push_back(pack);
+        return true;
+    }
+
+    bool unmountPack(const std::string& filename)
+    {
+        Mounts& mounts(getMounts());
+        std::lock_guard<std::mutex> lock(mounts.mutex);
+        for(auto it = mounts.packs.begin(); it != mounts.packs.end(); ++it)
+        {
+            if((*it)->getFilename() == filename)
+            {
+                // Files already opened from the pack keep it alive until they're done.
+                mounts.packs.erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::shared_ptr<Pack> findPack(const std::string& name, PackEntry& entry)
+    {
+        Mounts& mounts(getMounts());
+        std::lock_guard<std::mutex> lock(mounts.mutex);
+        if(mounts.packs.empty())
+        {
+            return nullptr;
+        }
+
+        std::string key(Pack::normalize(name));
+        for(auto it = mounts.packs.rbegin(); it != mounts.packs.rend(); ++it)
+        {
+            if((*it)->find(key, entry))
+            {
+                return *it;
+            }
+        }
+        return nullptr;
+    }
+
+    bool buildPack(const std::string& filename, const std::vector<std::string>& names, bool compress)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if(!file)
+        {
+            return false;
+        }
+
+        // Leave room for the header, which is written last, once the table's position is known.
+        PackHeader header;
+        std::memset(&header, 0, sizeof(header));
+        bool success = writeValue(file, header);
+
+        std::vector<std::pair<std::string, PackEntry>> table;
+        std::unordered_set<std::string> added;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> packed;
+        for(const auto& name : names)
+        {
+            // A name listed twice (even spelled differently) is only stored once,
+            // since the table has to have exactly as many distinct names as its count.
+            std::string key(Pack::normalize(name));
+            if(!added.insert(key).second)
+            {
+                continue;
+            }
+
+            if(!success || !readLooseFile(name, data) || data.size() > std::numeric_limits<uint32_t>::max())
+            {
+                success = false;
+                break;
+            }
+
+            PackEntry entry;
+            entry.offset = uint64_t(std::ftell(file));
+            entry.originalSize = uint32_t(data.size());
+            entry.compressed = false;
+
+            const std::vector<uint8_t>* stored = &data;
+            if(compress && !data.empty())
+            {
+                // The vendored zlib predates compressBound, so this is its documented worst case.
+                uLongf length = uLong(data.size()) + uLong(data.size()) / 1000 + 12;
+                packed.resize(length);
+                if(compress2(packed.data(), &length, data.data(), uLong(data.size()), Z_BEST_COMPRESSION) == Z_OK
+                    && length < data.size())
+                {
+                    packed.resize(length);
+                    stored = &packed;
+                    entry.compressed = true;
+                }
+            }
+            entry.size = uint32_t(stored->size());
+            success = std::fwrite(stored->data(), 1, stored->size(), file) == stored->size();
+            table.push_back(std::make_pair(key, entry));
+        }
+
+        if(success)
+        {
+            std::memcpy(header.magic, PackMagic, sizeof(header.magic));
+            header.version = PackVersion;
+            header.count = uint32_t(table.size());
+            header.tableOffset = uint64_t(std::ftell(file));
+
+            for(const auto& item : table)
+            {
+                const std::string& name(item.first);
+                const PackEntry& entry(item.second);
+                uint16_t nameLength = uint16_t(name.size());
+                uint8_t flags = entry.compressed ? CompressedFlag : 0;
+
+                success = success
+                    && name.size() <= std::numeric_limits<uint16_t>::max()
+                    && writeValue(file, nameLength)
+                    && std::fwrite(name.data(), 1, name.size(), file) == name.size()
+                    && writeValue(file, entry.offset)
+                    && writeValue(file, entry.size)
+                    && writeValue(file, entry.originalSize)
+                    && writeValue(file, flags);
+            }
+
+            success = success
+                && std::fseek(file, 0, SEEK_SET) == 0
+                && writeValue(file, header);
+        }
+
+        return std::fclose(file) == 0 && success;
+    }
+}
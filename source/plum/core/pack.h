@@ -0,0 +1,70 @@
+#ifndef PLUM_PACK_H
+#define PLUM_PACK_H
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <unordered_map>
+
+namespace plum
+{
+    // Where a file lives inside a pack.
+    struct PackEntry
+    {
+        uint64_t offset;
+        // Bytes stored in the pack, and bytes once decompressed. These are the same for uncompressed entries.
+        uint32_t size;
+        uint32_t originalSize;
+        bool compressed;
+    };
+
+    // An archive of many files in one, with a table of contents that's loaded up front,
+    // so finding a file is a hash lookup instead of a trip to the filesystem.
+    // Each entry can be compressed with zlib on its own.
+    class Pack
+    {
+        public:
+            Pack(const std::string& filename);
+            ~Pack();
+
+            bool isActive() const;
+            const std::string& getFilename() const;
+            size_t getCount() const;
+
+            // Expects a name that's already been through normalize.
+            bool find(const std::string& name, PackEntry& entry) const;
+            // Reads and decompresses an entry. Safe to call from several threads at once.
+            bool read(const PackEntry& entry, std::vector<uint8_t>& data);
+            // Points straight at an uncompressed entry when the pack is mapped into memory, or returns nullptr.
+            std::shared_ptr<const uint8_t> map(const PackEntry& entry) const;
+            void getNames(std::vector<std::string>& names) const;
+
+            // Turns a path into the form names are stored in, with forward slashes and no leading "./".
+            static std::string normalize(const std::string& name);
+
+        private:
+            std::string filename;
+            // Packs are mapped into memory when possible, and only fall back to reading through the file.
+            std::FILE* file;
+            std::shared_ptr<const uint8_t> mapping;
+            std::mutex mutex;
+            std::unordered_map<std::string, PackEntry> entries;
+
+            Pack(const Pack&);
+            void operator =(const Pack&);
+    };
+
+    // Packs are searched newest first, ahead of the real directory, whenever a file is opened for reading.
+    bool mountPack(const std::string& filename);
+    bool unmountPack(const std::string& filename);
+    // Finds the newest mounted pack that has the named file, or returns nullptr.
+    std::shared_ptr<Pack> findPack(const std::string& name, PackEntry& entry);
+    // Writes the named loose files into a new pack. Entries are only kept compressed when it makes them smaller.
+    // Names that normalize to the same path are stored once.
+    bool buildPack(const std::string& filename, const std::vector<std::string>& names, bool compress);
+}
+
+#endif
@@ -0,0 +1,206 @@
+#include <cmath>
+#include <algorithm>
+#include "particles.h"
+
+namespace plum
+{
+    size_t ParticleSystem::getCount() const
+    {
+        return count;
+    }
+
+    size_t ParticleSystem::getCapacity() const
+    {
+        return capacity;
+    }
+
+    double ParticleSystem::getGravityX() const
+    {
+        return gravityX;
+    }
+
+    double ParticleSystem::getGravityY() const
+    {
+        return gravityY;
+    }
+
+    double ParticleSystem::getDrag() const
+    {
+        return drag;
+    }
+
+    BlendMode ParticleSystem::getMode() const
+    {
+        return mode;
+    }
+
+    void ParticleSystem::setCapacity(size_t value)
+    {
+        resize(value);
+    }
+
+    void ParticleSystem::setGravityX(double value)
+    {
+        gravityX = float(value);
+    }
+
+    void ParticleSystem::setGravityY(double value)
+    {
+        gravityY = float(value);
+    }
+
+    void ParticleSystem::setDrag(double value)
+    {
+        drag = float(std::min(std::max(value, 0.0), 1.0));
+    }
+
+    void ParticleSystem::setMode(BlendMode value)
+    {
+        mode = value;
+    }
+
+    void ParticleSystem::clear()
+    {
+        count = 0;
+    }
+
+    size_t ParticleSystem::emit(const ParticleEmitter& emitter, size_t amount)
+    {
+        const float DegreesToRadians = float(M_PI / 180.0);
+
+        amount = std::min(amount, capacity - count);
+        for(size_t k = 0; k < amount; ++k)
+        {
+            size_t i = count++;
+
+            float direction = float(emitter.angle + (random() - 0.5) * emitter.spread) * DegreesToRadians;
+            float speed = float(emitter.speedMin + random() * (emitter.speedMax - emitter.speedMin));
+            int duration = std::max(emitter.lifeMin + int(random() * (emitter.lifeMax - emitter.lifeMin + 1)), 1);
+
+            x[i] = float(emitter.x + random() * emitter.width);
+            y[i] = float(emitter.y + random() * emitter.height);
+            vx[i] = std::cos(direction) * speed;
+            vy[i] = std::sin(direction) * speed;
+            ax[i] = float(emitter.accelX);
+            ay[i] = float(emitter.accelY);
+            angle[i] = float(emitter.rotation + (random() - 0.5) * emitter.rotationSpread);
+            spin[i] = float(emitter.spin);
+            life[i] = duration;
+            maxLife[i] = duration;
+            frameStart[i] = emitter.frameStart;
+            frameEnd[i] = std::max(emitter.frameEnd, emitter.frameStart);
+            tint[i] = emitter.tint;
+            fade[i] = emitter.fade;
+        }
+        return amount;
+    }
+
+    void ParticleSystem::update(unsigned int ticks)
+    {
+        const float damping = 1.0f - drag;
+        const float gx = gravityX;
+        const float gy = gravityY;
+
+        for(unsigned int t = 0; t < ticks && count > 0; ++t)
+        {
+            // Integrate each attribute in its own pass, which keeps the loops simple enough to vectorize.
+            const size_t n = count;
+            float* px = x.data();
+            float* py = y.data();
+            float* pvx = vx.data();
+            float* pvy = vy.data();
+            const float* pax = ax.data();
+            const float* pay = ay.data();
+            float* pangle = angle.data();
+            const float* pspin = spin.data();
+            int* plife = life.data();
+
+            for(size_t i = 0; i < n; ++i)
+            {
+                pvx[i] = (pvx[i] + pax[i] + gx) * damping;
+            }
+            for(size_t i = 0; i < n; ++i)
+            {
+                pvy[i] = (pvy[i] + pay[i] + gy) * damping;
+            }
+            for(size_t i = 0; i < n; ++i)
+            {
+                px[i] += pvx[i];
+            }
+            for(size_t i = 0; i < n; ++i)
+            {
+                py[i] += pvy[i];
+            }
+            for(size_t i = 0; i < n; ++i)
+            {
+                pangle[i] += pspin[i];
+            }
+            for(size_t i = 0; i < n; ++i)
+            {
+                --plife[i];
+            }
+
+            // Remove expired particles, filling their slots from the end.
+            for(size_t i = 0; i < count;)
+            {
+                if(life[i] <= 0)
+                {
+                    kill(i);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+    }
+
+    float ParticleSystem::random()
+    {
+        // xorshift32, which is plenty for scattering particles.
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return float(seed >> 8) / 16777216.0f;
+    }
+
+    void ParticleSystem::resize(size_t value)
+    {
+        capacity = value;
+        count = std::min(count, capacity);
+
+        x.resize(capacity);
+        y.resize(capacity);
+        vx.resize(capacity);
+        vy.resize(capacity);
+        ax.resize(capacity);
+        ay.resize(capacity);
+        angle.resize(capacity);
+        spin.resize(capacity);
+        life.resize(capacity);
+        maxLife.resize(capacity);
+        frameStart.resize(capacity);
+        frameEnd.resize(capacity);
+        tint.resize(capacity);
+        fade.resize(capacity);
+    }
+
+    void ParticleSystem::kill(size_t index)
+    {
+        size_t last = --count;
+        x[index] = x[last];
+        y[index] = y[last];
+        vx[index] = vx[last];
+        vy[index] = vy[last];
+        ax[index] = ax[last];
+        ay[index] = ay[last];
+        angle[index] = angle[last];
+        spin[index] = spin[last];
+        life[index] = life[last];
+        maxLife[index] = maxLife[last];
+        frameStart[index] = frameStart[last];
+        frameEnd[index] = frameEnd[last];
+        tint[index] = tint[last];
+        fade[index] = fade[last];
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef PLUM_PARTICLES_H
+#define PLUM_PARTICLES_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "color.h"
+#include "blending.h"
+
+namespace plum
+{
+    class Sheet;
+    class Image;
+    class Screen;
+
+    // Describes how new particles are spawned. Ranges are picked from uniformly at random.
+    struct ParticleEmitter
+    {
+        // Spawn area.
+        double x, y;
+        double width, height;
+        // Direction of travel in degrees, and the random spread around it.
+        double angle, spread;
+        // Initial speed, in pixels per tick.
+        double speedMin, speedMax;
+        // Per-particle acceleration, in pixels per tick per tick.
+        double accelX, accelY;
+        // Lifetime in ticks.
+        int lifeMin, lifeMax;
+        // Sheet frames to animate through over the particle's lifetime.
+        int frameStart, frameEnd;
+        // Image tint.
+        Color tint;
+        // Fade the tint's alpha out over the particle's lifetime.
+        bool fade;
+        // Initial angle of rotation in degrees (with random spread), and the spin in degrees per tick.
+        double rotation, rotationSpread;
+        double spin;
+
+        ParticleEmitter()
+            : x(0.0), y(0.0),
+            width(0.0), height(0.0),
+            angle(0.0), spread(360.0),
+            speedMin(0.0), speedMax(1.0),
+            accelX(0.0), accelY(0.0),
+            lifeMin(50), lifeMax(50),
+            frameStart(0), frameEnd(0),
+            tint(Color::White),
+            fade(false),
+            rotation(0.0), rotationSpread(0.0),
+            spin(0.0)
+        {
+        }
+    };
+
+    // A pool of particles, stored as parallel arrays so that the update is a tight loop
+    // over each attribute, and drawn together in a single batch.
+    class ParticleSystem
+    {
+        public:
+            ParticleSystem(size_t capacity);
+            ~ParticleSystem();
+
+            size_t getCount() const;
+            size_t getCapacity() const;
+            double getGravityX() const;
+            double getGravityY() const;
+            double getDrag() const;
+            BlendMode getMode() const;
+
+            void setCapacity(size_t value);
+            void setGravityX(double value);
+            void setGravityY(double value);
+            void setDrag(double value);
+            void setMode(BlendMode value);
+
+            void clear();
+            // Spawns up to amount particles (limited by capacity), and returns how many were made.
+            size_t emit(const ParticleEmitter& emitter, size_t amount);
+            void update(unsigned int ticks);
+            // Draws every particle centered on its position, offset by (x, y).
+            void draw(Image& img, const Sheet& sheet, int x, int y, Screen& dest);
+
+            class Impl;
+            std::shared_ptr<Impl> impl;
+
+        private:
+            size_t count;
+            size_t capacity;
+            float gravityX, gravityY;
+            float drag;
+            BlendMode mode;
+            uint32_t seed;
+
+            std::vector<float> x, y;
+            std::vector<float> vx, vy;
+            std::vector<float> ax, ay;
+            std::vector<float> angle, spin;
+            std::vector<int> life, maxLife;
+            std::vector<int> frameStart, frameEnd;
+            std::vector<uint32_t> tint;
+            std::vector<uint8_t> fade;
+
+            float random();
+            void resize(size_t value);
+            void kill(size_t index);
+    };
+}
+
+#endif
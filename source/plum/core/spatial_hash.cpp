@@ -0,0 +1,309 @@
+#include <algorithm>
+#include "spatial_hash.h"
+
+namespace plum
+{
+    namespace
+    {
+        uint64_t cellKey(int cx, int cy)
+        {
+            return (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+        }
+
+        bool overlaps(int x, int y, int width, int height, int x2, int y2, int width2, int height2)
+        {
+            return x < x2 + width2 && x2 < x + width
+                && y < y2 + height2 && y2 < y + height;
+        }
+    }
+
+    SpatialHash::SpatialHash(int cellSize)
+        : cellSize(std::max(cellSize, 1)), stamp(0)
+    {
+    }
+
+    SpatialHash::~SpatialHash()
+    {
+    }
+
+    size_t SpatialHash::getCount() const
+    {
+        return entries.size();
+    }
+
+    int SpatialHash::getCellSize() const
+    {
+        return cellSize;
+    }
+
+    void SpatialHash::setCellSize(int value)
+    {
+        value = std::max(value, 1);
+        if(value != cellSize)
+        {
+            cellSize = value;
+            cells.clear();
+            for(size_t i = 0; i < entries.size(); ++i)
+            {
+                cover(entries[i]);
+                link(i);
+            }
+        }
+    }
+
+    bool SpatialHash::contains(int handle) const
+    {
+        return indices.find(handle) != indices.end();
+    }
+
+    bool SpatialHash::get(int handle, int& x, int& y, int& width, int& height) const
+    {
+        auto it = indices.find(handle);
+        if(it != indices.end())
+        {
+            const Entry& e(entries[it->second]);
+            x = e.x;
+            y = e.y;
+            width = e.width;
+            height = e.height;
+            return true;
+        }
+        return false;
+    }
+
+    void SpatialHash::insert(int handle, int x, int y, int width, int height)
+    {
+        Entry e;
+        e.handle = handle;
+        e.x = x;
+        e.y = y;
+        e.width = std::max(width, 0);
+        e.height = std::max(height, 0);
+        cover(e);
+
+        auto it = indices.find(handle);
+        if(it != indices.end())
+        {
+            size_t index = it->second;
+            Entry& old(entries[index]);
+
+            // Most moves stay within the same cells, so only touch the buckets when they don't.
+            if(old.cx != e.cx || old.cy != e.cy || old.cx2 != e.cx2 || old.cy2 != e.cy2)
+            {
+                unlink(index);
+                old = e;
+                link(index);
+            }
+            else
+            {
+                old = e;
+            }
+        }
+        else
+        {
+            size_t index = entries.size();
+            entries.push_back(e);
+            marks.push_back(0);
+            indices[handle] = index;
+            link(index);
+        }
+    }
+
+    void SpatialHash::remove(int handle)
+    {
+        auto it = indices.find(handle);
+        if(it == indices.end())
+        {
+            return;
+        }
+
+        size_t index = it->second;
+        size_t last = entries.size() - 1;
+        unlink(index);
+        indices.erase(it);
+
+        // Fill the hole with the last entry, so the entries stay packed.
+        if(index != last)
+        {
+            relink(last, index);
+            entries[index] = entries[last];
+            indices[entries[index].handle] = index;
+        }
+        entries.pop_back();
+        marks.pop_back();
+    }
+
+    void SpatialHash::clear()
+    {
+        entries.clear();
+        indices.clear();
+        cells.clear();
+        marks.clear();
+    }
+
+    void SpatialHash::queryRect(int x, int y, int width, int height, std::vector<int>& results) const
+    {
+        if(width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        int cx = cellOf(x);
+        int cy = cellOf(y);
+        int cx2 = cellOf(x + width - 1);
+        int cy2 = cellOf(y + height - 1);
+        uint32_t current = nextStamp();
+
+        for(int j = cy; j <= cy2; ++j)
+        {
+            for(int i = cx; i <= cx2; ++i)
+            {
+                auto cell = cells.find(cellKey(i, j));
+                if(cell == cells.end())
+                {
+                    continue;
+                }
+
+                for(auto index : cell->second)
+                {
+                    if(marks[index] != current)
+                    {
+                        marks[index] = current;
+
+                        const Entry& e(entries[index]);
+                        if(overlaps(x, y, width, height, e.x, e.y, e.width, e.height))
+                        {
+                            results.push_back(e.handle);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void SpatialHash::queryPoint(int x, int y, std::vector<int>& results) const
+    {
+        auto cell = cells.find(cellKey(cellOf(x), cellOf(y)));
+        if(cell == cells.end())
+        {
+            return;
+        }
+
+        // A point only falls in one cell, so there are no duplicates to skip.
+        for(auto index : cell->second)
+        {
+            const Entry& e(entries[index]);
+            if(e.x <= x && x < e.x + e.width
+                && e.y <= y && y < e.y + e.height)
+            {
+                results.push_back(e.handle);
+            }
+        }
+    }
+
+    void SpatialHash::queryPairs(std::vector<int>& results) const
+    {
+        for(const auto& cell : cells)
+        {
+            const auto& bucket(cell.second);
+            int cx = int(uint32_t(cell.first >> 32));
+            int cy = int(uint32_t(cell.first));
+
+            for(size_t i = 0; i < bucket.size(); ++i)
+            {
+                const Entry& a(entries[bucket[i]]);
+                for(size_t j = i + 1; j < bucket.size(); ++j)
+                {
+                    const Entry& b(entries[bucket[j]]);
+
+                    // Two boxes can share several cells. Only report the pair from the
+                    // top-left cell of their shared range, so each pair appears once.
+                    if(std::max(a.cx, b.cx) == cx && std::max(a.cy, b.cy) == cy
+                        && overlaps(a.x, a.y, a.width, a.height, b.x, b.y, b.width, b.height))
+                    {
+                        results.push_back(a.handle);
+                        results.push_back(b.handle);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t SpatialHash::nextStamp() const
+    {
+        // Once the counter wraps around, old marks could collide with new ones, so start over.
+        if(++stamp == 0)
+        {
+            std::fill(marks.begin(), marks.end(), 0);
+            stamp = 1;
+        }
+        return stamp;
+    }
+
+    int SpatialHash::cellOf(int coordinate) const
+    {
+        // Round towards negative infinity, so cells don't double up around zero.
+        return coordinate >= 0 ? coordinate / cellSize : -((-coordinate - 1) / cellSize) - 1;
+    }
+
+    void SpatialHash::cover(Entry& e) const
+    {
+        e.cx = cellOf(e.x);
+        e.cy = cellOf(e.y);
+        e.cx2 = cellOf(e.x + std::max(e.width - 1, 0));
+        e.cy2 = cellOf(e.y + std::max(e.height - 1, 0));
+    }
+
+    void SpatialHash::link(size_t index)
+    {
+        const Entry& e(entries[index]);
+        for(int j = e.cy; j <= e.cy2; ++j)
+        {
+            for(int i = e.cx; i <= e.cx2; ++i)
+            {
+                cells[cellKey(i, j)].push_back(index);
+            }
+        }
+    }
+
+    void SpatialHash::unlink(size_t index)
+    {
+        const Entry& e(entries[index]);
+        for(int j = e.cy; j <= e.cy2; ++j)
+        {
+            for(int i = e.cx; i <= e.cx2; ++i)
+            {
+                auto cell = cells.find(cellKey(i, j));
+                if(cell == cells.end())
+                {
+                    continue;
+                }
+
+                auto& bucket(cell->second);
+                auto it = std::find(bucket.begin(), bucket.end(), index);
+                if(it != bucket.end())
+                {
+                    *it = bucket.back();
+                    bucket.pop_back();
+                }
+                if(bucket.empty())
+                {
+                    cells.erase(cell);
+                }
+            }
+        }
+    }
+
+    void SpatialHash::relink(size_t from, size_t to)
+    {
+        const Entry& e(entries[from]);
+        for(int j = e.cy; j <= e.cy2; ++j)
+        {
+            for(int i = e.cx; i <= e.cx2; ++i)
+            {
+                auto& bucket(cells[cellKey(i, j)]);
+                std::replace(bucket.begin(), bucket.end(), from, to);
+            }
+        }
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef PLUM_SPATIAL_HASH_H
+#define PLUM_SPATIAL_HASH_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace plum
+{
+    // A uniform grid of buckets for finding overlapping boxes without testing every pair.
+    // Boxes are identified by integer handles chosen by the caller.
+    class SpatialHash
+    {
+        public:
+            SpatialHash(int cellSize);
+            ~SpatialHash();
+
+            size_t getCount() const;
+            int getCellSize() const;
+            // Changing the cell size rebuckets every box.
+            void setCellSize(int value);
+
+            bool contains(int handle) const;
+            bool get(int handle, int& x, int& y, int& width, int& height) const;
+            // Adds a box, or moves it if the handle is already in use.
+            void insert(int handle, int x, int y, int width, int height);
+            void remove(int handle);
+            void clear();
+
+            // Appends the handles of every box overlapping the given rectangle or containing the given point.
+            void queryRect(int x, int y, int width, int height, std::vector<int>& results) const;
+            void queryPoint(int x, int y, std::vector<int>& results) const;
+            // Appends each overlapping pair of handles, as a, b, a, b, ..., reporting every pair once.
+            void queryPairs(std::vector<int>& results) const;
+
+        private:
+            struct Entry
+            {
+                int handle;
+                int x, y;
+                int width, height;
+                // The range of cells covered, inclusive.
+                int cx, cy, cx2, cy2;
+            };
+
+            int cellSize;
+            std::vector<Entry> entries;
+            std::unordered_map<int, size_t> indices;
+            std::unordered_map<uint64_t, std::vector<size_t>> cells;
+            // Used to skip boxes already seen by a query when they span several cells.
+            mutable std::vector<uint32_t> marks;
+            mutable uint32_t stamp;
+
+            uint32_t nextStamp() const;
+            int cellOf(int coordinate) const;
+            // Works out the range of cells that the entry's box falls in.
+            void cover(Entry& e) const;
+            void link(size_t index);
+            void unlink(size_t index);
+            void relink(size_t from, size_t to);
+    };
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "text.h"
+
+namespace plum
+{
+    Font& Text::getFont() const
+    {
+        return *font;
+    }
+
+    const std::string& Text::getText() const
+    {
+        return text;
+    }
+
+    TextAlign Text::getAlign() const
+    {
+        return align;
+    }
+
+    int Text::getWidth()
+    {
+        update();
+        return width;
+    }
+
+    int Text::getHeight()
+    {
+        update();
+        return height;
+    }
+
+    void Text::setText(const std::string& value)
+    {
+        if(value != text)
+        {
+            text = value;
+            dirty = true;
+        }
+    }
+
+    void Text::setAlign(TextAlign value)
+    {
+        if(value != align)
+        {
+            align = value;
+            dirty = true;
+        }
+    }
+
+    void Text::update()
+    {
+        if(dirty || fontRevision != font->getRevision())
+        {
+            font->layout(text, align, glyphs, width, height);
+            fontRevision = font->getRevision();
+            dirty = false;
+            ++layoutRevision;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PLUM_TEXT_H
+#define PLUM_TEXT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "font.h"
+
+namespace plum
+{
+    class Screen;
+    struct Transform;
+
+    // A string laid out in a font. The layout and its vertices are kept between draws,
+    // and only redone when the string, alignment or font metrics change.
+    class Text
+    {
+        public:
+            Text(Font& font, const std::string& text);
+            ~Text();
+
+            Font& getFont() const;
+            const std::string& getText() const;
+            TextAlign getAlign() const;
+            int getWidth();
+            int getHeight();
+
+            void setText(const std::string& value);
+            void setAlign(TextAlign value);
+
+            // Draws the whole text in one batch. The text is anchored at (x, y) according to its alignment.
+            void draw(int x, int y, Screen& dest);
+            void draw(int x, int y, const Transform& transform, Screen& dest);
+
+            class Impl;
+            std::shared_ptr<Impl> impl;
+
+        private:
+            Font* font;
+            std::string text;
+            TextAlign align;
+            std::vector<Font::Glyph> glyphs;
+            int width, height;
+            bool dirty;
+            unsigned int fontRevision;
+            // Bumped every time the glyphs are placed again, so the renderer knows when to rebuild its vertices.
+            unsigned int layoutRevision;
+
+            void update();
+    };
+}
+
+#endif
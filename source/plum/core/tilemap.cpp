@@ -13,6 +13,21 @@ namespace plum
         return height;
     }
 
+    unsigned int* Tilemap::getData()
+    {
+        return data;
+    }
+
+    const unsigned int* Tilemap::getData() const
+    {
+        return data;
+    }
+
+    void Tilemap::setModified(bool value)
+    {
+        modified = value;
+    }
+
     void Tilemap::clear(unsigned int tileIndex)
     {
         modified = true;
@@ -19,6 +19,11 @@ namespace plum
 
             int getWidth() const;
             int getHeight() const;
+            // Tiles are stored row by row, width * height of them.
+            unsigned int* getData();
+            const unsigned int* getData() const;
+            // Call after changing the data directly, so the next draw picks it up.
+            void setModified(bool value);
 
             void clear(unsigned int tileIndex);
 
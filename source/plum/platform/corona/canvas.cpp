@@ -56,7 +56,8 @@ namespace plum
 {
     Canvas Canvas::load(const std::string& filename)
     {
-        std::unique_ptr<corona::File> file(new FileWrapper(new File(filename, FileOpenMode::Read)));
+        // Mapped, so the decoders' many small reads are copies out of memory instead of trips through stdio.
+        std::unique_ptr<corona::File> file(new FileWrapper(new File(filename, FileOpenMode::Map)));
         std::unique_ptr<corona::Image> image(corona::OpenImage(file.get(), corona::PF_R8G8B8A8, corona::FF_AUTODETECT));
         if(!image.get())
         {
@@ -23,7 +23,9 @@ namespace plum
         "uniform float angle;\n"
         "in vec2 xy;\n"
         "in vec2 uv;\n"
+        "in vec4 tint;\n"
         "out vec2 fragmentUV;\n"
+        "out vec4 fragmentTint;\n"
         "void main()\n"
         "{\n"
         // /1 0 0 x + p\   /s 0 0 0\   /+cos(a) -sin(a) 0 0\   /1 0 0 -p\
@@ -38,6 +40,7 @@ namespace plum
         "       -scale.x * cos(angle) * pivot.x + pivot.x + origin.x + pivot.y * scale.x * sin(angle), -scale.y * cos(angle) * pivot.y + pivot.y + origin.y - pivot.x * scale.y * sin(angle), 0, 1\n"
         "   ) * vec4(xy, 0, 1);\n"
         "   fragmentUV = uv;\n"
+        "   fragmentTint = tint;\n"
         "}\n";
 
     const char* const FragmentCompatHeader =
@@ -53,12 +56,13 @@ namespace plum
         "uniform sampler2D image;\n"
         "uniform float hasImage;\n"
         "in vec2 fragmentUV;\n"
+        "in vec4 fragmentTint;\n"
         "#ifndef outColor\n"
         "out vec4 outColor;\n"
         "#endif\n"
         "void main()\n"
         "{\n"
-        "    outColor = hasImage * texture(image, fragmentUV) * color + (1 - hasImage) * color;\n"
+        "    outColor = (hasImage * texture(image, fragmentUV) * color + (1 - hasImage) * color) * fragmentTint;\n"
         "}\n";
 
     Engine::Impl::Impl()
@@ -136,6 +140,8 @@ namespace plum
         program = glCreateProgram();
         glAttachShader(program, vertexShader);
         glAttachShader(program, fragmentShader);
+        // Keep position at attribute 0, since legacy contexts require 0 to be an enabled array.
+        glBindAttribLocation(program, 0, "xy");
         if(core)
         {
             glBindFragDataLocation(fragmentShader, 0, "outColor");
@@ -163,6 +169,8 @@ namespace plum
         hasImageUniform = glGetUniformLocation(program, "hasImage");
         xyAttribute = glGetAttribLocation(program, "xy");
         uvAttribute = glGetAttribLocation(program, "uv");
+        tintAttribute = glGetAttribLocation(program, "tint");
+        resetTint();
     }
 
     Engine::Impl::~Impl()
@@ -171,6 +179,13 @@ namespace plum
         glfwTerminate();
     }
 
+    void Engine::Impl::resetTint()
+    {
+        // Per-vertex tint is only used by batched draws, everything else gets a constant white.
+        glDisableVertexAttribArray(tintAttribute);
+        glVertexAttrib4f(tintAttribute, 1.f, 1.f, 1.f, 1.f);
+    }
+
     void Engine::Impl::quit(const std::string& message)
     {
         if(message.length())
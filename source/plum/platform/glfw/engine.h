@@ -124,7 +124,7 @@ namespace plum
             GLuint fragmentShader;
             GLuint vertexShader;
             GLint projectionUniform, originUniform, pivotUniform, scaleUniform, angleUniform, colorUniform, hasImageUniform;
-            GLint xyAttribute, uvAttribute;
+            GLint xyAttribute, uvAttribute, tintAttribute;
 
             bool windowless;
 
@@ -133,6 +133,7 @@ namespace plum
 
             void quit(const std::string& message);
             void refresh();
+            void resetTint();
     };
 }
 
@@ -73,7 +73,12 @@ namespace plum
     };
 
     Image::Image(const Canvas& source)
-        : impl(new Impl(source))
+        : impl(new Impl(source)), shared(false)
+    {
+    }
+
+    Image::Image(const std::shared_ptr<Impl>& impl)
+        : impl(impl), shared(true)
     {
     }
 
@@ -83,6 +88,11 @@ namespace plum
 
     Canvas& Image::canvas()
     {
+        if(shared)
+        {
+            impl = std::make_shared<Impl>(impl->canvas);
+            shared = false;
+        }
         return impl->canvas;
     }
 
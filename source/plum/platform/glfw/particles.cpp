@@ -0,0 +1,154 @@
+#include <cmath>
+
+#include "engine.h"
+#include "../../core/image.h"
+#include "../../core/sheet.h"
+#include "../../core/screen.h"
+#include "../../core/transform.h"
+#include "../../core/particles.h"
+
+namespace plum
+{
+    namespace
+    {
+        // Two triangles per particle, each vertex is x, y, u, v, r, g, b, a.
+        const size_t VertexSize = 8;
+        const size_t VerticesPerParticle = 6;
+    }
+
+    class ParticleSystem::Impl
+    {
+        public:
+            Impl()
+                : vbo(0), bufferSize(0)
+            {
+                glGenBuffers(1, &vbo);
+            }
+
+            ~Impl()
+            {
+                glDeleteBuffers(1, &vbo);
+            }
+
+            std::vector<GLfloat> vertices;
+            GLuint vbo;
+            size_t bufferSize;
+    };
+
+    ParticleSystem::ParticleSystem(size_t capacity)
+        : impl(new Impl()),
+        count(0),
+        capacity(0),
+        gravityX(0.0f),
+        gravityY(0.0f),
+        drag(0.0f),
+        mode(BlendMode::Preserve),
+        seed(2463534242u)
+    {
+        resize(capacity);
+    }
+
+    ParticleSystem::~ParticleSystem()
+    {
+    }
+
+    void ParticleSystem::draw(Image& img, const Sheet& sheet, int dx, int dy, Screen& dest)
+    {
+        if(!count)
+        {
+            return;
+        }
+
+        const float DegreesToRadians = float(M_PI / 180.0);
+        const float w = float(sheet.getWidth());
+        const float h = float(sheet.getHeight());
+        const float halfWidth = w / 2;
+        const float halfHeight = h / 2;
+        // Read through a const reference, so a shared image isn't copied.
+        const Canvas& texture(static_cast<const Image&>(img).canvas());
+        const float textureWidth = float(texture.getTrueWidth());
+        const float textureHeight = float(texture.getTrueHeight());
+
+        auto& vertices(impl->vertices);
+        vertices.resize(count * VerticesPerParticle * VertexSize);
+
+        size_t k = 0;
+        for(size_t i = 0; i < count; ++i)
+        {
+            int age = maxLife[i] - life[i];
+            int frame = frameStart[i] + (frameEnd[i] - frameStart[i] + 1) * age / maxLife[i];
+            int sx = 0;
+            int sy = 0;
+            sheet.getFrame(frame, sx, sy);
+
+            float u = float(sx) / textureWidth;
+            float v = float(sy) / textureHeight;
+            float u2 = float(sx + w) / textureWidth;
+            float v2 = float(sy + h) / textureHeight;
+
+            uint8_t r, g, b, a;
+            Color(tint[i]).channels(r, g, b, a);
+            float cr = r / 255.0f;
+            float cg = g / 255.0f;
+            float cb = b / 255.0f;
+            float ca = a / 255.0f;
+            if(fade[i])
+            {
+                ca *= float(life[i]) / maxLife[i];
+            }
+
+            // Rotate the frame's corners around its center.
+            float c = std::cos(angle[i] * DegreesToRadians);
+            float s = std::sin(angle[i] * DegreesToRadians);
+            float cx = x[i];
+            float cy = y[i];
+            float x1 = cx + (-halfWidth * c + halfHeight * s);
+            float y1 = cy + (-halfWidth * s - halfHeight * c);
+            float x2 = cx + (-halfWidth * c - halfHeight * s);
+            float y2 = cy + (-halfWidth * s + halfHeight * c);
+            float x3 = cx + (halfWidth * c - halfHeight * s);
+            float y3 = cy + (halfWidth * s + halfHeight * c);
+            float x4 = cx + (halfWidth * c + halfHeight * s);
+            float y4 = cy + (halfWidth * s - halfHeight * c);
+
+            vertices[k++] = x1; vertices[k++] = y1; vertices[k++] = u; vertices[k++] = v;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+            vertices[k++] = x2; vertices[k++] = y2; vertices[k++] = u; vertices[k++] = v2;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+            vertices[k++] = x3; vertices[k++] = y3; vertices[k++] = u2; vertices[k++] = v2;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+            vertices[k++] = x3; vertices[k++] = y3; vertices[k++] = u2; vertices[k++] = v2;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+            vertices[k++] = x4; vertices[k++] = y4; vertices[k++] = u2; vertices[k++] = v;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+            vertices[k++] = x1; vertices[k++] = y1; vertices[k++] = u; vertices[k++] = v;
+            vertices[k++] = cr; vertices[k++] = cg; vertices[k++] = cb; vertices[k++] = ca;
+        }
+
+        Transform transform;
+        transform.mode = mode;
+
+        dest.bindImage(img);
+        dest.applyTransform(transform, dx, dy, 0, 0);
+
+        glBindBuffer(GL_ARRAY_BUFFER, impl->vbo);
+        if(impl->bufferSize < vertices.size())
+        {
+            impl->bufferSize = vertices.size();
+            glBufferData(GL_ARRAY_BUFFER, impl->bufferSize * sizeof(GLfloat), nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(GLfloat), vertices.data());
+
+        auto& e(dest.engine().impl);
+        glVertexAttribPointer(e->xyAttribute, 2, GL_FLOAT, false, VertexSize * sizeof(GLfloat), (void*) 0);
+        glVertexAttribPointer(e->uvAttribute, 2, GL_FLOAT, false, VertexSize * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+        glVertexAttribPointer(e->tintAttribute, 4, GL_FLOAT, false, VertexSize * sizeof(GLfloat), (void*)(4 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(e->xyAttribute);
+        glEnableVertexAttribArray(e->uvAttribute);
+        glEnableVertexAttribArray(e->tintAttribute);
+        glDrawArrays(GL_TRIANGLES, 0, GLsizei(count * VerticesPerParticle));
+        e->resetTint();
+
+        dest.unbindImage();
+    }
+}
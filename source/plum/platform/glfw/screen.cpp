@@ -491,6 +491,7 @@ namespace plum
         }
 
         glUseProgram(engine.impl->program);
+        engine.impl->resetTint();
         {
             float left = 0;
             float right = float(width);
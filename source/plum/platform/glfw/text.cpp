@@ -0,0 +1,128 @@
+#include "engine.h"
+#include "../../core/image.h"
+#include "../../core/sheet.h"
+#include "../../core/screen.h"
+#include "../../core/transform.h"
+#include "../../core/text.h"
+
+namespace plum
+{
+    namespace
+    {
+        // Two triangles per glyph, each vertex is x, y, u, v.
+        const size_t VertexSize = 4;
+        const size_t VerticesPerGlyph = 6;
+    }
+
+    class Text::Impl
+    {
+        public:
+            Impl()
+                : vbo(0), vertexCount(0), bufferSize(0), builtRevision(0)
+            {
+                glGenBuffers(1, &vbo);
+            }
+
+            ~Impl()
+            {
+                glDeleteBuffers(1, &vbo);
+            }
+
+            std::vector<GLfloat> vertices;
+            GLuint vbo;
+            size_t vertexCount;
+            size_t bufferSize;
+            unsigned int builtRevision;
+    };
+
+    Text::Text(Font& font, const std::string& text)
+        : impl(new Impl()),
+        font(&font),
+        text(text),
+        align(TextAlign::Left),
+        width(0),
+        height(0),
+        dirty(true),
+        fontRevision(0),
+        layoutRevision(0)
+    {
+    }
+
+    Text::~Text()
+    {
+    }
+
+    void Text::draw(int x, int y, Screen& dest)
+    {
+        draw(x, y, Transform(), dest);
+    }
+
+    void Text::draw(int x, int y, const Transform& transform, Screen& dest)
+    {
+        update();
+
+        Image& image(font->getImage());
+        const Sheet& sheet(font->getSheet());
+
+        dest.bindImage(image);
+
+        glBindBuffer(GL_ARRAY_BUFFER, impl->vbo);
+        if(impl->builtRevision != layoutRevision)
+        {
+            const float w = float(sheet.getWidth());
+            const float h = float(sheet.getHeight());
+            const Canvas& texture(static_cast<const Image&>(image).canvas());
+            const float textureWidth = float(texture.getTrueWidth());
+            const float textureHeight = float(texture.getTrueHeight());
+
+            auto& vertices(impl->vertices);
+            vertices.resize(glyphs.size() * VerticesPerGlyph * VertexSize);
+
+            size_t k = 0;
+            for(const auto& glyph : glyphs)
+            {
+                int sx, sy;
+                if(!sheet.getFrame(glyph.frame, sx, sy))
+                {
+                    continue;
+                }
+
+                float fx = float(glyph.x);
+                float fy = float(glyph.y);
+                float u = float(sx) / textureWidth;
+                float v = float(sy) / textureHeight;
+                float u2 = float(sx + w) / textureWidth;
+                float v2 = float(sy + h) / textureHeight;
+
+                vertices[k++] = fx; vertices[k++] = fy; vertices[k++] = u; vertices[k++] = v;
+                vertices[k++] = fx; vertices[k++] = fy + h; vertices[k++] = u; vertices[k++] = v2;
+                vertices[k++] = fx + w; vertices[k++] = fy + h; vertices[k++] = u2; vertices[k++] = v2;
+                vertices[k++] = fx + w; vertices[k++] = fy + h; vertices[k++] = u2; vertices[k++] = v2;
+                vertices[k++] = fx + w; vertices[k++] = fy; vertices[k++] = u2; vertices[k++] = v;
+                vertices[k++] = fx; vertices[k++] = fy; vertices[k++] = u; vertices[k++] = v;
+            }
+
+            impl->vertexCount = k / VertexSize;
+            if(impl->bufferSize < k)
+            {
+                impl->bufferSize = k;
+                glBufferData(GL_ARRAY_BUFFER, impl->bufferSize * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, 0, k * sizeof(GLfloat), vertices.data());
+            impl->builtRevision = layoutRevision;
+        }
+
+        // The pivot sits in the middle of the text block, which starts left of the anchor for centered or right aligned text.
+        int left = align == TextAlign::Center ? -width / 2 : align == TextAlign::Right ? -width : 0;
+        dest.applyTransform(transform, x, y, 2 * left + width, height);
+
+        auto& e(dest.engine().impl);
+        glVertexAttribPointer(e->xyAttribute, 2, GL_FLOAT, false, VertexSize * sizeof(GLfloat), (void*) 0);
+        glVertexAttribPointer(e->uvAttribute, 2, GL_FLOAT, false, VertexSize * sizeof(GLfloat), (void*)(2 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(e->xyAttribute);
+        glEnableVertexAttribArray(e->uvAttribute);
+        glDrawArrays(GL_TRIANGLES, 0, GLsizei(impl->vertexCount));
+
+        dest.unbindImage();
+    }
+}
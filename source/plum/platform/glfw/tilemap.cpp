@@ -60,6 +60,8 @@ namespace plum
         if(modified)
         {
             auto& vertices(impl->vertices);
+            // Read through a const reference, so a shared image isn't copied.
+            const Canvas& texture(static_cast<const Image&>(img).canvas());
 
             float vx = 0;
             float vy = 0;
@@ -72,10 +74,10 @@ namespace plum
                     int sy = 0;
                     sheet.getFrame(data[i * width + j], sx, sy);
 
-                    float u = float(sx) / img.canvas().getTrueWidth();
-                    float v = float(sy) / img.canvas().getTrueHeight();
-                    float u2 = float(sx + sheet.getWidth()) / img.canvas().getTrueWidth();
-                    float v2 = float(sy + sheet.getHeight()) / img.canvas().getTrueHeight();
+                    float u = float(sx) / texture.getTrueWidth();
+                    float v = float(sy) / texture.getTrueHeight();
+                    float u2 = float(sx + sheet.getWidth()) / texture.getTrueWidth();
+                    float v2 = float(sy + sheet.getHeight()) / texture.getTrueHeight();
 
                     vertices[k++] = vx; vertices[k++] = vy; vertices[k++] = u; vertices[k++] = v;
                     vertices[k++] = vx; vertices[k++] = vy + sheet.getHeight(); vertices[k++] = u; vertices[k++] = v2;
@@ -1,8 +1,12 @@
 #include <iostream>
-#include <unordered_set>
+#include <vector>
+#include <cstdint>
 #include <functional>
+#include <cmath>
+#include <map>
 #include <plaid/audio.h>
 #include <plaid/audio/effects.h>
+#include <plaid/audio/util.h>
 
 #include "../../core/file.h"
 #include "../../core/audio.h"
@@ -10,10 +14,86 @@
 
 namespace
 {
+    const int DefaultMaxVoices = 64;
+    const int PanTableSize = 256;
+    const double SpeedOfSound = 343.0;
+    const double MaxEchoDecay = 0.95;
+
+    // Constant power pan gains for positions from 0 to 1, so channels can be panned without calling sin.
+    class PanTable
+    {
+        public:
+            PanTable()
+            {
+                for(int i = 0; i <= PanTableSize; ++i)
+                {
+                    gains[i] = float(sin(double(i) / PanTableSize * M_PI_2));
+                }
+            }
+
+            float operator()(double position) const
+            {
+                position = std::min(std::max(position, 0.0), 1.0) * PanTableSize;
+                int i = std::min(int(position), PanTableSize - 1);
+                float t = float(position - i);
+                return gains[i] + (gains[i + 1] - gains[i]) * t;
+            }
+
+        private:
+            float gains[PanTableSize + 1];
+    };
+
+    const PanTable panGain;
+
+    plaidgadget::Uint32 getAlgorithm(plum::Resampler resampler)
+    {
+        switch(resampler)
+        {
+            case plum::Resampler::Linear: return plaidgadget::Pitch::LINEAR;
+            case plum::Resampler::Sinc8: return plaidgadget::Pitch::SINC_8;
+            case plum::Resampler::Sinc32: return plaidgadget::Pitch::SINC_32;
+            default: return plaidgadget::Pitch::HERMITE;
+        }
+    }
+
+    // The lead is subtracted from the sample, for things that take that long to be heard once started.
+    plaidgadget::Uint64 getSample(plaidgadget::Audio& audio, double time, double lead)
+    {
+        double sample = std::floor(time * audio.format().rate + 0.5) - lead;
+        return sample > 0.0 ? plaidgadget::Uint64(sample) : 0;
+    }
+
+    plaidgadget::AudioSettings convertSettings(const plum::AudioSettings& settings)
+    {
+        plaidgadget::AudioSettings result;
+        result.rate = plaidgadget::Uint32(std::max(settings.rate, 0));
+        result.frames = plaidgadget::Uint32(std::max(settings.frames, 0));
+        result.latency = std::max(settings.latency, 0) / 1000.0;
+        result.api = plaidgadget::String(settings.api.begin(), settings.api.end());
+        result.device = plaidgadget::String(settings.device.begin(), settings.device.end());
+        result.autoLatency = settings.autoLatency;
+        result.listDevices = settings.listDevices;
+        return result;
+    }
 }
 
 namespace plum
 {
+    class Sound::Impl
+    {
+        public:
+            Impl()
+                : filename(nullptr), polyphony(0), priority(0)
+            {
+            }
+
+            // Shared through the resource cache with other sounds loaded from the same file. The limits below
+            // aren't, so that each sound keeps its own, and its voices are only counted against it.
+            std::shared_ptr<plaidgadget::String> filename;
+            int polyphony;
+            int priority;
+    };
+
     class Channel::Impl
     {
         public:
@@ -26,14 +106,32 @@ namespace plum
             bool looped;
             double pan, pitch, volume;
 
+            // The sound this voice belongs to, or null for music, which isn't part of the voice limits.
+            std::shared_ptr<Sound::Impl> sound;
+            // Whatever loaded the voice, for making room when it's played again.
+            std::weak_ptr<Audio::Impl> owner;
+            int priority;
+            // Counts up with every voice loaded, so older voices have smaller numbers.
+            uint64_t serial;
+            plaidgadget::AudioFormat format;
+            // Set whenever pan, pitch, volume or a send change, so the effects are only touched when there's something new.
+            bool dirty;
+            std::map<std::string, double> sends;
+
             Impl()
                 : audio(nullptr), master(nullptr), panfx(nullptr), pitchfx(nullptr),
-                dispose(nullptr), looped(false), pan(0.0), pitch(1.0), volume(1.0)
+                dispose(nullptr), looped(false), pan(0.0), pitch(1.0), volume(1.0),
+                sound(nullptr), priority(0), serial(0), dirty(true)
             {
             }
 
     };
 
+    namespace
+    {
+        bool admit(const Channel::Impl& channel);
+    }
+
     Channel::Channel()
         : impl(new Impl())
     {
@@ -49,9 +147,11 @@ namespace plum
 
     void Channel::play()
     {
-        if(impl->master)
+        if(impl->master && admit(*impl))
         {
             impl->audio->play(impl->master);
+            // The mixer forgets sends along with the sound, so a channel played again has to send them again.
+            impl->dirty |= !impl->sends.empty();
         }
     }
 
@@ -71,6 +171,25 @@ namespace plum
         }
     }
 
+    void Channel::playAt(double time)
+    {
+        if(impl->master && admit(*impl))
+        {
+            // Pitch holds the sound back by a few samples, so starting that much early puts it right on time.
+            impl->audio->playAt(impl->master, getSample(*impl->audio, time, plaidgadget::Pitch::DELAY));
+            impl->dirty |= !impl->sends.empty();
+        }
+    }
+
+    void Channel::stopAt(double time)
+    {
+        if(impl->master)
+        {
+            // Stopping cuts the output itself, which isn't held back.
+            impl->audio->stopAt(impl->master, getSample(*impl->audio, time, 0.0));
+        }
+    }
+
     bool Channel::isPlaying() const
     {
         if(impl->master)
@@ -102,27 +221,142 @@ namespace plum
 
     void Channel::setPan(double value)
     {
-        impl->pan = std::min(std::max(value, -1.0), 1.0);
+        value = std::min(std::max(value, -1.0), 1.0);
+        impl->dirty |= value != impl->pan;
+        impl->pan = value;
     }
 
     void Channel::setPitch(double value)
     {
-        impl->pitch = std::max(value, 0.0);
+        value = std::max(value, 0.0);
+        impl->dirty |= value != impl->pitch;
+        impl->pitch = value;
     }
 
     void Channel::setVolume(double value)
     {
-        impl->volume = std::min(std::max(value, 0.0), 1.0);
+        value = std::min(std::max(value, 0.0), 1.0);
+        impl->dirty |= value != impl->volume;
+        impl->volume = value;
     }
 
+    const std::map<std::string, double>& Channel::getSends() const
+    {
+        return impl->sends;
+    }
 
+    double Channel::getSend(const std::string& bus) const
+    {
+        auto it = impl->sends.find(bus);
+        return it != impl->sends.end() ? it->second : 0.0;
+    }
 
-    class Sound::Impl
+    void Channel::setSend(const std::string& bus, double value)
+    {
+        value = std::min(std::max(value, 0.0), 1.0);
+        impl->dirty |= value != getSend(bus);
+        impl->sends[bus] = value;
+    }
+
+
+
+    class Bus::Impl
     {
         public:
-            plaidgadget::String filename;
+            Impl()
+                : audio(nullptr), input(nullptr), filter(nullptr), reverb(nullptr),
+                volume(1.0), lowpass(0.0), highpass(0.0)
+            {
+            }
+
+            std::shared_ptr<plaidgadget::Audio> audio;
+            // What channels send to. It stays null if the mixer is out of buses, and then the sends go nowhere.
+            plaidgadget::Sound input;
+            plaidgadget::Ref<plaidgadget::Bandpass> filter;
+            plaidgadget::Ref<plaidgadget::Reverb> reverb;
+            double volume, lowpass, highpass;
     };
 
+    Bus::Bus()
+        : impl(new Impl())
+    {
+    }
+
+    Bus::~Bus()
+    {
+    }
+
+    double Bus::getVolume() const
+    {
+        return impl->volume;
+    }
+
+    double Bus::getLowpass() const
+    {
+        return impl->lowpass;
+    }
+
+    double Bus::getHighpass() const
+    {
+        return impl->highpass;
+    }
+
+    void Bus::setVolume(double value)
+    {
+        impl->volume = std::max(value, 0.0);
+        if(impl->reverb)
+        {
+            impl->audio->volume(plaidgadget::Sound(impl->reverb), float(impl->volume));
+        }
+    }
+
+    void Bus::setLowpass(double value)
+    {
+        impl->lowpass = std::max(value, 0.0);
+        if(impl->filter)
+        {
+            impl->filter->bandpass(float(impl->lowpass), float(impl->highpass));
+        }
+    }
+
+    void Bus::setHighpass(double value)
+    {
+        impl->highpass = std::max(value, 0.0);
+        if(impl->filter)
+        {
+            impl->filter->bandpass(float(impl->lowpass), float(impl->highpass));
+        }
+    }
+
+    void Bus::setReverb(double wet, double depth)
+    {
+        if(impl->reverb)
+        {
+            // The dry sound is already in the mix, so the bus only returns the reflections.
+            if(wet > 0.0)
+            {
+                impl->reverb->reverb(0.0f, float(wet), float(std::max(depth, 0.0)));
+            }
+            else
+            {
+                impl->reverb->clearDelays();
+                impl->reverb->addDelaySamples(0, 1.0f);
+            }
+        }
+    }
+
+    void Bus::setEcho(double distance, double decay)
+    {
+        if(impl->reverb)
+        {
+            impl->reverb->clearDelays();
+            decay = std::min(std::max(decay, -MaxEchoDecay), MaxEchoDecay);
+            impl->reverb->addDelaySeconds(float(std::max(distance, 0.0) / SpeedOfSound), float(decay));
+        }
+    }
+
+
+
     Sound::Sound()
         : impl(new Impl())
     {
@@ -132,15 +366,47 @@ namespace plum
     {
     }
 
+    int Sound::getPolyphony() const
+    {
+        return impl->polyphony;
+    }
+
+    int Sound::getPriority() const
+    {
+        return impl->priority;
+    }
+
+    void Sound::setPolyphony(int value)
+    {
+        impl->polyphony = std::max(value, 0);
+    }
+
+    void Sound::setPriority(int value)
+    {
+        impl->priority = value;
+    }
+
 
 
     class Audio::Impl
     {
         public:
-            Impl(Engine& engine, bool disabled)
-                : engine(engine), disabled(disabled), pan(0.0), pitch(1.0), volume(1.0),
-                audio(new plaidgadget::Audio(disabled))
+            // The effects that sit between a stream and the mixer, kept around after a voice ends so the next one can reuse them.
+            struct Chain
             {
+                plaidgadget::Ref<plaidgadget::Pitch> pitchfx;
+                plaidgadget::Ref<plaidgadget::Pan> panfx;
+                plaidgadget::Sound master;
+                plaidgadget::AudioFormat format;
+            };
+
+            Impl(Engine& engine, bool disabled, const AudioSettings& settings)
+                : engine(engine), disabled(disabled), pan(0.0), pitch(1.0), volume(1.0), dirty(false),
+                maxVoices(DefaultMaxVoices), steal(VoiceSteal::Oldest), resampler(Resampler::Cubic), serial(0),
+                audio(new plaidgadget::Audio(disabled, convertSettings(settings)))
+            {
+                channels.reserve(DefaultMaxVoices);
+                spare.reserve(DefaultMaxVoices);
                 hook = engine.addUpdateHook([this](){ update(); });
             }
 
@@ -155,39 +421,255 @@ namespace plum
                     return;
                 }
 
-                for(auto it = channels.begin(), end = channels.end(); it != end;)
+                // A change to the master pan, pitch or resampler has to reach every channel.
+                bool all = dirty;
+                dirty = false;
+
+                for(size_t i = 0; i < channels.size();)
                 {
-                    const auto& c(*it);
+                    const auto& c(channels[i]);
 
-                    c->pitchfx->rate(float(c->pitch * pitch));
-                    c->panfx->left(float(c->volume * sin(std::min(1.0 - c->pan, 1.0) * std::min(1.0 - pan, 1.0) * M_PI_2)));
-                    c->panfx->right(float(c->volume * sin(std::min(1.0 + c->pan, 1.0) * std::min(1.0 + pan, 1.0) * M_PI_2)));
+                    if(c->dirty || all)
+                    {
+                        c->pitchfx->resampling(getAlgorithm(resampler));
+                        c->pitchfx->rate(float(c->pitch * pitch));
+                        c->panfx->left(float(c->volume) * panGain(std::min(1.0 - c->pan, 1.0) * std::min(1.0 - pan, 1.0)));
+                        c->panfx->right(float(c->volume) * panGain(std::min(1.0 + c->pan, 1.0) * std::min(1.0 + pan, 1.0)));
+                        // Sending to a sound the mixer has let go of would add it back, so wait until it's played.
+                        for(const auto& send : c->sends)
+                        {
+                            const auto& bus(getBus(send.first).impl);
+                            if(bus->input && audio->has(c->master))
+                            {
+                                audio->send(c->master, bus->input, float(send.second));
+                            }
+                        }
+                        c->dirty = false;
+                    }
+
+                    if(*c->dispose && !audio->playing(c->master))
+                    {
+                        release(i);
+                    }
+                    else
+                    {
+                        ++i;
+                    }
+                }
 
-                    if((!audio->playing(c->master) || c->looped) && *c->dispose)
+                // The mixer lets go of dropped streams a little while after being told to.
+                for(size_t i = 0; i < retiring.size();)
+                {
+                    if(!audio->has(retiring[i].master))
                     {
-                        it = channels.erase(it);
+                        recycle(retiring[i]);
+                        retiring[i] = retiring.back();
+                        retiring.pop_back();
                     }
                     else
                     {
-                        ++it;
+                        ++i;
                     }
                 }
 
                 audio->update();
             }
 
+            // Voices only count while they're in the mixer, so ones that have finished or been stopped don't hold a place.
+            bool isVoice(const Channel::Impl& c) const
+            {
+                return c.sound && audio->has(c.master);
+            }
+
+            int countVoices(const std::shared_ptr<Sound::Impl>& sound, int& same) const
+            {
+                int count = 0;
+                same = 0;
+                for(const auto& c : channels)
+                {
+                    if(isVoice(*c))
+                    {
+                        ++count;
+                        if(c->sound == sound)
+                        {
+                            ++same;
+                        }
+                    }
+                }
+                return count;
+            }
+
+            // Whether voice a should be stolen before voice b.
+            bool before(const Channel::Impl& a, const Channel::Impl& b) const
+            {
+                if(a.priority != b.priority)
+                {
+                    return a.priority < b.priority;
+                }
+                if(steal == VoiceSteal::Quietest && a.volume != b.volume)
+                {
+                    return a.volume < b.volume;
+                }
+                return a.serial < b.serial;
+            }
+
+            // Steals voices until the sound is under both its own limit and the global one. Returns false if a voice
+            // had to go but every candidate has a higher priority than the sound.
+            bool makeRoom(const std::shared_ptr<Sound::Impl>& sound)
+            {
+                while(true)
+                {
+                    int same;
+                    int count = countVoices(sound, same);
+                    bool limited = sound->polyphony > 0 && same >= sound->polyphony;
+                    if(!limited && (maxVoices == 0 || count < maxVoices))
+                    {
+                        return true;
+                    }
+
+                    // When the sound is over its own limit, only its own voices are up for stealing.
+                    size_t victim = channels.size();
+                    for(size_t i = 0; i < channels.size(); ++i)
+                    {
+                        const auto& c(channels[i]);
+                        if(isVoice(*c) && (!limited || c->sound == sound) && c->priority <= sound->priority
+                            && (victim == channels.size() || before(*c, *channels[victim])))
+                        {
+                            victim = i;
+                        }
+                    }
+
+                    if(victim == channels.size())
+                    {
+                        return false;
+                    }
+                    release(victim);
+                }
+            }
+
+            // Stops tracking a channel and takes back its effects chain if it was a voice. The channel is left silent.
+            void release(size_t index)
+            {
+                auto c(channels[index]);
+                channels[index] = channels.back();
+                channels.pop_back();
+
+                Chain chain;
+                chain.pitchfx = c->pitchfx;
+                chain.panfx = c->panfx;
+                chain.master = c->master;
+                chain.format = c->format;
+
+                if(audio->has(c->master))
+                {
+                    audio->stop(c->master);
+                    if(c->sound)
+                    {
+                        retiring.push_back(chain);
+                    }
+                }
+                else if(c->sound)
+                {
+                    recycle(chain);
+                }
+
+                c->master = nullptr;
+                c->pitchfx = nullptr;
+                c->panfx = nullptr;
+            }
+
+            void recycle(const Chain& chain)
+            {
+                if(maxVoices == 0 || int(spare.size()) < maxVoices)
+                {
+                    // Let go of the old stream now, rather than holding its file open until the chain is reused.
+                    chain.pitchfx->rebind(plaidgadget::Signal());
+                    spare.push_back(chain);
+                }
+            }
+
+            Bus& getBus(const std::string& name)
+            {
+                auto it = buses.find(name);
+                if(it != buses.end())
+                {
+                    return it->second;
+                }
+
+                Bus& bus(buses[name]);
+                bus.impl->audio = audio;
+                bus.impl->input = disabled ? plaidgadget::Sound(nullptr) : audio->bus();
+                if(bus.impl->input)
+                {
+                    bus.impl->filter = new plaidgadget::Bandpass(plaidgadget::Signal(bus.impl->input));
+                    bus.impl->reverb = new plaidgadget::Reverb(plaidgadget::Signal(plaidgadget::Sound(bus.impl->filter)), 1.0f, 0.0f);
+                    audio->busReturn(bus.impl->input, plaidgadget::Sound(bus.impl->reverb));
+                }
+                return bus;
+            }
+
+            // Builds a chain for the stream, reusing a spare one if there's one for the same format.
+            Chain attach(plaidgadget::Sound stream)
+            {
+                plaidgadget::Signal source(stream);
+                plaidgadget::AudioFormat format(source.format());
+                for(size_t i = 0; i < spare.size(); ++i)
+                {
+                    if(spare[i].format == format)
+                    {
+                        Chain chain(spare[i]);
+                        spare[i] = spare.back();
+                        spare.pop_back();
+
+                        chain.pitchfx->rebind(source);
+                        chain.panfx->reset();
+                        return chain;
+                    }
+                }
+
+                Chain chain;
+                chain.pitchfx = new plaidgadget::Pitch(source);
+                chain.panfx = new plaidgadget::Pan(plaidgadget::Sound(chain.pitchfx));
+                chain.master = plaidgadget::Sound(chain.panfx);
+                chain.format = format;
+                return chain;
+            }
+
             Engine& engine;
             std::shared_ptr<Engine::UpdateHook> hook;
 
             bool disabled;
             double pan, pitch, volume;
+            bool dirty;
+            int maxVoices;
+            VoiceSteal steal;
+            Resampler resampler;
+            uint64_t serial;
 
             std::shared_ptr<plaidgadget::Audio> audio;
-            std::unordered_set<std::shared_ptr<Channel::Impl>> channels;
+            std::vector<std::shared_ptr<Channel::Impl>> channels;
+            // Chains of voices that were cut off, waiting for the mixer to let go of them.
+            std::vector<Chain> retiring;
+            std::vector<Chain> spare;
+            std::map<std::string, Bus> buses;
     };
 
-    Audio::Audio(Engine& engine, bool disabled)
-        : impl(new Impl(engine, disabled))
+    namespace
+    {
+        // A voice the mixer has let go of takes up a voice again when it's played, so it has to fit within the limits.
+        bool admit(const Channel::Impl& channel)
+        {
+            if(!channel.sound || channel.audio->has(channel.master))
+            {
+                return true;
+            }
+            auto owner = channel.owner.lock();
+            return !owner || owner->makeRoom(channel.sound);
+        }
+    }
+
+    Audio::Audio(Engine& engine, bool disabled, const AudioSettings& settings)
+        : impl(new Impl(engine, disabled, settings))
     {
     }
 
@@ -201,32 +683,127 @@ namespace plum
         {
             return;
         }
-        plaidgadget::String fn(filename.begin(), filename.end());
-        sound.impl->filename = fn;
+
+        // Sounds are streamed as they play, so all that's held is the name. That costs too little to be worth
+        // putting in the resource cache.
+        sound.impl->filename = std::make_shared<plaidgadget::String>(filename.begin(), filename.end());
     }
 
-    void Audio::loadChannel(const Sound& sound, bool looped, Channel& channel)
+    void Audio::loadChannel(const Sound& sound, bool looped, bool prefetch, Channel& channel)
     {
-        if(impl->disabled)
+        if(impl->disabled || !sound.impl->filename)
+        {
+            return;
+        }
+
+        if(!prefetch && !impl->makeRoom(sound.impl))
         {
             return;
         }
 
-        plaidgadget::Sound stream(impl->audio->stream(sound.impl->filename, looped));
+        plaidgadget::Sound stream(impl->audio->stream(*sound.impl->filename, looped));
         if(!stream.null())
         {
-            plaidgadget::Ref<plaidgadget::Pitch> pitchfx(new plaidgadget::Pitch(stream));
-            plaidgadget::Ref<plaidgadget::Pan> panfx(new plaidgadget::Pan(plaidgadget::Sound(pitchfx)));
-            plaidgadget::Sound master = plaidgadget::Sound(panfx);
+            if(prefetch)
+            {
+                stream = plaidgadget::Sound(new plaidgadget::Prefetch(*impl->audio, stream));
+            }
+
+            Impl::Chain chain(impl->attach(stream));
 
             channel.impl->looped = looped;
             channel.impl->audio = impl->audio;
-            channel.impl->pitchfx = pitchfx;
-            channel.impl->panfx = panfx;
-            channel.impl->master = master;
+            channel.impl->owner = impl;
+            channel.impl->pitchfx = chain.pitchfx;
+            channel.impl->panfx = chain.panfx;
+            channel.impl->master = chain.master;
+            channel.impl->format = chain.format;
+            // The chain might have settings left over from its last voice.
+            channel.impl->dirty = true;
             channel.impl->dispose.reset(new bool(false));
-            impl->channels.insert(channel.impl);
+            if(!prefetch)
+            {
+                channel.impl->sound = sound.impl;
+                channel.impl->priority = sound.impl->priority;
+            }
+            channel.impl->serial = impl->serial++;
+            impl->channels.push_back(channel.impl);
+        }
+    }
+
+    int Audio::getMaxVoices() const
+    {
+        return impl->maxVoices;
+    }
+
+    VoiceSteal Audio::getVoiceSteal() const
+    {
+        return impl->steal;
+    }
+
+    int Audio::getVoiceCount() const
+    {
+        int same;
+        return impl->countVoices(nullptr, same);
+    }
+
+    Resampler Audio::getResampler() const
+    {
+        return impl->resampler;
+    }
+
+    AudioStats Audio::getStats()
+    {
+        AudioStats stats = {};
+        if(!impl->disabled)
+        {
+            plaidgadget::AudioStats s(impl->audio->stats());
+            stats.load = s.load;
+            stats.callbacks = s.callbacks;
+            stats.minCallback = s.minTime * 1000.0;
+            stats.averageCallback = s.avgTime * 1000.0;
+            stats.maxCallback = s.maxTime * 1000.0;
+            stats.underruns = s.underruns;
+            stats.overflows = s.overflows;
+            stats.voices = int(s.voices);
+            stats.stalls = s.stalls;
+            stats.scratchPeak = s.scratchPeak;
+            stats.xruns = s.xruns;
+            stats.frames = s.frames;
+            stats.latency = s.latency * 1000.0;
+        }
+        return stats;
+    }
+
+    Bus Audio::getBus(const std::string& name)
+    {
+        return impl->getBus(name);
+    }
+
+    double Audio::getTime() const
+    {
+        if(impl->disabled)
+        {
+            return 0.0;
         }
+        return double(impl->audio->sampleClock()) / impl->audio->format().rate;
+    }
+
+    void Audio::setMaxVoices(int value)
+    {
+        // Lowering the limit doesn't cut anything off straight away. The next voice played steals enough to get under it.
+        impl->maxVoices = std::max(value, 0);
+    }
+
+    void Audio::setVoiceSteal(VoiceSteal value)
+    {
+        impl->steal = value;
+    }
+
+    void Audio::setResampler(Resampler value)
+    {
+        impl->dirty |= value != impl->resampler;
+        impl->resampler = value;
     }
 
     double Audio::getPan() const
@@ -246,11 +823,13 @@ namespace plum
 
     void Audio::setPan(double value)
     {
+        impl->dirty |= value != impl->pan;
         impl->pan = value;
     }
 
     void Audio::setPitch(double value)
     {
+        impl->dirty |= value != impl->pitch;
         impl->pitch = value;
     }
 
@@ -258,4 +837,4 @@ namespace plum
     {
         impl->volume = value;
     }
-}
\ No newline at end of file
+}
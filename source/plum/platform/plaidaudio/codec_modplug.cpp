@@ -16,7 +16,7 @@ namespace
                 : loop(loop), finished(true)
             {
                 {
-                    std::unique_ptr<plum::File> file(new plum::File(plaidgadget::ToStdString(fn), plum::FileOpenMode::Read));
+                    std::unique_ptr<plum::File> file(new plum::File(plaidgadget::ToStdString(fn), plum::FileOpenMode::Map));
                     // Get current position.
                     unsigned int pos = file->tell();
                     // Length to read = position of end - current.
@@ -24,11 +24,22 @@ namespace
                     file->seek(pos, plum::FileSeekMode::End);
                     length = file->tell() - pos;
                     file->seek(pos, plum::FileSeekMode::Start);
-                    // Read fully.
-                    std::vector<uint8_t> data(length);
-                    file->readRaw(data.data(), data.size());
-                    // Load the mod.
-                    mod = ModPlug_Load(data.data(), data.size());
+
+                    // ModPlug makes its own copy, so a mapped file can be handed over as is.
+                    size_t available = length;
+                    const uint8_t* mapped = file->readInPlace(available);
+                    if(mapped)
+                    {
+                        mod = ModPlug_Load(mapped, int(available));
+                    }
+                    else
+                    {
+                        // Read fully.
+                        std::vector<uint8_t> data(length);
+                        file->readRaw(data.data(), data.size());
+                        // Load the mod.
+                        mod = ModPlug_Load(data.data(), data.size());
+                    }
                 }
                 if(mod)
                 {
@@ -0,0 +1,182 @@
+#include <plaid/audio/implementation.h>
+
+#include <memory>
+#include <limits>
+#include <cstdint>
+
+// stb_vorbis
+#define STB_VORBIS_HEADER_ONLY
+#include <codec_stb/stb_vorbis.c>
+
+#include "../../core/file.h"
+
+namespace
+{
+    class OggStream : public plaidgadget::AudioStream
+    {
+        public:
+            OggStream(plaidgadget::String fn, bool loop)
+                : loop(loop), finished(true), ogg(nullptr)
+            {
+                std::string filename(plaidgadget::ToStdString(fn));
+                int error = 0;
+
+                // Mapped files and pack entries are already in memory, so the decoder can read them in place.
+                file.reset(new plum::File(filename, plum::FileOpenMode::Map));
+                size_t length = std::numeric_limits<int>::max();
+                const uint8_t* data = file->readInPlace(length);
+                if(data)
+                {
+                    ogg = stb_vorbis_open_memory((unsigned char*) data, int(length), &error, nullptr);
+                }
+                else
+                {
+                    file.reset();
+                    ogg = stb_vorbis_open_filename(&filename[0], &error, nullptr);
+                }
+
+                if(ogg)
+                {
+                    stb_vorbis_info info = stb_vorbis_get_info(ogg);
+                    output.channels = info.channels;
+                    output.rate = info.sample_rate;
+
+                    finished = false;
+                }
+            }
+
+            virtual ~OggStream()
+            {
+                if(ogg)
+                {
+                    stb_vorbis_close(ogg);
+                }
+            }
+
+            bool success()
+            {
+                return ogg != nullptr;
+            }
+
+            virtual plaidgadget::AudioFormat format()
+            {
+                return output;
+            }
+
+            virtual bool exhausted()
+            {
+                return finished;
+            }
+
+            virtual void tick(plaidgadget::Uint64 frame)
+            {
+            }
+
+            virtual void pull(plaidgadget::AudioChunk& chunk)
+            {
+                if(!chunk.length())
+                {
+                    return;
+                }
+
+                if(!ogg || finished)
+                {
+                    chunk.silence();
+                    return;
+                }
+
+                int have = 0;
+                int need = chunk.length();
+
+                // Create pointers to 16-bit data
+                int16_t* d16[PG_MAX_CHANNELS];
+                for(plaidgadget::Uint32 i = 0; i < chunk.format().channels; ++i)
+                {
+                    d16[i] = (int16_t*) chunk.start(i);
+                }
+
+                while(true)
+                {
+                    int samples = stb_vorbis_get_samples_short(ogg, chunk.format().channels, d16, need - have);
+
+                    if(samples < 0)
+                    {
+                        finished = true;
+                        break;
+                    }
+                    if(samples == 0)
+                    {
+                        // File's end
+                        if(loop)
+                        {
+                            stb_vorbis_seek_start(ogg);
+                            continue;
+                        }
+                        else
+                        {
+                            finished = true;
+                            break;
+                        }
+                    }
+
+                    for(plaidgadget::Uint32 i = 0; i < chunk.format().channels; ++i)
+                    {
+                        d16[i] += samples;
+                    }
+                    have += samples;
+
+                    if(have >= need)
+                    {
+                        break;
+                    }
+                }
+
+                // Cutoff marker if necessary
+                if(have < need)
+                {
+                    chunk.cutoff(have);
+                }
+                // Upsample data to 24-bit Sint32s
+                for(plaidgadget::Uint32 i = 0; i < chunk.format().channels; ++i)
+                {
+                    plaidgadget::Sint32* start = chunk.start(i);
+                    plaidgadget::Sint32* op = start + have;
+                    int16_t* ip = d16[i];
+                    while(op != start)
+                    {
+                        *--op = plaidgadget::Sint32(*--ip) << 8;
+                    }
+                }
+            }
+
+        private:
+            bool loop, finished;
+            plaidgadget::AudioFormat output;
+            std::unique_ptr<plum::File> file;
+            stb_vorbis* ogg;
+    };
+
+    class Codec : public plaidgadget::AudioCodec
+    {
+        public:
+            Codec()
+                : AudioCodec(L"ogg,ogv")
+            {
+            }
+
+            virtual ~Codec()
+            {
+            }
+
+            virtual plaidgadget::Sound stream(const plaidgadget::String& file, bool loop)
+            {
+                OggStream* ogg = new OggStream(file, loop);
+                if(!ogg->success())
+                {
+                    delete ogg;
+                    return plaidgadget::Sound();
+                }
+                return plaidgadget::Sound(ogg);
+            }
+    } codec;
+}
@@ -4,9 +4,12 @@
 #include "core/engine.h"
 #include "core/timer.h"
 #include "core/input.h"
+#include "core/pack.h"
 #include "script/script.h"
 
 #include <cstdio>
+#include <sstream>
+#include <algorithm>
 #include <cstdlib>
 #include <stdexcept>
 
@@ -55,7 +58,18 @@ int main(int argc, char** argv)
 {
     try
     {
+        // Mounted before anything else is read, so the config can live in it too.
+        plum::mountPack("data.pak");
+
         plum::Config config("plum.cfg");
+        // Any extra packs (eg. patches) go on top, so their files win over the ones in data.pak.
+        std::istringstream packs(config.get<std::string>("packs", ""));
+        std::string pack;
+        while(packs >> pack)
+        {
+            plum::mountPack(pack);
+        }
+
         auto silent = config.get<bool>("silent", false);
         auto console = config.get<bool>("console", false);
 
@@ -63,7 +77,17 @@ int main(int argc, char** argv)
 
         plum::Engine engine;
         plum::Timer timer(engine);
-        plum::Audio audio(engine, silent);
+        plum::AudioSettings audioSettings;
+        audioSettings.rate = config.get<int>("audio_rate", 0);
+        audioSettings.frames = config.get<int>("audio_frames", 0);
+        audioSettings.latency = config.get<int>("audio_latency", 0);
+        audioSettings.api = config.get<std::string>("audio_api", "");
+        audioSettings.device = config.get<std::string>("audio_device", "");
+        audioSettings.autoLatency = config.get<bool>("audio_auto", false);
+        audioSettings.listDevices = config.get<bool>("audio_list_devices", false);
+
+        plum::Audio audio(engine, silent, audioSettings);
+        audio.setMaxVoices(config.get<int>("voices", audio.getMaxVoices()));
 
         auto hook = engine.addUpdateHook([&]() {
             if(timer.getSpeed() == plum::TimerSpeed::Fast)
@@ -83,6 +107,18 @@ int main(int argc, char** argv)
         try
         {
             plum::Script script(argc, argv, engine, timer, audio);
+            // Negative values would wrap around to huge unsigned ones, so they're treated as 0.
+            script.setGCBudget(unsigned(std::max(config.get<int>("gc_budget", 0), 0)));
+            script.setGCLimit(unsigned(std::max(config.get<int>("gc_limit", 0), 0)));
+            script.setBytecodeCache(config.get<bool>("bytecode_cache", true));
+            if(config.get<bool>("profiler", false))
+            {
+                // Sample the whole run, and write the collapsed stacks out when the script finishes.
+                auto timed = config.get<std::string>("profiler_mode", "count") == "timer";
+                script.profiler().setOutput(config.get<std::string>("profiler_output", "profile.txt"));
+                script.profiler().start(timed ? plum::ProfilerMode::Timer : plum::ProfilerMode::Count,
+                    unsigned(std::max(config.get<int>("profiler_interval", 1000), 1)));
+            }
             script.run("system.lua");
         }
         catch(const std::runtime_error& e)
@@ -0,0 +1,155 @@
+#include "../core/audio.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            const char* const Meta = "plum.Audio";
+        }
+
+        void initAudioModule(lua_State* L)
+        {
+            // Load audio metatable
+            luaL_newmetatable(L, Meta);
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
+                {"__tostring", [](lua_State* L)
+                {
+                    script::push(L, Meta);
+                    return 1;
+                }},
+                {"__pairs", [](lua_State* L)
+                {
+                    lua_getglobal(L, "next");
+                    luaL_getmetatable(L, Meta);
+                    lua_pushnil(L);
+                    return 3;
+                }},
+                {"stats", [](lua_State* L)
+                {
+                    // plum.audio.stats() returns a table of how the audio thread is doing: its load, callback count,
+                    // callback times in milliseconds since the last call, underruns, overflows, voices being mixed,
+                    // prefetch stalls, the most scratch memory used in bytes, device underruns, the device's frames per
+                    // callback and its output latency in milliseconds.
+                    auto stats = script::instance(L).audio().getStats();
+                    lua_createtable(L, 0, 13);
+                    script::push(L, stats.load);
+                    lua_setfield(L, -2, "load");
+                    script::push(L, double(stats.callbacks));
+                    lua_setfield(L, -2, "callbacks");
+                    script::push(L, stats.minCallback);
+                    lua_setfield(L, -2, "minCallback");
+                    script::push(L, stats.averageCallback);
+                    lua_setfield(L, -2, "averageCallback");
+                    script::push(L, stats.maxCallback);
+                    lua_setfield(L, -2, "maxCallback");
+                    script::push(L, double(stats.underruns));
+                    lua_setfield(L, -2, "underruns");
+                    script::push(L, double(stats.overflows));
+                    lua_setfield(L, -2, "overflows");
+                    script::push(L, stats.voices);
+                    lua_setfield(L, -2, "voices");
+                    script::push(L, double(stats.stalls));
+                    lua_setfield(L, -2, "stalls");
+                    script::push(L, double(stats.scratchPeak));
+                    lua_setfield(L, -2, "scratchPeak");
+                    script::push(L, double(stats.xruns));
+                    lua_setfield(L, -2, "xruns");
+                    script::push(L, int(stats.frames));
+                    lua_setfield(L, -2, "frames");
+                    script::push(L, stats.latency);
+                    lua_setfield(L, -2, "latency");
+                    return 1;
+                }},
+                {"bus", [](lua_State* L)
+                {
+                    // plum.audio.bus(name) returns the named effect bus, making it if it's new.
+                    auto name = script::get<const char*>(L, 1);
+                    script::pushValue<Bus>(L, script::instance(L).audio().getBus(name));
+                    return 1;
+                }},
+                {"time", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).audio().getTime());
+                    return 1;
+                }},
+                {"get_voices", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).audio().getVoiceCount());
+                    return 1;
+                }},
+                {"get_maxVoices", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).audio().getMaxVoices());
+                    return 1;
+                }},
+                {"set_maxVoices", [](lua_State* L)
+                {
+                    auto value = script::get<int>(L, 2);
+                    script::instance(L).audio().setMaxVoices(value);
+                    return 0;
+                }},
+                {"get_steal", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).audio().getVoiceSteal()));
+                    return 1;
+                }},
+                {"set_steal", [](lua_State* L)
+                {
+                    auto value = script::get<int>(L, 2);
+                    if(value < int(VoiceSteal::Oldest) || value > int(VoiceSteal::Quietest))
+                    {
+                        return luaL_error(L, "Invalid voice steal mode %d. Must be one of plum.steal.", value);
+                    }
+                    script::instance(L).audio().setVoiceSteal(VoiceSteal(value));
+                    return 0;
+                }},
+                {"get_resampler", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).audio().getResampler()));
+                    return 1;
+                }},
+                {"set_resampler", [](lua_State* L)
+                {
+                    auto value = script::get<int>(L, 2);
+                    if(value < int(Resampler::Linear) || value > int(Resampler::Sinc32))
+                    {
+                        return luaL_error(L, "Invalid resampler %d. Must be one of plum.resampler.", value);
+                    }
+                    script::instance(L).audio().setResampler(Resampler(value));
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // Create audio namespace
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "audio");
+
+            luaL_getmetatable(L, Meta);
+            lua_setmetatable(L, -2);
+
+            // Pop audio namespace.
+            lua_pop(L, 1);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -0,0 +1,219 @@
+#include <cstring>
+#include <algorithm>
+#include "../core/buffer.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<Buffer>()
+        {
+            return "plum.Buffer";
+        }
+
+        void checkDataType(lua_State* L, int index, DataType& type, ByteOrder& order)
+        {
+            // Names are u8, u16, u32, i8, i16, i32, f32 or f64, optionally followed by le or be (default le).
+            static const struct
+            {
+                const char* name;
+                DataType type;
+            } types[] = {
+                {"u8", DataType::Unsigned8},
+                {"u16", DataType::Unsigned16},
+                {"u32", DataType::Unsigned32},
+                {"i8", DataType::Int8},
+                {"i16", DataType::Int16},
+                {"i32", DataType::Int32},
+                {"f32", DataType::Float},
+                {"f64", DataType::Double},
+            };
+
+            auto name = luaL_checkstring(L, index);
+            for(const auto& t : types)
+            {
+                size_t length = std::strlen(t.name);
+                if(!std::strncmp(name, t.name, length))
+                {
+                    const char* suffix = name + length;
+                    if(!*suffix || !std::strcmp(suffix, "le"))
+                    {
+                        type = t.type;
+                        order = ByteOrder::Little;
+                        return;
+                    }
+                    if(!std::strcmp(suffix, "be"))
+                    {
+                        type = t.type;
+                        order = ByteOrder::Big;
+                        return;
+                    }
+                }
+            }
+            luaL_argerror(L, index, lua_pushfstring(L, "invalid data type '%s'", name));
+        }
+
+        void initBufferObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<Buffer>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<Buffer>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<Buffer>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<Buffer>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<Buffer>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<Buffer>(L, 1)->pairs(L); }},
+                {"__len", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    script::push(L, int(buffer->getSize()));
+                    return 1;
+                }},
+                {"__eq", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto other = script::ptr<Buffer>(L, 2);
+                    script::push(L, buffer->compare(*other) == 0);
+                    return 1;
+                }},
+                {"get", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    DataType type;
+                    ByteOrder order;
+                    checkDataType(L, 2, type, order);
+                    auto offset = script::get<int>(L, 3);
+
+                    double value;
+                    if(offset >= 0 && buffer->get(size_t(offset), type, order, value))
+                    {
+                        script::push(L, value);
+                        return 1;
+                    }
+                    return 0;
+                }},
+                {"set", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    DataType type;
+                    ByteOrder order;
+                    checkDataType(L, 2, type, order);
+                    auto offset = script::get<int>(L, 3);
+                    auto value = script::get<double>(L, 4);
+
+                    script::push(L, offset >= 0 && buffer->set(size_t(offset), type, order, value));
+                    return 1;
+                }},
+                {"slice", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto offset = std::max(script::get<int>(L, 2), 0);
+                    auto length = std::max(script::get<int>(L, 3, int(buffer->getSize())), 0);
+
+                    script::pushValue(L, buffer->slice(size_t(offset), size_t(length)));
+                    return 1;
+                }},
+                {"fill", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    auto offset = std::max(script::get<int>(L, 3, 0), 0);
+                    auto length = std::max(script::get<int>(L, 4, int(buffer->getSize())), 0);
+
+                    buffer->fill(uint8_t(value), size_t(offset), size_t(length));
+                    return 0;
+                }},
+                {"copy", [](lua_State* L)
+                {
+                    // buffer:copy(source, [offset = 0], [sourceOffset = 0], [length = all])
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto source = script::ptr<Buffer>(L, 2);
+                    auto offset = std::max(script::get<int>(L, 3, 0), 0);
+                    auto sourceOffset = std::max(script::get<int>(L, 4, 0), 0);
+                    auto length = std::max(script::get<int>(L, 5, int(source->getSize())), 0);
+
+                    script::push(L, int(buffer->copy(size_t(offset), *source, size_t(sourceOffset), size_t(length))));
+                    return 1;
+                }},
+                {"compare", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto other = script::ptr<Buffer>(L, 2);
+
+                    script::push(L, buffer->compare(*other));
+                    return 1;
+                }},
+                {"toString", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    size_t size = buffer->getSize();
+                    auto offset = std::min(size_t(std::max(script::get<int>(L, 2, 0), 0)), size);
+                    auto length = std::min(size_t(std::max(script::get<int>(L, 3, int(size)), 0)), size - offset);
+
+                    lua_pushlstring(L, (const char*) buffer->getData() + offset, length);
+                    return 1;
+                }},
+                {"get_length", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+
+                    script::push(L, int(buffer->getSize()));
+                    return 1;
+                }},
+                {"get_view", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+
+                    script::push(L, buffer->isView());
+                    return 1;
+                }},
+                {"set_length", [](lua_State* L)
+                {
+                    auto buffer = script::ptr<Buffer>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    if(!buffer->resize(size_t(std::max(value, 0))))
+                    {
+                        return luaL_error(L, "A buffer slice can't be resized.");
+                    }
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.Buffer = <function create>
+            script::push(L, "Buffer");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                if(lua_type(L, 1) == LUA_TSTRING)
+                {
+                    size_t length = 0;
+                    const char* data = lua_tolstring(L, 1, &length);
+                    script::pushValue(L, Buffer(data, length));
+                }
+                else
+                {
+                    auto size = script::get<int>(L, 1, 0);
+                    script::pushValue(L, Buffer(size_t(std::max(size, 0))));
+                }
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
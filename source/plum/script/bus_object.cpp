@@ -0,0 +1,92 @@
+#include "../core/audio.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<Bus>()
+        {
+            return "plum.Bus";
+        }
+
+        void initBusObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<Bus>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<Bus>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<Bus>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<Bus>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<Bus>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<Bus>(L, 1)->pairs(L); }},
+                {"reverb", [](lua_State* L)
+                {
+                    // bus:reverb(wet, depth) fills the bus with reflections from a space depth meters big.
+                    auto bus = script::ptr<Bus>(L, 1);
+                    auto wet = script::get<double>(L, 2, 0.5);
+                    auto depth = script::get<double>(L, 3, 30.0);
+                    bus->setReverb(wet, depth);
+                    return 0;
+                }},
+                {"echo", [](lua_State* L)
+                {
+                    // bus:echo(distance, decay) repeats what's sent as if it bounced off a wall distance meters away.
+                    auto bus = script::ptr<Bus>(L, 1);
+                    auto distance = script::get<double>(L, 2);
+                    auto decay = script::get<double>(L, 3, 0.5);
+                    bus->setEcho(distance, decay);
+                    return 0;
+                }},
+                {"get_volume", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    script::push(L, bus->getVolume());
+                    return 1;
+                }},
+                {"set_volume", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    bus->setVolume(value);
+                    return 0;
+                }},
+                {"get_lowpass", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    script::push(L, bus->getLowpass());
+                    return 1;
+                }},
+                {"set_lowpass", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    bus->setLowpass(value);
+                    return 0;
+                }},
+                {"get_highpass", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    script::push(L, bus->getHighpass());
+                    return 1;
+                }},
+                {"set_highpass", [](lua_State* L)
+                {
+                    auto bus = script::ptr<Bus>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    bus->setHighpass(value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+        }
+    }
+}
\ No newline at end of file
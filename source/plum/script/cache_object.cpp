@@ -0,0 +1,101 @@
+#include <algorithm>
+
+#include "script.h"
+#include "../core/cache.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            const char* const Meta = "plum.Cache";
+        }
+
+        void initCacheModule(lua_State* L)
+        {
+            // Load cache metatable
+            luaL_newmetatable(L, Meta);
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
+                {"__tostring", [](lua_State* L)
+                {
+                    script::push(L, Meta);
+                    return 1;
+                }},
+                {"__pairs", [](lua_State* L)
+                {
+                    lua_getglobal(L, "next");
+                    luaL_getmetatable(L, Meta);
+                    lua_pushnil(L);
+                    return 3;
+                }},
+                {"stats", [](lua_State* L)
+                {
+                    // plum.cache.stats() returns a table of how many images are loaded and their size in bytes,
+                    // the same for those kept only by the cache, and the hit and miss counts.
+                    auto stats = getCacheStats();
+                    lua_createtable(L, 0, 6);
+                    script::push(L, double(stats.count));
+                    lua_setfield(L, -2, "count");
+                    script::push(L, double(stats.bytes));
+                    lua_setfield(L, -2, "bytes");
+                    script::push(L, double(stats.unusedCount));
+                    lua_setfield(L, -2, "unusedCount");
+                    script::push(L, double(stats.unusedBytes));
+                    lua_setfield(L, -2, "unusedBytes");
+                    script::push(L, double(stats.hits));
+                    lua_setfield(L, -2, "hits");
+                    script::push(L, double(stats.misses));
+                    lua_setfield(L, -2, "misses");
+                    return 1;
+                }},
+                {"trim", [](lua_State* L)
+                {
+                    // plum.cache.trim([bytes = 0]) frees unused resources until no more than bytes of them are left.
+                    auto bytes = script::get<double>(L, 1, 0);
+                    trimCache(size_t(std::max(bytes, 0.0)));
+                    return 0;
+                }},
+                {"get_limit", [](lua_State* L)
+                {
+                    script::push(L, double(getCacheLimit()));
+                    return 1;
+                }},
+                {"set_limit", [](lua_State* L)
+                {
+                    auto value = script::get<double>(L, 2);
+                    setCacheLimit(size_t(std::max(value, 0.0)));
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // Create cache namespace
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "cache");
+
+            luaL_getmetatable(L, Meta);
+            lua_setmetatable(L, -2);
+
+            // Pop cache namespace.
+            lua_pop(L, 1);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -0,0 +1,56 @@
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            // Its address identifies the error held for raiseCallbackError in the registry.
+            const char ErrorKey = 0;
+        }
+
+        bool callback(lua_State* L, int args, int results)
+        {
+            if(lua_pcall(L, args, results, 0) == LUA_OK)
+            {
+                return true;
+            }
+
+            // Only the first error is kept. It's the one that started any trouble that follows.
+            lua_rawgetp(L, LUA_REGISTRYINDEX, &ErrorKey);
+            bool held = !lua_isnil(L, -1);
+            lua_pop(L, 1);
+            if(held)
+            {
+                lua_pop(L, 1);
+            }
+            else
+            {
+                lua_rawsetp(L, LUA_REGISTRYINDEX, &ErrorKey);
+            }
+            return false;
+        }
+
+        bool hasCallbackError(lua_State* L)
+        {
+            lua_rawgetp(L, LUA_REGISTRYINDEX, &ErrorKey);
+            bool held = !lua_isnil(L, -1);
+            lua_pop(L, 1);
+            return held;
+        }
+
+        void raiseCallbackError(lua_State* L)
+        {
+            lua_rawgetp(L, LUA_REGISTRYINDEX, &ErrorKey);
+            if(lua_isnil(L, -1))
+            {
+                lua_pop(L, 1);
+                return;
+            }
+            lua_pushnil(L);
+            lua_rawsetp(L, LUA_REGISTRYINDEX, &ErrorKey);
+            lua_error(L);
+        }
+    }
+}
@@ -1,5 +1,7 @@
+#include <cstring>
 #include "script.h"
 #include "../core/canvas.h"
+#include "../core/buffer.h"
 
 namespace plum
 {
@@ -373,6 +375,52 @@ namespace plum
                     }
                     return 0;
                 }},
+                {"exportPixels", [](lua_State* L)
+                {
+                    // Copies the visible pixels out as 32-bit colors, row by row, into the given buffer or a new one.
+                    auto canvas = script::ptr<Canvas>(L, 1);
+                    size_t rowSize = canvas->getWidth() * sizeof(Color);
+                    size_t size = rowSize * canvas->getHeight();
+
+                    if(lua_isnoneornil(L, 2))
+                    {
+                        script::pushValue(L, Buffer(size));
+                    }
+                    else
+                    {
+                        lua_pushvalue(L, 2);
+                    }
+                    auto buffer = script::ptr<Buffer>(L, -1);
+                    if(buffer->getSize() < size && !buffer->resize(size))
+                    {
+                        return luaL_error(L, "Buffer is too small to hold the canvas pixels.");
+                    }
+
+                    auto dest = buffer->getData();
+                    for(int y = 0; y < canvas->getHeight(); ++y)
+                    {
+                        std::memcpy(dest + y * rowSize, canvas->getData() + y * canvas->getTrueWidth(), rowSize);
+                    }
+                    return 1;
+                }},
+                {"importPixels", [](lua_State* L)
+                {
+                    // The reverse of exportPixels. Stops early if the buffer runs out.
+                    auto canvas = script::ptr<Canvas>(L, 1);
+                    auto buffer = script::ptr<Buffer>(L, 2);
+                    size_t rowSize = canvas->getWidth() * sizeof(Color);
+                    auto source = buffer->getData();
+                    size_t remaining = buffer->getSize();
+
+                    for(int y = 0; y < canvas->getHeight() && remaining > 0; ++y)
+                    {
+                        size_t length = std::min(rowSize, remaining) / sizeof(Color) * sizeof(Color);
+                        std::memcpy(canvas->getData() + y * canvas->getTrueWidth(), source + y * rowSize, length);
+                        remaining -= std::min(rowSize, remaining);
+                    }
+                    canvas->setModified(true);
+                    return 0;
+                }},
                 {"get_trueWidth", [](lua_State* L)
                 {
                     auto canvas = script::ptr<Canvas>(L, 1);
@@ -419,6 +467,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
 
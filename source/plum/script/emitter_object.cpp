@@ -0,0 +1,297 @@
+#include "../core/particles.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<ParticleEmitter>()
+        {
+            return "plum.ParticleEmitter";
+        }
+
+        void initParticleEmitterObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<ParticleEmitter>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<ParticleEmitter>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<ParticleEmitter>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<ParticleEmitter>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<ParticleEmitter>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<ParticleEmitter>(L, 1)->pairs(L); }},
+                {"get_x", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->x);
+                    return 1;
+                }},
+                {"set_x", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->x = value;
+                    return 0;
+                }},
+                {"get_y", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->y);
+                    return 1;
+                }},
+                {"set_y", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->y = value;
+                    return 0;
+                }},
+                {"get_width", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->width);
+                    return 1;
+                }},
+                {"set_width", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->width = value;
+                    return 0;
+                }},
+                {"get_height", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->height);
+                    return 1;
+                }},
+                {"set_height", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->height = value;
+                    return 0;
+                }},
+                {"get_angle", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->angle);
+                    return 1;
+                }},
+                {"set_angle", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->angle = value;
+                    return 0;
+                }},
+                {"get_spread", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->spread);
+                    return 1;
+                }},
+                {"set_spread", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->spread = value;
+                    return 0;
+                }},
+                {"get_speedMin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->speedMin);
+                    return 1;
+                }},
+                {"set_speedMin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->speedMin = value;
+                    return 0;
+                }},
+                {"get_speedMax", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->speedMax);
+                    return 1;
+                }},
+                {"set_speedMax", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->speedMax = value;
+                    return 0;
+                }},
+                {"get_accelX", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->accelX);
+                    return 1;
+                }},
+                {"set_accelX", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->accelX = value;
+                    return 0;
+                }},
+                {"get_accelY", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->accelY);
+                    return 1;
+                }},
+                {"set_accelY", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->accelY = value;
+                    return 0;
+                }},
+                {"get_lifeMin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->lifeMin);
+                    return 1;
+                }},
+                {"set_lifeMin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    e->lifeMin = value;
+                    return 0;
+                }},
+                {"get_lifeMax", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->lifeMax);
+                    return 1;
+                }},
+                {"set_lifeMax", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    e->lifeMax = value;
+                    return 0;
+                }},
+                {"get_frameStart", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->frameStart);
+                    return 1;
+                }},
+                {"set_frameStart", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    e->frameStart = value;
+                    return 0;
+                }},
+                {"get_frameEnd", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->frameEnd);
+                    return 1;
+                }},
+                {"set_frameEnd", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    e->frameEnd = value;
+                    return 0;
+                }},
+                {"get_tint", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, (int) e->tint);
+                    return 1;
+                }},
+                {"set_tint", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    e->tint = value;
+                    return 0;
+                }},
+                {"get_fade", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->fade);
+                    return 1;
+                }},
+                {"set_fade", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<bool>(L, 2);
+                    e->fade = value;
+                    return 0;
+                }},
+                {"get_rotation", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->rotation);
+                    return 1;
+                }},
+                {"set_rotation", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->rotation = value;
+                    return 0;
+                }},
+                {"get_rotationSpread", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->rotationSpread);
+                    return 1;
+                }},
+                {"set_rotationSpread", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->rotationSpread = value;
+                    return 0;
+                }},
+                {"get_spin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    script::push(L, e->spin);
+                    return 1;
+                }},
+                {"set_spin", [](lua_State* L)
+                {
+                    auto e = script::ptr<ParticleEmitter>(L, 1);
+                    auto value = script::get<double>(L, 2);
+                    e->spin = value;
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.ParticleEmitter = <function create>
+            script::push(L, "ParticleEmitter");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                script::pushValue<ParticleEmitter>(L);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -1,6 +1,14 @@
 
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
 #include "script.h"
 #include "../core/file.h"
+#include "../core/engine.h"
+#include "../core/file_queue.h"
+#include "../core/buffer.h"
+#include "../core/tilemap.h"
 
 namespace plum
 {
@@ -11,6 +19,135 @@ namespace plum
             return "plum.File";
         }
 
+        namespace
+        {
+            // Its address identifies the async file queue in the registry.
+            const char AsyncKey = 0;
+            const char* const AsyncMeta = "plum.File.async";
+
+            // Owned by the Lua state, so pending writes are finished when it closes.
+            struct AsyncFiles
+            {
+                FileQueue queue;
+                std::shared_ptr<Engine::UpdateHook> hook;
+            };
+
+            // Runs the callbacks of finished requests. Each is taken off the queue before its callback runs,
+            // so an error in one doesn't stop the rest from being delivered next time. The error itself is raised
+            // by plum.refresh, once the update hooks are done.
+            void deliver(lua_State* L, AsyncFiles* files)
+            {
+                FileRequest request;
+                while(files->queue.poll(request))
+                {
+                    if(request.tag == LUA_NOREF)
+                    {
+                        continue;
+                    }
+
+                    lua_rawgeti(L, LUA_REGISTRYINDEX, request.tag);
+                    luaL_unref(L, LUA_REGISTRYINDEX, request.tag);
+                    if(request.kind == FileRequestKind::Read)
+                    {
+                        if(request.success)
+                        {
+                            lua_pushlstring(L, (const char*) request.data.data(), request.data.size());
+                        }
+                        else
+                        {
+                            lua_pushnil(L);
+                        }
+                    }
+                    else
+                    {
+                        lua_pushboolean(L, request.success);
+                    }
+                    if(!script::callback(L, 1))
+                    {
+                        break;
+                    }
+                }
+            }
+
+            // Gets the queue for this state, starting it on first use.
+            AsyncFiles* getAsyncFiles(lua_State* L)
+            {
+                lua_rawgetp(L, LUA_REGISTRYINDEX, &AsyncKey);
+                auto files = (AsyncFiles*) lua_touserdata(L, -1);
+                lua_pop(L, 1);
+                if(files)
+                {
+                    return files;
+                }
+
+                files = new(lua_newuserdata(L, sizeof(AsyncFiles))) AsyncFiles();
+                if(luaL_newmetatable(L, AsyncMeta))
+                {
+                    lua_pushcfunction(L, [](lua_State* L)
+                    {
+                        auto files = (AsyncFiles*) lua_touserdata(L, 1);
+                        files->hook.reset();
+                        files->~AsyncFiles();
+                        return 0;
+                    });
+                    lua_setfield(L, -2, "__gc");
+                }
+                lua_setmetatable(L, -2);
+                lua_rawsetp(L, LUA_REGISTRYINDEX, &AsyncKey);
+
+                files->hook = script::instance(L).engine().addUpdateHook([L, files](){ deliver(L, files); });
+                return files;
+            }
+
+            // Takes an optional callback at the given index, and returns a reference to it (or LUA_NOREF).
+            int checkCallback(lua_State* L, int index)
+            {
+                if(lua_isnoneornil(L, index))
+                {
+                    return LUA_NOREF;
+                }
+                luaL_checktype(L, index, LUA_TFUNCTION);
+                lua_pushvalue(L, index);
+                return luaL_ref(L, LUA_REGISTRYINDEX);
+            }
+
+            // Reads up to count values of the given size in one go, and returns how many whole values were read.
+            // Files in memory are read in place. Otherwise the bytes land in scratch.
+            size_t readValues(File& file, size_t size, size_t count, std::vector<uint8_t>& scratch, const uint8_t*& raw)
+            {
+                size_t length = size * count;
+                if(file.isInMemory())
+                {
+                    raw = file.readInPlace(length);
+                }
+                else
+                {
+                    scratch.resize(length);
+                    length = file.readRaw(scratch.data(), length);
+                    raw = scratch.data();
+                }
+
+                // Don't leave the file partway through a value.
+                size_t whole = length / size;
+                if(length % size)
+                {
+                    file.seek(-int(length % size), FileSeekMode::Current);
+                }
+                return whole;
+            }
+
+            // Turns a value read from a file into a tile index. Negative values wrap around, so -1 comes out as
+            // Tilemap::InvalidTile. Floats that aren't finite or don't fit in 32 bits are invalid tiles too.
+            unsigned int toTile(double value)
+            {
+                if(!std::isfinite(value) || value < -2147483648.0 || value > 4294967295.0)
+                {
+                    return Tilemap::InvalidTile;
+                }
+                return unsigned(int64_t(value));
+            }
+        }
+
         void initFileObject(lua_State* L)
         {
             luaL_newmetatable(L, meta<File>());
@@ -185,6 +322,101 @@ namespace plum
                     }
                     return 0;
                 }},
+                {"readBuffer", [](lua_State* L)
+                {
+                    // file:readBuffer(buffer, [offset = 0], [length = rest of buffer]) reads straight into the buffer's memory.
+                    auto file = script::ptr<File>(L, 1);
+                    auto buffer = script::ptr<Buffer>(L, 2);
+                    size_t size = buffer->getSize();
+                    auto offset = std::min(size_t(std::max(script::get<int>(L, 3, 0), 0)), size);
+                    auto length = std::min(size_t(std::max(script::get<int>(L, 4, int(size - offset)), 0)), size - offset);
+
+                    script::push(L, int(file->readRaw(buffer->getData() + offset, length)));
+                    return 1;
+                }},
+                {"readArray", [](lua_State* L)
+                {
+                    // file:readArray(type, count, [table]) reads count values into a table (or refills the one given).
+                    // Returns the table, with one entry for each value actually read.
+                    auto file = script::ptr<File>(L, 1);
+                    DataType type;
+                    ByteOrder order;
+                    checkDataType(L, 2, type, order);
+                    auto count = size_t(std::max(script::get<int>(L, 3), 0));
+                    size_t size = getDataTypeSize(type);
+
+                    std::vector<uint8_t> scratch;
+                    const uint8_t* raw = nullptr;
+                    size_t read = readValues(*file, size, count, scratch, raw);
+
+                    int previous = 0;
+                    if(lua_istable(L, 4))
+                    {
+                        lua_pushvalue(L, 4);
+                        previous = int(lua_rawlen(L, -1));
+                    }
+                    else
+                    {
+                        lua_createtable(L, int(read), 0);
+                    }
+                    for(size_t i = 0; i < read; ++i)
+                    {
+                        lua_pushnumber(L, decodeValue(raw + i * size, type, order));
+                        lua_rawseti(L, -2, int(i + 1));
+                    }
+                    for(int i = previous; i > int(read); --i)
+                    {
+                        lua_pushnil(L);
+                        lua_rawseti(L, -2, i);
+                    }
+                    return 1;
+                }},
+                {"readInto", [](lua_State* L)
+                {
+                    // file:readInto(tilemap | buffer, type) fills every tile of a tilemap, or every value that fits in a buffer.
+                    // Buffers get the values in little endian, the same as buffer:get defaults to. Returns the number of values read.
+                    auto file = script::ptr<File>(L, 1);
+                    DataType type;
+                    ByteOrder order;
+                    checkDataType(L, 3, type, order);
+                    size_t size = getDataTypeSize(type);
+                    std::vector<uint8_t> scratch;
+                    const uint8_t* raw = nullptr;
+
+                    if(auto buffer = (Wrapper<Buffer>*) luaL_testudata(L, 2, meta<Buffer>()))
+                    {
+                        Buffer& dest(*buffer->data);
+                        size_t read = readValues(*file, size, dest.getSize() / size, scratch, raw);
+                        if(order == ByteOrder::Little || size == 1)
+                        {
+                            // raw can be null when nothing was read.
+                            if(read)
+                            {
+                                std::memcpy(dest.getData(), raw, read * size);
+                            }
+                        }
+                        else
+                        {
+                            for(size_t i = 0; i < read; ++i)
+                            {
+                                encodeValue(dest.getData() + i * size, type, ByteOrder::Little, decodeValue(raw + i * size, type, order));
+                            }
+                        }
+                        script::push(L, int(read));
+                        return 1;
+                    }
+
+                    auto tilemap = script::ptr<Tilemap>(L, 2);
+                    auto tiles = tilemap->getData();
+                    size_t read = readValues(*file, size, size_t(tilemap->getWidth() * tilemap->getHeight()), scratch, raw);
+                    for(size_t i = 0; i < read; ++i)
+                    {
+                        tiles[i] = toTile(decodeValue(raw + i * size, type, order));
+                    }
+                    tilemap->setModified(true);
+                    script::push(L, int(read));
+                    return 1;
+                }},
                 {"writeUnsigned8", [](lua_State* L)
                 {
                     auto file = script::ptr<File>(L, 1);
@@ -267,6 +499,39 @@ namespace plum
                     script::push(L, file->writeLine(value));
                     return 1;
                 }},
+                {"writeBuffer", [](lua_State* L)
+                {
+                    auto file = script::ptr<File>(L, 1);
+                    auto buffer = script::ptr<Buffer>(L, 2);
+                    size_t size = buffer->getSize();
+                    auto offset = std::min(size_t(std::max(script::get<int>(L, 3, 0), 0)), size);
+                    auto length = std::min(size_t(std::max(script::get<int>(L, 4, int(size - offset)), 0)), size - offset);
+
+                    script::push(L, int(file->writeRaw(buffer->getData() + offset, length)));
+                    return 1;
+                }},
+                {"writeArray", [](lua_State* L)
+                {
+                    // file:writeArray(type, table) writes the table's array part in one go. Returns the number of values written.
+                    auto file = script::ptr<File>(L, 1);
+                    DataType type;
+                    ByteOrder order;
+                    checkDataType(L, 2, type, order);
+                    luaL_checktype(L, 3, LUA_TTABLE);
+                    size_t size = getDataTypeSize(type);
+                    size_t count = lua_rawlen(L, 3);
+
+                    std::vector<uint8_t> raw(count * size);
+                    for(size_t i = 0; i < count; ++i)
+                    {
+                        lua_rawgeti(L, 3, int(i + 1));
+                        encodeValue(raw.data() + i * size, type, order, luaL_checknumber(L, -1));
+                        lua_pop(L, 1);
+                    }
+
+                    script::push(L, int(file->writeRaw(raw.data(), raw.size()) / size));
+                    return 1;
+                }},
                 {"tell", [](lua_State* L)
                 {
                     auto file = script::ptr<File>(L, 1);
@@ -290,18 +555,72 @@ namespace plum
                 {nullptr, nullptr},
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
                 
             // Push plum namespace.
             lua_getglobal(L, "plum");
 
-            // plum.File = <function create>
+            // plum.File = <table with __call = create>
             script::push(L, "File");
+            lua_newtable(L);
+
+            const luaL_Reg statics[] = {
+                {"readAsync", [](lua_State* L)
+                {
+                    // plum.File.readAsync(filename, callback) loads the whole file in the background.
+                    // On a later refresh, callback gets the contents as a string, or nil if it couldn't be read.
+                    FileRequest request;
+                    request.kind = FileRequestKind::Read;
+                    request.filename = script::get<const char*>(L, 1);
+                    luaL_checktype(L, 2, LUA_TFUNCTION);
+                    request.tag = checkCallback(L, 2);
+
+                    getAsyncFiles(L)->queue.submit(std::move(request));
+                    return 0;
+                }},
+                {"writeAsync", [](lua_State* L)
+                {
+                    // plum.File.writeAsync(filename, data, [callback]) saves a string or Buffer as the whole file in the background.
+                    // The data is copied, so it's fine to change it afterwards. On a later refresh, callback gets whether it worked.
+                    FileRequest request;
+                    request.kind = FileRequestKind::Write;
+                    request.filename = script::get<const char*>(L, 1);
+                    if(luaL_testudata(L, 2, meta<Buffer>()))
+                    {
+                        auto buffer = script::ptr<Buffer>(L, 2);
+                        request.data.assign(buffer->getData(), buffer->getData() + buffer->getSize());
+                    }
+                    else
+                    {
+                        size_t length;
+                        auto data = (const uint8_t*) luaL_checklstring(L, 2, &length);
+                        request.data.assign(data, data + length);
+                    }
+                    request.tag = checkCallback(L, 3);
+
+                    getAsyncFiles(L)->queue.submit(std::move(request));
+                    return 0;
+                }},
+                {"pendingAsync", [](lua_State* L)
+                {
+                    // plum.File.pendingAsync() returns how many async requests haven't had their callbacks run yet.
+                    lua_rawgetp(L, LUA_REGISTRYINDEX, &AsyncKey);
+                    auto files = (AsyncFiles*) lua_touserdata(L, -1);
+                    script::push(L, int(files ? files->queue.getPending() : 0));
+                    return 1;
+                }},
+                {nullptr, nullptr},
+            };
+            luaL_setfuncs(L, statics, 0);
+
+            lua_newtable(L);
             lua_pushcfunction(L, [](lua_State* L)
             {
-                auto filename = script::get<const char*>(L, 1);
-                auto mode = FileOpenMode(script::get<int>(L, 2));
+                // Called as plum.File(filename, mode), so the table itself comes first.
+                auto filename = script::get<const char*>(L, 2);
+                auto mode = FileOpenMode(script::get<int>(L, 3));
                 auto f = new File(filename, mode);
                 // Failure.
                 if(!f->isActive())
@@ -313,6 +632,8 @@ namespace plum
                 script::push(L, f, LUA_NOREF);
                 return 1;
             });
+            lua_setfield(L, -2, "__call");
+            lua_setmetatable(L, -2);
             lua_settable(L, -3);
 
             // Pop plum namespace.
@@ -0,0 +1,172 @@
+#include "../core/font.h"
+#include "../core/image.h"
+#include "../core/sheet.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<Font>()
+        {
+            return "plum.Font";
+        }
+
+        namespace
+        {
+            enum
+            {
+                ImageAttribute = 1
+            };
+
+            // Glyphs can be given as a character code, or as a string whose first character is used.
+            int getCharacter(lua_State* L, int index)
+            {
+                if(lua_type(L, index) == LUA_TSTRING)
+                {
+                    return (unsigned char) script::get<const char*>(L, index)[0];
+                }
+                return script::get<int>(L, index);
+            }
+        }
+
+        void initFontObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<Font>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<Font>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<Font>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<Font>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<Font>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<Font>(L, 1)->pairs(L); }},
+                {"enableVariableWidth", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    font->enableVariableWidth();
+                    return 0;
+                }},
+                {"textWidth", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto text = script::get<const char*>(L, 2);
+
+                    script::push(L, font->getTextWidth(text));
+                    return 1;
+                }},
+                {"getGlyphWidth", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto c = getCharacter(L, 2);
+
+                    script::push(L, font->getGlyphWidth(c));
+                    return 1;
+                }},
+                {"setGlyphWidth", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto c = getCharacter(L, 2);
+                    auto width = script::get<int>(L, 3);
+
+                    font->setGlyphWidth(c, width);
+                    return 0;
+                }},
+                {"getKerning", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto first = getCharacter(L, 2);
+                    auto second = getCharacter(L, 3);
+
+                    script::push(L, font->getKerning(first, second));
+                    return 1;
+                }},
+                {"setKerning", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto first = getCharacter(L, 2);
+                    auto second = getCharacter(L, 3);
+                    auto amount = script::get<int>(L, 4);
+
+                    font->setKerning(first, second, amount);
+                    return 0;
+                }},
+                {"get_image", [](lua_State* L)
+                {
+                    script::wrapped<Font>(L, 1)->getAttribute(L, ImageAttribute);
+                    return 1;
+                }},
+                {"get_sheet", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+
+                    script::pushValue(L, font->getSheet());
+                    return 1;
+                }},
+                {"get_height", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+
+                    script::push(L, font->getHeight());
+                    return 1;
+                }},
+                {"get_letterSpacing", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+
+                    script::push(L, font->getLetterSpacing());
+                    return 1;
+                }},
+                {"set_letterSpacing", [](lua_State* L)
+                {
+                    auto font = script::ptr<Font>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    font->setLetterSpacing(value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.Font = <function create>
+            script::push(L, "Font");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto image = script::ptr<Image>(L, 1);
+                Font* font = nullptr;
+                if(script::is<Sheet>(L, 2))
+                {
+                    auto sheet = script::ptr<Sheet>(L, 2);
+                    font = new Font(*image, *sheet);
+                }
+                else
+                {
+                    auto columns = script::get<int>(L, 2, 20);
+                    auto rows = script::get<int>(L, 3, 5);
+                    font = new Font(*image, columns, rows);
+                }
+
+                auto wrap = script::push(L, font, LUA_NOREF);
+                // Keep the image alive for as long as the font uses it.
+                lua_pushvalue(L, 1);
+                wrap->setAttribute(L, ImageAttribute);
+                lua_pop(L, 1);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            const char* const Meta = "plum.GC";
+        }
+
+        void initGCModule(lua_State* L)
+        {
+            // Load gc metatable
+            luaL_newmetatable(L, Meta);
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
+                {"__tostring", [](lua_State* L)
+                {
+                    script::push(L, Meta);
+                    return 1;
+                }},
+                {"__pairs", [](lua_State* L)
+                {
+                    lua_getglobal(L, "next");
+                    luaL_getmetatable(L, Meta);
+                    lua_pushnil(L);
+                    return 3;
+                }},
+                {"collect", [](lua_State* L)
+                {
+                    script::instance(L).collect();
+                    return 0;
+                }},
+                {"get_budget", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).getGCBudget()));
+                    return 1;
+                }},
+                {"set_budget", [](lua_State* L)
+                {
+                    auto value = script::get<int>(L, 2);
+                    script::instance(L).setGCBudget(unsigned(std::max(value, 0)));
+                    return 0;
+                }},
+                {"get_limit", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).getGCLimit()));
+                    return 1;
+                }},
+                {"set_limit", [](lua_State* L)
+                {
+                    auto value = script::get<int>(L, 2);
+                    script::instance(L).setGCLimit(unsigned(std::max(value, 0)));
+                    return 0;
+                }},
+                {"get_heap", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).getGCHeapSize());
+                    return 1;
+                }},
+                {"get_stepTime", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).getGCStepTime()));
+                    return 1;
+                }},
+                {"get_cycles", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).getGCCycles()));
+                    return 1;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // Create gc namespace
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "gc");
+
+            luaL_getmetatable(L, Meta);
+            lua_setmetatable(L, -2);
+
+            // Pop gc namespace.
+            lua_pop(L, 1);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -3,6 +3,7 @@
 #include "../core/image.h"
 #include "../core/canvas.h"
 #include "../core/sheet.h"
+#include "../core/cache.h"
 
 namespace plum
 {
@@ -70,14 +71,14 @@ namespace plum
                 }},
                 {"get_width", [](lua_State* L)
                 {
-                    auto img = script::ptr<Image>(L, 1);
+                    const Image* img = script::ptr<Image>(L, 1);
                     script::push(L, img->canvas().getWidth());
 
                     return 1;
                 }},
                 {"get_height", [](lua_State* L)
                 {
-                    auto img = script::ptr<Image>(L, 1);
+                    const Image* img = script::ptr<Image>(L, 1);
                     script::push(L, img->canvas().getHeight());
 
                     return 1;
@@ -96,14 +97,14 @@ namespace plum
                 }},
                 {"get_trueWidth", [](lua_State* L)
                 {
-                    auto img = script::ptr<Image>(L, 1);
+                    const Image* img = script::ptr<Image>(L, 1);
                     script::push(L, img->canvas().getTrueWidth());
 
                     return 1;
                 }},
                 {"get_trueHeight", [](lua_State* L)
                 {
-                    auto img = script::ptr<Image>(L, 1);
+                    const Image* img = script::ptr<Image>(L, 1);
                     script::push(L, img->canvas().getTrueHeight());
 
                     return 1;
@@ -111,6 +112,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
                 
@@ -123,8 +125,32 @@ namespace plum
             {
                 if(script::is<const char*>(L, 1))
                 {
+                    // plum.Image(filename, [shared = true]). Shared images loaded from the same file use one texture
+                    // until one of them is asked for its canvas, which gives that image a copy of its own.
+                    // Pass false to skip the cache and always decode the file again.
                     auto filename = script::get<const char*>(L, 1);
-                    script::push(L, new Image(Canvas::load(filename)), LUA_NOREF);
+                    auto shared = script::get<bool>(L, 2, true);
+                    if(!shared)
+                    {
+                        script::push(L, new Image(Canvas::load(filename)), LUA_NOREF);
+                        return 1;
+                    }
+
+                    std::string key(makeCacheKey("image", filename));
+                    if(auto impl = findCached(key))
+                    {
+                        script::push(L, new Image(std::static_pointer_cast<Image::Impl>(impl)), LUA_NOREF);
+                        return 1;
+                    }
+
+                    auto image = new Image(Canvas::load(filename));
+                    // The pixels are kept on both sides, once in the canvas and once in the texture.
+                    // Read through a const reference, since the image isn't shared yet and mustn't be copied.
+                    const Canvas& canvas(static_cast<const Image&>(*image).canvas());
+                    addCached(key, image->impl, 2 * size_t(canvas.getTrueWidth()) * canvas.getTrueHeight() * sizeof(Color));
+                    // From here on the cache hands impl out, so writing to this image has to copy it too.
+                    image->shared = true;
+                    script::push(L, image, LUA_NOREF);
 
                     return 1;
                 }
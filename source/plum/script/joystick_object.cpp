@@ -70,6 +70,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
             lua_pop(L, 1);
 
 
@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "../core/pack.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            const char* const Meta = "plum.Pack";
+        }
+
+        void initPackModule(lua_State* L)
+        {
+            // Load pack metatable
+            luaL_newmetatable(L, Meta);
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
+                {"__tostring", [](lua_State* L)
+                {
+                    script::push(L, Meta);
+                    return 1;
+                }},
+                {"__pairs", [](lua_State* L)
+                {
+                    lua_getglobal(L, "next");
+                    luaL_getmetatable(L, Meta);
+                    lua_pushnil(L);
+                    return 3;
+                }},
+                {"mount", [](lua_State* L)
+                {
+                    auto filename = script::get<const char*>(L, 1);
+                    script::push(L, mountPack(filename));
+                    return 1;
+                }},
+                {"unmount", [](lua_State* L)
+                {
+                    auto filename = script::get<const char*>(L, 1);
+                    script::push(L, unmountPack(filename));
+                    return 1;
+                }},
+                {"contains", [](lua_State* L)
+                {
+                    auto name = script::get<const char*>(L, 1);
+                    PackEntry entry;
+                    script::push(L, findPack(name, entry) != nullptr);
+                    return 1;
+                }},
+                {"build", [](lua_State* L)
+                {
+                    // plum.pack.build(filename, { name, ... }, [compress = true])
+                    auto filename = script::get<const char*>(L, 1);
+                    luaL_checktype(L, 2, LUA_TTABLE);
+                    auto compress = lua_isnoneornil(L, 3) || lua_toboolean(L, 3);
+
+                    std::vector<std::string> names;
+                    int length = int(lua_rawlen(L, 2));
+                    for(int i = 1; i <= length; ++i)
+                    {
+                        lua_rawgeti(L, 2, i);
+                        names.push_back(luaL_checkstring(L, -1));
+                        lua_pop(L, 1);
+                    }
+
+                    script::push(L, buildPack(filename, names, compress));
+                    return 1;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // Create pack namespace
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "pack");
+
+            luaL_getmetatable(L, Meta);
+            lua_setmetatable(L, -2);
+
+            // Pop pack namespace.
+            lua_pop(L, 1);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include "../core/image.h"
+#include "../core/sheet.h"
+#include "../core/screen.h"
+#include "../core/particles.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<ParticleSystem>()
+        {
+            return "plum.ParticleSystem";
+        }
+
+        void initParticleSystemObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<ParticleSystem>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<ParticleSystem>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<ParticleSystem>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<ParticleSystem>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<ParticleSystem>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<ParticleSystem>(L, 1)->pairs(L); }},
+                {"clear", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    particles->clear();
+                    return 0;
+                }},
+                {"emit", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto emitter = script::ptr<ParticleEmitter>(L, 2);
+                    auto amount = script::get<int>(L, 3, 1);
+
+                    script::push(L, int(particles->emit(*emitter, size_t(std::max(amount, 0)))));
+                    return 1;
+                }},
+                {"update", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto ticks = script::get<int>(L, 2, 1);
+
+                    particles->update(unsigned(std::max(ticks, 0)));
+                    return 0;
+                }},
+                {"draw", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto image = script::ptr<Image>(L, 2);
+                    auto sheet = script::ptr<Sheet>(L, 3);
+                    auto x = script::get<int>(L, 4);
+                    auto y = script::get<int>(L, 5);
+                    auto screen = script::ptr<Screen>(L, 6);
+
+                    particles->draw(*image, *sheet, x, y, *screen);
+                    return 0;
+                }},
+                {"get_count", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, int(particles->getCount()));
+                    return 1;
+                }},
+                {"get_capacity", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, int(particles->getCapacity()));
+                    return 1;
+                }},
+                {"get_gravityX", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, particles->getGravityX());
+                    return 1;
+                }},
+                {"get_gravityY", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, particles->getGravityY());
+                    return 1;
+                }},
+                {"get_drag", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, particles->getDrag());
+                    return 1;
+                }},
+                {"get_mode", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+
+                    script::push(L, (int) particles->getMode());
+                    return 1;
+                }},
+                {"set_capacity", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    particles->setCapacity(size_t(std::max(value, 0)));
+                    return 0;
+                }},
+                {"set_gravityX", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto value = script::get<double>(L, 2);
+
+                    particles->setGravityX(value);
+                    return 0;
+                }},
+                {"set_gravityY", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto value = script::get<double>(L, 2);
+
+                    particles->setGravityY(value);
+                    return 0;
+                }},
+                {"set_drag", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto value = script::get<double>(L, 2);
+
+                    particles->setDrag(value);
+                    return 0;
+                }},
+                {"set_mode", [](lua_State* L)
+                {
+                    auto particles = script::ptr<ParticleSystem>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    particles->setMode((BlendMode) value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.ParticleSystem = <function create>
+            script::push(L, "ParticleSystem");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto capacity = script::get<int>(L, 1);
+                auto particles = new ParticleSystem(size_t(std::max(capacity, 0)));
+                script::push(L, particles, LUA_NOREF);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
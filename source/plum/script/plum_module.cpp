@@ -5,9 +5,11 @@
 #endif
 
 #include "../core/file.h"
+#include "../core/font.h"
 #include "../core/color.h"
 #include "../core/input.h"
 #include "../core/timer.h"
+#include "../core/audio.h"
 #include "../core/screen.h"
 #include "../core/engine.h"
 #include "../core/blending.h"
@@ -43,6 +45,25 @@ namespace plum
             
                     return 0;
                 }},
+                {"serialize", [](lua_State* L)
+                {
+                    // plum.serialize(value, [compress = false]) returns a string that plum.deserialize turns back into the value.
+                    std::string out;
+                    luaL_checkany(L, 1);
+                    script::serialize(L, 1, script::get<bool>(L, 2, false), out);
+                    lua_pushlstring(L, out.data(), out.size());
+                    return 1;
+                }},
+                {"deserialize", [](lua_State* L)
+                {
+                    size_t length;
+                    const char* data = luaL_checklstring(L, 1, &length);
+                    if(!script::deserialize(L, data, length))
+                    {
+                        return luaL_error(L, "cannot deserialize: data is corrupt or from an unknown version");
+                    }
+                    return 1;
+                }},
                 {"sleep", [](lua_State* L)
                 {
                     auto ms = script::get<int>(L, 1);
@@ -68,16 +89,15 @@ namespace plum
                         auto hook = script.engine().addUpdateHook([L, ref, &done]()
                         {
                             lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
-                            lua_call(L, 0, 1);
-                            if(lua_toboolean(L, -1))
+                            if(script::callback(L, 0, 1))
                             {
-                                done = true;
+                                done = lua_toboolean(L, -1) != 0;
+                                lua_pop(L, 1);
                             }
-                            lua_pop(L, 1);
                         });
 
-                        // Call refresh until done.
-                        while(!done)
+                        // Call refresh until done, or until a callback has failed.
+                        while(!done && !script::hasCallbackError(L))
                         {
                             script.engine().refresh();
                         }
@@ -88,6 +108,10 @@ namespace plum
                     {
                         script.engine().refresh();
                     }
+
+                    // Errors in callbacks can't unwind through the engine, so they're raised here instead,
+                    // after everything above has been cleaned up.
+                    script::raiseCallbackError(L);
                     return 0;
                 }},
                 {nullptr, nullptr},
@@ -187,6 +211,18 @@ namespace plum
             lua_setfield(L, -2, "Subtract");
             lua_pop(L, 1);
 
+            // Create the 'align' table.
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "align");
+            script::push(L, int(TextAlign::Left));
+            lua_setfield(L, -2, "Left");
+            script::push(L, int(TextAlign::Center));
+            lua_setfield(L, -2, "Center");
+            script::push(L, int(TextAlign::Right));
+            lua_setfield(L, -2, "Right");
+            lua_pop(L, 1);
+
             // Create the 'open' table.
             lua_newtable(L);
             lua_pushvalue(L, -1);
@@ -197,6 +233,8 @@ namespace plum
             lua_setfield(L, -2, "Write");
             script::push(L, int(FileOpenMode::Append));
             lua_setfield(L, -2, "Append");
+            script::push(L, int(FileOpenMode::Map));
+            lua_setfield(L, -2, "Map");
             lua_pop(L, 1);
 
             // Create the 'seek' table.
@@ -223,11 +261,40 @@ namespace plum
             lua_setfield(L, -2, "Slow");
             lua_pop(L, 1);
 
+            // Create the 'steal' table.
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "steal");
+            script::push(L, int(VoiceSteal::Oldest));
+            lua_setfield(L, -2, "Oldest");
+            script::push(L, int(VoiceSteal::Quietest));
+            lua_setfield(L, -2, "Quietest");
+            lua_pop(L, 1);
+
+            // Create the 'resampler' table.
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "resampler");
+            script::push(L, int(Resampler::Linear));
+            lua_setfield(L, -2, "Linear");
+            script::push(L, int(Resampler::Cubic));
+            lua_setfield(L, -2, "Cubic");
+            script::push(L, int(Resampler::Sinc8));
+            lua_setfield(L, -2, "Sinc8");
+            script::push(L, int(Resampler::Sinc32));
+            lua_setfield(L, -2, "Sinc32");
+            lua_pop(L, 1);
+
             // Pop and store the library.
             lua_setglobal(L, "plum");
 
             // Load all the submodule and object definitions contained within Plum.
+            initGCModule(L);
             initTimerModule(L);
+            initProfilerModule(L);
+            initPackModule(L);
+            initCacheModule(L);
+            initAudioModule(L);
 
             initCanvasObject(L);
             initInputObject(L);
@@ -238,11 +305,19 @@ namespace plum
             initSheetObject(L);
             initSongObject(L);
             initSoundObject(L);
+            initBusObject(L);
             initScreenObject(L);
             initSpriteObject(L);
             initTilemapObject(L);
             initJoystickObject(L);
             initTransformObject(L);
+            initParticleEmitterObject(L);
+            initParticleSystemObject(L);
+            initSpatialHashObject(L);
+            initFontObject(L);
+            initTextObject(L);
+            initWorkerObject(L);
+            initBufferObject(L);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,316 @@
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+#include "../core/file.h"
+#include "profiler.h"
+
+namespace plum
+{
+    namespace
+    {
+        // In timer mode, how many instructions run between checks for a due sample.
+        const int TimerCheckInterval = 100;
+
+        // Its address identifies the profiler in the state's registry.
+        const char ProfilerKey = 0;
+    }
+
+    Profiler::Profiler(lua_State* L)
+        : L(L),
+        mode(ProfilerMode::Count),
+        interval(0),
+        running(false),
+        next(0),
+        count(0),
+        due(false),
+        ticking(false)
+    {
+    }
+
+    Profiler::~Profiler()
+    {
+        ticking.store(false);
+        if(ticker.joinable())
+        {
+            ticker.join();
+        }
+        if(!output.empty() && count)
+        {
+            dump(output);
+        }
+    }
+
+    bool Profiler::isRunning() const
+    {
+        return running;
+    }
+
+    ProfilerMode Profiler::getMode() const
+    {
+        return mode;
+    }
+
+    unsigned int Profiler::getInterval() const
+    {
+        return interval;
+    }
+
+    size_t Profiler::getSampleCount() const
+    {
+        return count;
+    }
+
+    const std::string& Profiler::getOutput() const
+    {
+        return output;
+    }
+
+    void Profiler::setOutput(const std::string& value)
+    {
+        output = value;
+    }
+
+    void Profiler::start(ProfilerMode mode, unsigned int interval)
+    {
+        stop();
+
+        this->mode = mode;
+        this->interval = std::max(interval, 1u);
+        running = true;
+        if(samples.empty())
+        {
+            samples.resize(Capacity * (MaxDepth + 1));
+        }
+        // Scripts can add bindings at any time (eg. by requiring something), so look again each start.
+        findBindings();
+
+        lua_pushlightuserdata(L, this);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &ProfilerKey);
+
+        if(mode == ProfilerMode::Count)
+        {
+            lua_sethook(L, hook, LUA_MASKCOUNT, int(this->interval));
+        }
+        else
+        {
+            // The ticker only raises a flag, since the Lua state can't be touched from another thread.
+            // Native functions don't run hooks, but their return does, which catches time spent inside them.
+            due.store(false);
+            ticking.store(true);
+            ticker = std::thread([this]()
+            {
+                while(ticking.load())
+                {
+                    std::this_thread::sleep_for(std::chrono::microseconds(this->interval));
+                    due.store(true);
+                }
+            });
+            lua_sethook(L, hook, LUA_MASKCOUNT | LUA_MASKRET, TimerCheckInterval);
+        }
+    }
+
+    void Profiler::stop()
+    {
+        if(!running)
+        {
+            return;
+        }
+
+        lua_sethook(L, nullptr, 0, 0);
+        ticking.store(false);
+        if(ticker.joinable())
+        {
+            ticker.join();
+        }
+        running = false;
+    }
+
+    void Profiler::clear()
+    {
+        next = 0;
+        count = 0;
+    }
+
+    std::string Profiler::report() const
+    {
+        std::map<std::string, size_t> stacks;
+        std::string stack;
+        for(size_t i = 0; i < count; ++i)
+        {
+            const uint32_t* slot = &samples[((next + Capacity - count + i) % Capacity) * (MaxDepth + 1)];
+            uint32_t depth = slot[0];
+
+            // Samples are stored innermost first, but collapsed stacks start from the root.
+            stack.clear();
+            for(uint32_t d = depth; d > 0; --d)
+            {
+                stack += frameNames[slot[d]];
+                if(d > 1)
+                {
+                    stack += ';';
+                }
+            }
+            ++stacks[stack];
+        }
+
+        std::string result;
+        for(const auto& it : stacks)
+        {
+            result += it.first + " " + std::to_string(it.second) + "\n";
+        }
+        return result;
+    }
+
+    bool Profiler::dump(const std::string& filename) const
+    {
+        File f(filename.c_str(), FileOpenMode::Write);
+        if(!f.isActive())
+        {
+            return false;
+        }
+
+        std::string text(report());
+        return f.writeRaw(text.data(), text.size()) == text.size();
+    }
+
+    void Profiler::sample(lua_State* L)
+    {
+        uint32_t* slot = &samples[next * (MaxDepth + 1)];
+        uint32_t depth = 0;
+
+        lua_Debug ar;
+        for(int level = 0; depth < MaxDepth && lua_getstack(L, level, &ar); ++level)
+        {
+            slot[1 + depth++] = getFrameId(L, ar);
+        }
+        slot[0] = depth;
+
+        next = (next + 1) % Capacity;
+        count = std::min(count + 1, size_t(Capacity));
+    }
+
+    uint32_t Profiler::getFrameId(lua_State* L, lua_Debug& ar)
+    {
+        lua_getinfo(L, "Snf", &ar);
+        bool native = lua_iscfunction(L, -1) != 0;
+
+        FrameKey key;
+        if(native)
+        {
+            key.id = uintptr_t(lua_tocfunction(L, -1));
+            key.line = -1;
+        }
+        else
+        {
+            // A chunk's source string and the line a function starts on identify the function.
+            key.id = uintptr_t(ar.source);
+            key.line = ar.linedefined;
+        }
+        lua_pop(L, 1);
+
+        auto it = frameIds.find(key);
+        if(it != frameIds.end())
+        {
+            return it->second;
+        }
+
+        std::string name;
+        if(native)
+        {
+            auto binding = bindings.find(key.id);
+            if(binding != bindings.end())
+            {
+                name = binding->second;
+            }
+            else
+            {
+                name = std::string(ar.name ? ar.name : "?") + " [C]";
+            }
+        }
+        else if(*ar.what == 'm')
+        {
+            name = std::string("main (") + ar.short_src + ")";
+        }
+        else
+        {
+            name = std::string(ar.name ? ar.name : "?") + " (" + ar.short_src + ":" + std::to_string(ar.linedefined) + ")";
+        }
+        // Semicolons separate frames in the output.
+        std::replace(name.begin(), name.end(), ';', ':');
+
+        uint32_t id = uint32_t(frameNames.size());
+        frameNames.push_back(name);
+        frameIds[key] = id;
+        return id;
+    }
+
+    void Profiler::findBindings()
+    {
+        bindings.clear();
+
+        // Every plum object's metatable is registered under its type name, eg. "plum.Canvas".
+        lua_pushnil(L);
+        while(lua_next(L, LUA_REGISTRYINDEX))
+        {
+            if(lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1))
+            {
+                std::string name(lua_tostring(L, -2));
+                if(name.compare(0, 5, "plum.") == 0)
+                {
+                    findBindings(lua_gettop(L), name);
+                }
+            }
+            lua_pop(L, 1);
+        }
+
+        // Then the functions in the plum table and its submodules, eg. plum.refresh and plum.color.rgb.
+        lua_getglobal(L, "plum");
+        if(lua_istable(L, -1))
+        {
+            int index = lua_gettop(L);
+            findBindings(index, "plum");
+
+            lua_pushnil(L);
+            while(lua_next(L, index))
+            {
+                if(lua_type(L, -2) == LUA_TSTRING && lua_istable(L, -1))
+                {
+                    findBindings(lua_gettop(L), std::string("plum.") + lua_tostring(L, -2));
+                }
+                lua_pop(L, 1);
+            }
+        }
+        lua_pop(L, 1);
+    }
+
+    void Profiler::findBindings(int index, const std::string& prefix)
+    {
+        lua_pushnil(L);
+        while(lua_next(L, index))
+        {
+            if(lua_type(L, -2) == LUA_TSTRING && lua_iscfunction(L, -1))
+            {
+                uintptr_t id = uintptr_t(lua_tocfunction(L, -1));
+                if(bindings.find(id) == bindings.end())
+                {
+                    bindings[id] = prefix + "." + lua_tostring(L, -2);
+                }
+            }
+            lua_pop(L, 1);
+        }
+    }
+
+    void Profiler::hook(lua_State* L, lua_Debug* ar)
+    {
+        lua_rawgetp(L, LUA_REGISTRYINDEX, &ProfilerKey);
+        auto profiler = (Profiler*) lua_touserdata(L, -1);
+        lua_pop(L, 1);
+
+        if(profiler && (profiler->mode == ProfilerMode::Count || profiler->due.exchange(false)))
+        {
+            profiler->sample(L);
+        }
+    }
+}
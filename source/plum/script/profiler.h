@@ -0,0 +1,104 @@
+#ifndef PLUM_PROFILER_H
+#define PLUM_PROFILER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+extern "C"
+{
+    #include <lua.h>
+}
+
+namespace plum
+{
+    enum class ProfilerMode
+    {
+        // Sample every so many Lua instructions.
+        Count,
+        // Sample every so many microseconds. Time spent inside native bindings is attributed to them.
+        Timer
+    };
+
+    // A sampling profiler for a Lua state. Stack traces are recorded into a ring buffer,
+    // and reported as collapsed stacks, which flame graph tools accept directly.
+    class Profiler
+    {
+        public:
+            static const size_t Capacity = 16384;
+            static const size_t MaxDepth = 48;
+
+            Profiler(lua_State* L);
+            // Writes the report to the output file, if one was given.
+            ~Profiler();
+
+            bool isRunning() const;
+            ProfilerMode getMode() const;
+            unsigned int getInterval() const;
+            size_t getSampleCount() const;
+            const std::string& getOutput() const;
+            void setOutput(const std::string& value);
+
+            void start(ProfilerMode mode, unsigned int interval);
+            void stop();
+            void clear();
+
+            // One "root;caller;callee count" line per distinct stack.
+            std::string report() const;
+            bool dump(const std::string& filename) const;
+
+        private:
+            struct FrameKey
+            {
+                uintptr_t id;
+                int line;
+
+                bool operator ==(const FrameKey& rhs) const
+                {
+                    return id == rhs.id && line == rhs.line;
+                }
+            };
+
+            struct FrameKeyHash
+            {
+                size_t operator()(const FrameKey& key) const
+                {
+                    return std::hash<uintptr_t>()(key.id) ^ (std::hash<int>()(key.line) << 1);
+                }
+            };
+
+            lua_State* L;
+            ProfilerMode mode;
+            unsigned int interval;
+            bool running;
+            std::string output;
+
+            // Each slot holds a depth followed by up to MaxDepth frame ids, innermost first.
+            std::vector<uint32_t> samples;
+            size_t next;
+            size_t count;
+
+            std::vector<std::string> frameNames;
+            std::unordered_map<FrameKey, uint32_t, FrameKeyHash> frameIds;
+            // Names of the native functions that plum registers, by address.
+            std::unordered_map<uintptr_t, std::string> bindings;
+
+            std::atomic<bool> due;
+            std::atomic<bool> ticking;
+            std::thread ticker;
+
+            void sample(lua_State* L);
+            uint32_t getFrameId(lua_State* L, lua_Debug& ar);
+            void findBindings();
+            void findBindings(int index, const std::string& prefix);
+            static void hook(lua_State* L, lua_Debug* ar);
+
+            Profiler(const Profiler&);
+            void operator =(const Profiler&);
+    };
+}
+
+#endif
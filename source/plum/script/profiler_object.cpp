@@ -0,0 +1,132 @@
+#include <cstring>
+#include <algorithm>
+
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            const char* const Meta = "plum.Profiler";
+
+            // Default sampling intervals, in instructions and microseconds respectively.
+            const int DefaultCountInterval = 1000;
+            const int DefaultTimerInterval = 1000;
+        }
+
+        void initProfilerModule(lua_State* L)
+        {
+            // Load profiler metatable
+            luaL_newmetatable(L, Meta);
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
+                {"__tostring", [](lua_State* L)
+                {
+                    script::push(L, Meta);
+                    return 1;
+                }},
+                {"__pairs", [](lua_State* L)
+                {
+                    lua_getglobal(L, "next");
+                    luaL_getmetatable(L, Meta);
+                    lua_pushnil(L);
+                    return 3;
+                }},
+                {"start", [](lua_State* L)
+                {
+                    // plum.profiler.start([mode = 'count'], [interval])
+                    auto name = script::get<const char*>(L, 1, "count");
+                    ProfilerMode mode;
+                    if(!std::strcmp(name, "count"))
+                    {
+                        mode = ProfilerMode::Count;
+                    }
+                    else if(!std::strcmp(name, "timer"))
+                    {
+                        mode = ProfilerMode::Timer;
+                    }
+                    else
+                    {
+                        return luaL_error(L, "Invalid profiler mode '%s'. Must be 'count' or 'timer'.", name);
+                    }
+
+                    auto interval = script::get<int>(L, 2, mode == ProfilerMode::Count ? DefaultCountInterval : DefaultTimerInterval);
+                    script::instance(L).profiler().start(mode, unsigned(std::max(interval, 1)));
+                    return 0;
+                }},
+                {"stop", [](lua_State* L)
+                {
+                    script::instance(L).profiler().stop();
+                    return 0;
+                }},
+                {"clear", [](lua_State* L)
+                {
+                    script::instance(L).profiler().clear();
+                    return 0;
+                }},
+                {"report", [](lua_State* L)
+                {
+                    auto report = script::instance(L).profiler().report();
+                    lua_pushlstring(L, report.data(), report.size());
+                    return 1;
+                }},
+                {"dump", [](lua_State* L)
+                {
+                    auto filename = script::get<const char*>(L, 1);
+                    script::push(L, script::instance(L).profiler().dump(filename));
+                    return 1;
+                }},
+                {"get_running", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).profiler().isRunning());
+                    return 1;
+                }},
+                {"get_samples", [](lua_State* L)
+                {
+                    script::push(L, int(script::instance(L).profiler().getSampleCount()));
+                    return 1;
+                }},
+                {"get_output", [](lua_State* L)
+                {
+                    script::push(L, script::instance(L).profiler().getOutput().c_str());
+                    return 1;
+                }},
+                {"set_output", [](lua_State* L)
+                {
+                    auto value = script::get<const char*>(L, 2);
+                    script::instance(L).profiler().setOutput(value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // Create profiler namespace
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_setfield(L, -3, "profiler");
+
+            luaL_getmetatable(L, Meta);
+            lua_setmetatable(L, -2);
+
+            // Pop profiler namespace.
+            lua_pop(L, 1);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -1,7 +1,13 @@
+#include <chrono>
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <unordered_map>
+#include <sys/stat.h>
+#include <zlib.h>
 
 #include "../core/file.h"
+#include "../core/pack.h"
 #include "../core/engine.h"
 #include "script.h"
 
@@ -10,6 +16,125 @@ namespace plum
     namespace
     {
         std::unordered_map<lua_State*, Script*> instances;
+
+        // How many budgets a refresh may spend collecting while the heap is over its limit.
+        const unsigned int OverLimitBudgets = 4;
+
+        // Prefix of a bytecode cache file. The version and source stamp must match
+        // the script exactly, or the cache is considered stale and gets rebuilt.
+        // The stamp also has a checksum of the source, which is only compared when the modification time
+        // can't be trusted to have changed (see loadFile), so most loads don't read the source at all.
+        struct CacheHeader
+        {
+            char magic[4];
+            char version[12];
+            uint64_t modified;
+            uint64_t size;
+            uint64_t checksum;
+        };
+
+        const char CacheMagic[4] = {'P', 'L', 'U', 'M'};
+        const char CacheVersion[12] = LUA_VERSION_MAJOR "." LUA_VERSION_MINOR "." LUA_VERSION_RELEASE;
+
+        bool readFile(const std::string& filename, std::vector<char>& buf)
+        {
+            File f(filename.c_str(), FileOpenMode::Read);
+            if(!f.isActive())
+            {
+                return false;
+            }
+
+            f.seek(0, FileSeekMode::End);
+            auto length = f.tell();
+            f.seek(0, FileSeekMode::Start);
+
+            buf.resize(length);
+            return f.readRaw(buf.data(), length) == size_t(length);
+        }
+
+        // Modification time in nanoseconds, where the platform keeps that much.
+        uint64_t getModifiedTime(const struct stat& info)
+        {
+#ifdef _WIN32
+            return uint64_t(info.st_mtime) * 1000000000;
+#else
+            return uint64_t(info.st_mtim.tv_sec) * 1000000000 + uint64_t(info.st_mtim.tv_nsec);
+#endif
+        }
+
+        uint64_t getChecksum(const std::vector<char>& source)
+        {
+            return crc32(crc32(0, Z_NULL, 0), (const Bytef*) source.data(), uInt(source.size()));
+        }
+
+        // Checks everything in the stamp but the checksum, which is handed back to compare if needed.
+        bool readCache(const std::string& filename, const CacheHeader& stamp, std::vector<char>& buf, uint64_t& checksum)
+        {
+            CacheHeader header;
+            if(!readFile(filename, buf) || buf.size() < sizeof(header))
+            {
+                return false;
+            }
+            std::memcpy(&header, buf.data(), sizeof(header));
+            if(std::memcmp(header.magic, stamp.magic, sizeof(header.magic))
+                || std::memcmp(header.version, stamp.version, sizeof(header.version))
+                || header.modified != stamp.modified
+                || header.size != stamp.size)
+            {
+                return false;
+            }
+            checksum = header.checksum;
+            buf.erase(buf.begin(), buf.begin() + sizeof(header));
+            return true;
+        }
+
+        // Like package.searchpath, but looks in the mounted packs instead of the filesystem.
+        bool searchPacks(const std::string& name, const std::string& path, std::string& filename)
+        {
+            std::string module(name);
+            std::replace(module.begin(), module.end(), '.', '/');
+
+            size_t start = 0;
+            while(start <= path.size())
+            {
+                size_t end = std::min(path.find(';', start), path.size());
+                std::string candidate(path, start, end - start);
+                start = end + 1;
+
+                for(size_t i = candidate.find('?'); i != std::string::npos; i = candidate.find('?', i + module.size()))
+                {
+                    candidate.replace(i, 1, module);
+                }
+
+                PackEntry entry;
+                if(!candidate.empty() && findPack(candidate, entry))
+                {
+                    filename = candidate;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void writeCache(lua_State* L, const std::string& filename, const CacheHeader& stamp)
+        {
+            // Assumes the compiled chunk is at the top of the stack.
+            std::vector<char> buf(sizeof(stamp));
+            std::memcpy(buf.data(), &stamp, sizeof(stamp));
+            lua_dump(L, [](lua_State* L, const void* p, size_t size, void* ud)
+            {
+                auto& buf = *(std::vector<char>*) ud;
+                buf.insert(buf.end(), (const char*) p, (const char*) p + size);
+                return 0;
+            }, &buf);
+
+            // Failing to write is fine (eg. read-only install directory), the source still works.
+            File f(filename.c_str(), FileOpenMode::Write);
+            if(f.isActive())
+            {
+                f.writeRaw(buf.data(), buf.size());
+            }
+        }
     }
 
     Script::Script(int argc, char** argv, Engine& engine, Timer& timer, Audio& audio)
@@ -18,7 +143,13 @@ namespace plum
         argv_(argv),
         engine_(engine),
         timer_(timer),
-        audio_(audio)
+        audio_(audio),
+        profiler_(L),
+        gcBudget_(0),
+        gcLimit_(0),
+        gcStepTime_(0),
+        gcCycles_(0),
+        bytecodeCache_(true)
     {
         luaL_openlibs(L);
         lua_gc(L, LUA_GCSETSTEPMUL, 400);
@@ -27,41 +158,318 @@ namespace plum
         script::initLibrary(L);
 
         luaL_dostring(L, "package.path = package.path .. ';?.lua;?/init.lua;?\\\\init.lua'");
+        script::initSearcher(L);
+
+        // Screens are opened by scripts, so this runs before any of them present their frame.
+        gcHook_ = engine.addUpdateHook([this](){ step(); });
     }
 
     Script::~Script()
     {
+        gcHook_.reset();
+        profiler_.stop();
         lua_close(L);
         instances.erase(L);
     }
 
-    void Script::run(const std::string& filename)
+    unsigned int Script::getGCBudget() const
+    {
+        return gcBudget_;
+    }
+
+    void Script::setGCBudget(unsigned int value)
+    {
+        if(value && !gcBudget_)
+        {
+            lua_gc(L, LUA_GCSTOP, 0);
+        }
+        else if(!value && gcBudget_)
+        {
+            lua_gc(L, LUA_GCRESTART, 0);
+        }
+        gcBudget_ = value;
+    }
+
+    unsigned int Script::getGCLimit() const
+    {
+        return gcLimit_;
+    }
+
+    void Script::setGCLimit(unsigned int value)
+    {
+        gcLimit_ = value;
+    }
+
+    double Script::getGCHeapSize() const
+    {
+        return lua_gc(L, LUA_GCCOUNT, 0) + lua_gc(L, LUA_GCCOUNTB, 0) / 1024.0;
+    }
+
+    unsigned int Script::getGCStepTime() const
+    {
+        return gcStepTime_;
+    }
+
+    unsigned int Script::getGCCycles() const
+    {
+        return gcCycles_;
+    }
+
+    void Script::collect()
+    {
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        ++gcCycles_;
+    }
+
+    void Script::step()
+    {
+        if(!gcBudget_)
+        {
+            return;
+        }
+
+        // Steps can run __gc metamethods, whose errors mustn't unwind through the engine.
+        // So they run in a protected call, and an error is raised by the refresh that ran this hook.
+        lua_pushcfunction(L, [](lua_State* L)
+        {
+            ((Script*) lua_touserdata(L, 1))->collectSteps();
+            return 0;
+        });
+        lua_pushlightuserdata(L, this);
+        script::callback(L, 1);
+    }
+
+    void Script::collectSteps()
     {
-        File f(filename.c_str(), FileOpenMode::Read);
-        if(!f.isActive())
+        typedef std::chrono::high_resolution_clock Clock;
+        auto start = Clock::now();
+        auto deadline = start + std::chrono::microseconds(gcBudget_);
+        // Even over the heap limit, a single refresh can't stall the frame for more than a few budgets.
+        auto hardDeadline = start + std::chrono::microseconds(gcBudget_ * OverLimitBudgets);
+
+        while(true)
         {
-            throw std::runtime_error("The script file '" + filename + "' was not found.");
+            bool finished = lua_gc(L, LUA_GCSTEP, 0) != 0;
+            if(finished)
+            {
+                ++gcCycles_;
+            }
+
+            // Past the heap limit, keep going beyond the budget, until the heap shrinks or a cycle is done.
+            if(gcLimit_ && unsigned(lua_gc(L, LUA_GCCOUNT, 0)) >= gcLimit_)
+            {
+                if(finished || Clock::now() >= hardDeadline)
+                {
+                    break;
+                }
+            }
+            else if(finished || Clock::now() >= deadline)
+            {
+                break;
+            }
         }
-        
-        f.seek(0, FileSeekMode::End);
-        auto length = f.tell();
-        f.seek(0, FileSeekMode::Start);
 
-        std::vector<char> buf(length);
-        f.readRaw(buf.data(), length);
+        gcStepTime_ = unsigned(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+    }
 
-        std::string scriptname("@" + filename);
-        if(luaL_loadbuffer(L, buf.data(), buf.size(), scriptname.c_str()) || lua_pcall(L, 0, LUA_MULTRET, 0))
+    void Script::run(const std::string& filename)
+    {
+        switch(script::loadFile(L, filename, bytecodeCache_))
+        {
+            case LUA_OK:
+                break;
+            case LUA_ERRFILE:
+                throw std::runtime_error("The script file '" + filename + "' was not found.");
+            default:
+                throw std::runtime_error("Error found in script:\r\n" + std::string(lua_tostring(L, -1)));
+        }
+        if(lua_pcall(L, 0, LUA_MULTRET, 0))
         {
             throw std::runtime_error("Error found in script:\r\n" + std::string(lua_tostring(L, -1)));
         }
     }
 
+    bool Script::getBytecodeCache() const
+    {
+        return bytecodeCache_;
+    }
+
+    void Script::setBytecodeCache(bool value)
+    {
+        bytecodeCache_ = value;
+    }
+
     namespace script
     {
         Script& instance(lua_State* L)
         {
             return *instances[L];
         }
+
+        int loadFile(lua_State* L, const std::string& filename, bool cache)
+        {
+            std::string chunkname("@" + filename);
+            std::vector<char> buf;
+
+            // Scripts in a pack aren't cached, since there's no loose file to stamp the cache with.
+            // A pack can hold precompiled chunks instead, so those are allowed to load as binary.
+            PackEntry entry;
+            if(findPack(filename, entry))
+            {
+                if(!readFile(filename, buf))
+                {
+                    lua_pushfstring(L, "cannot read %s", filename.c_str());
+                    return LUA_ERRFILE;
+                }
+                return luaL_loadbufferx(L, buf.data(), buf.size(), chunkname.c_str(), "bt");
+            }
+
+            struct stat info;
+            if(stat(filename.c_str(), &info) != 0)
+            {
+                lua_pushfstring(L, "cannot open %s", filename.c_str());
+                return LUA_ERRFILE;
+            }
+
+            CacheHeader stamp;
+            std::memset(&stamp, 0, sizeof(stamp));
+            std::memcpy(stamp.magic, CacheMagic, sizeof(stamp.magic));
+            std::memcpy(stamp.version, CacheVersion, sizeof(stamp.version));
+            stamp.modified = getModifiedTime(info);
+            stamp.size = uint64_t(info.st_size);
+
+            std::vector<char> source;
+            bool read = false;
+            std::string cachename(filename + "c");
+            uint64_t checksum = 0;
+            if(cache && readCache(cachename, stamp, buf, checksum))
+            {
+                // If the source was saved no earlier than the second the cache was written in, it could have been
+                // saved again since without its time changing, on filesystems with coarse times. Only then
+                // is the source read, to compare checksums.
+                struct stat written;
+                bool racy = stat(cachename.c_str(), &written) != 0 || info.st_mtime >= written.st_mtime;
+                if(racy)
+                {
+                    read = readFile(filename, source);
+                    stamp.checksum = getChecksum(source);
+                }
+
+                if(!racy || (read && checksum == stamp.checksum))
+                {
+                    if(luaL_loadbufferx(L, buf.data(), buf.size(), chunkname.c_str(), "b") == LUA_OK)
+                    {
+                        if(racy)
+                        {
+                            // Writing it again moves the cache's time on, so the next load can skip the check.
+                            writeCache(L, cachename, stamp);
+                        }
+                        return LUA_OK;
+                    }
+                    // Unusable cache, so discard the error and recompile.
+                    lua_pop(L, 1);
+                }
+            }
+
+            if(!read && !readFile(filename, source))
+            {
+                lua_pushfstring(L, "cannot read %s", filename.c_str());
+                return LUA_ERRFILE;
+            }
+
+            int status = luaL_loadbufferx(L, source.data(), source.size(), chunkname.c_str(), "t");
+            if(status == LUA_OK && cache)
+            {
+                stamp.checksum = getChecksum(source);
+                writeCache(L, cachename, stamp);
+            }
+            return status;
+        }
+
+        void initSearcher(lua_State* L)
+        {
+            lua_getglobal(L, "package");
+            lua_getfield(L, -1, "searchers");
+
+            // Shift the searchers up to make room for this one,
+            // after the preload searcher but before the Lua source searcher.
+            for(int i = int(lua_rawlen(L, -1)); i >= 2; --i)
+            {
+                lua_rawgeti(L, -1, i);
+                lua_rawseti(L, -2, i + 1);
+            }
+
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto name = script::get<const char*>(L, 1);
+                std::string filename;
+
+                // Mounted packs come first, the same as for any other file.
+                lua_getglobal(L, "package");
+                lua_getfield(L, -1, "path");
+                if(!searchPacks(name, script::get<const char*>(L, -1, ""), filename))
+                {
+                    lua_pop(L, 1);
+
+                    // filename = package.searchpath(name, package.path)
+                    lua_getfield(L, -1, "searchpath");
+                    lua_pushvalue(L, 1);
+                    lua_getfield(L, -3, "path");
+                    lua_call(L, 2, 2);
+                    if(lua_isnil(L, -2))
+                    {
+                        // Return searchpath's explanation of where it looked.
+                        return 1;
+                    }
+                    filename = lua_tostring(L, -2);
+                }
+                if(loadFile(L, filename, script::instance(L).getBytecodeCache()) != LUA_OK)
+                {
+                    return luaL_error(L, "error loading module " LUA_QS " from file " LUA_QS ":\n\t%s",
+                        name, filename.c_str(), lua_tostring(L, -1));
+                }
+                script::push(L, filename.c_str());
+                return 2;
+            });
+            lua_rawseti(L, -2, 2);
+
+            // Pop searchers and package.
+            lua_pop(L, 2);
+        }
+
+        const char GettersKey = 0;
+        const char SettersKey = 0;
+
+        void initProperties(lua_State* L)
+        {
+            // Assumes the metatable is at the top of the stack.
+            lua_newtable(L);
+            lua_newtable(L);
+
+            // Sort every get_<name> and set_<name> member into getters[name] and setters[name].
+            lua_pushnil(L);
+            while(lua_next(L, -4))
+            {
+                if(lua_type(L, -2) == LUA_TSTRING && lua_isfunction(L, -1))
+                {
+                    size_t length = 0;
+                    const char* key = lua_tolstring(L, -2, &length);
+                    if(length > 4 && (!std::strncmp(key, "get_", 4) || !std::strncmp(key, "set_", 4)))
+                    {
+                        lua_pushlstring(L, key + 4, length - 4);
+                        lua_pushvalue(L, -2);
+                        lua_rawset(L, key[0] == 'g' ? -6 : -5);
+                    }
+                }
+                lua_pop(L, 1);
+            }
+
+            pushPropertyKey(L, PropertySlot::Setters);
+            lua_insert(L, -2);
+            lua_rawset(L, -4);
+            pushPropertyKey(L, PropertySlot::Getters);
+            lua_insert(L, -2);
+            lua_rawset(L, -3);
+        }
     }
 }
@@ -1,9 +1,12 @@
 #ifndef PLUM_SCRIPT_H
 #define PLUM_SCRIPT_H
 
+#include <new>
+#include <memory>
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <functional>
 
 extern "C"
 {
@@ -13,6 +16,9 @@ extern "C"
     #include <lauxlib.h>
 }
 
+#include "profiler.h"
+#include "../core/buffer.h"
+
 namespace plum
 {
     class Engine;
@@ -53,8 +59,35 @@ namespace plum
                 return audio_;
             }
 
+            Profiler& profiler()
+            {
+                return profiler_;
+            }
+
             void run(const std::string& filename);
 
+            // If enabled, compiled scripts are saved next to their source (as .luac),
+            // and reused by run and require until the source changes.
+            bool getBytecodeCache() const;
+            void setBytecodeCache(bool value);
+
+            // Garbage collection budget in microseconds per refresh.
+            // If non-zero, the automatic collector is stopped, and instead the engine does
+            // incremental collection steps in the idle time before each frame is presented.
+            unsigned int getGCBudget() const;
+            void setGCBudget(unsigned int value);
+            // Heap size in kilobytes past which a refresh keeps collecting beyond its budget,
+            // up to four times the budget. 0 = no limit.
+            unsigned int getGCLimit() const;
+            void setGCLimit(unsigned int value);
+            // Size of the Lua heap, in kilobytes.
+            double getGCHeapSize() const;
+            // Time spent collecting during the last refresh, in microseconds.
+            unsigned int getGCStepTime() const;
+            // Number of collection cycles completed by the engine-managed collector.
+            unsigned int getGCCycles() const;
+            void collect();
+
         private:
             lua_State* L;
             int argc_;
@@ -62,6 +95,17 @@ namespace plum
             Engine& engine_;
             Timer& timer_;
             Audio& audio_;
+            Profiler profiler_;
+
+            unsigned int gcBudget_;
+            unsigned int gcLimit_;
+            unsigned int gcStepTime_;
+            unsigned int gcCycles_;
+            std::shared_ptr<std::function<void()>> gcHook_;
+            bool bytecodeCache_;
+
+            void step();
+            void collectSteps();
 
             Script(const Script&);
             void operator =(const Script&);
@@ -71,11 +115,123 @@ namespace plum
     {
         Script& instance(lua_State* L);
 
+        // Loads a script file as a function onto the stack, or an error message on failure.
+        // Returns a lua_load status, or LUA_ERRFILE if the file couldn't be opened.
+        int loadFile(lua_State* L, const std::string& filename, bool cache);
+        // Adds a package.searchers entry so that require goes through loadFile.
+        void initSearcher(lua_State* L);
+
+        // Calls a Lua function from C++ code that an error mustn't unwind through, like an engine update hook.
+        // The function and its arguments are replaced by its results. An error is held onto instead of raised,
+        // and false is returned with nothing pushed.
+        bool callback(lua_State* L, int args, int results = 0);
+        bool hasCallbackError(lua_State* L);
+        // Raises the error held by callback, if there is one. Call this once it's safe to unwind again.
+        void raiseCallbackError(lua_State* L);
+
+        typedef std::vector<std::shared_ptr<Buffer::Storage>> Attachments;
+
+        // Appends the value at the given index (nil, boolean, number, string, plum.Buffer or a table of these)
+        // to out as bytes. Raises a Lua error for any other type. A table that appears more than once is only
+        // packed the first time, so shared and cyclic tables come back the same way. If attachments is given,
+        // buffers are moved into it instead of being copied into out, which leaves them empty (see Buffer::release).
+        // That only happens once the whole value has packed, so an error leaves them alone.
+        void pack(lua_State* L, int index, std::string& out, Attachments* attachments = nullptr);
+        // Pushes the packed value starting at data[pos], and moves pos past it. Returns false if the data is malformed.
+        bool unpack(lua_State* L, const char* data, size_t size, size_t& pos, const Attachments* attachments = nullptr);
+        // Like pack, but with a versioned header in front, so it's fit to be saved to disk, and optionally zlib compressed.
+        void serialize(lua_State* L, int index, bool compress, std::string& out);
+        // Pushes the value from a serialized string. Returns false if it's malformed or from an unknown version.
+        bool deserialize(lua_State* L, const char* data, size_t size);
+
+        // Reads a data type name like 'u8', 'i16' or 'f32', with an optional 'le' or 'be' suffix
+        // for the byte order (little endian if left off). Raises a Lua error if the name isn't valid.
+        void checkDataType(lua_State* L, int index, DataType& type, ByteOrder& order);
+
         template<typename T> const char* meta();
         template<typename T> T get(lua_State* L, int index);
         template<typename T> T get(lua_State* L, int index, T fallback);
         template<typename T> T push(lua_State* L, T value);
 
+        // Slots in an object's metatable that hold its property tables.
+        // Each maps a field name to the get_/set_ function of the same name,
+        // so that a property access is a raw table lookup instead of a string concatenation.
+        enum class PropertySlot
+        {
+            Getters,
+            Setters,
+        };
+
+        // Their addresses are the keys the property tables are stored under.
+        extern const char GettersKey;
+        extern const char SettersKey;
+
+        // Pushes the key a property table is stored under. It's a light userdata rather than a number,
+        // so scripts can't reach the tables through obj[1] and they don't collide with any field name.
+        inline void pushPropertyKey(lua_State* L, PropertySlot slot)
+        {
+            lua_pushlightuserdata(L, (void*) (slot == PropertySlot::Getters ? &GettersKey : &SettersKey));
+        }
+
+        // Builds the property tables for the metatable on the top of the stack.
+        void initProperties(lua_State* L);
+
+        inline int index(lua_State* L)
+        {
+            // Properties and methods are all named, so anything else is just missing.
+            if(lua_type(L, 2) != LUA_TSTRING)
+            {
+                lua_pushnil(L);
+                return 1;
+            }
+
+            lua_getmetatable(L, 1);
+            pushPropertyKey(L, PropertySlot::Getters);
+            lua_rawget(L, -2);
+            if(lua_istable(L, -1))
+            {
+                lua_pushvalue(L, 2);
+                lua_rawget(L, -2);
+                if(!lua_isnil(L, -1))
+                {
+                    lua_pushvalue(L, 1);
+                    lua_call(L, 1, 1);
+                    return 1;
+                }
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 1);
+            // Not a property, so look for a method of this name instead.
+            lua_pushvalue(L, 2);
+            lua_rawget(L, -2);
+            return 1;
+        }
+
+        inline int newindex(lua_State* L)
+        {
+            if(lua_type(L, 2) != LUA_TSTRING)
+            {
+                return 0;
+            }
+
+            lua_getmetatable(L, 1);
+            pushPropertyKey(L, PropertySlot::Setters);
+            lua_rawget(L, -2);
+            if(lua_istable(L, -1))
+            {
+                lua_pushvalue(L, 2);
+                lua_rawget(L, -2);
+                if(!lua_isnil(L, -1))
+                {
+                    /* L, 3 is the value to set. */
+                    lua_pushvalue(L, 1);
+                    lua_pushvalue(L, 3);
+                    lua_call(L, 2, 0);
+                }
+            }
+            return 0;
+        }
+
         template<typename T> struct Wrapper
         {
             T* data;
@@ -84,6 +240,9 @@ namespace plum
             int parentRef;
             // Reference to any 'extra' data that Lua needs to manage.
             int attributeTableRef;
+            // If true, the data is stored inside this userdata block rather than separately allocated,
+            // so it only needs to be destructed (see pushValue).
+            bool inlined;
 
             void pushAttributeTable(lua_State* L)
             {
@@ -127,7 +286,14 @@ namespace plum
                 // Only delete if it doesn't belong to a parent of some sort.
                 if(parentRef == LUA_NOREF)
                 {
-                    delete data;
+                    if(inlined)
+                    {
+                        data->~T();
+                    }
+                    else
+                    {
+                        delete data;
+                    }
                 }
                 else
                 {
@@ -138,27 +304,12 @@ namespace plum
 
             int index(lua_State* L)
             {
-                std::string fieldName(get<const char*>(L, 2));
-                if(luaL_getmetafield(L, 1, std::string("get_" + fieldName).c_str()))
-                {
-                    lua_pushvalue(L, 1);
-                    lua_call(L, 1, 1);
-                    return 1;
-                }
-                return luaL_getmetafield(L, 1, fieldName.c_str());
+                return script::index(L);
             }
 
             int newindex(lua_State* L)
             {
-                std::string fieldName(get<const char*>(L, 2));
-                /* L, 3 is the value to set. */
-                if(luaL_getmetafield(L, 1, std::string("set_" + fieldName).c_str()))
-                {
-                    lua_pushvalue(L, 1);
-                    lua_pushvalue(L, 3);
-                    lua_call(L, 2, 0);
-                }
-                return 0;
+                return script::newindex(L);
             }
 
             int tostring(lua_State* L)
@@ -271,6 +422,11 @@ namespace plum
             return lua_toboolean(L, index) != 0;
         }
 
+        template<> inline bool get<bool>(lua_State* L, int index, bool fallback)
+        {
+            return lua_isnoneornil(L, index) ? fallback : lua_toboolean(L, index) != 0;
+        }
+
         template<> inline char push<char>(lua_State* L, char value)
         {
             lua_pushinteger(L, value);
@@ -358,13 +514,58 @@ namespace plum
             w->data = data;
             w->parentRef = parentRef;
             w->attributeTableRef = LUA_NOREF;
+            w->inlined = false;
+
+            return w;
+        }
+
+        // Userdata layout for objects stored inline with their wrapper.
+        template<typename T> struct InlineWrapper
+        {
+            Wrapper<T> wrapper;
+            T value;
+        };
+
+        template<typename T> Wrapper<T>* pushInline(lua_State* L, InlineWrapper<T>* block)
+        {
+            // Only attach the metatable once the value is constructed, so __gc never sees a partial object.
+            luaL_getmetatable(L, meta<T>());
+            lua_setmetatable(L, -2);
+
+            auto w = &block->wrapper;
+            w->data = &block->value;
+            w->parentRef = LUA_NOREF;
+            w->attributeTableRef = LUA_NOREF;
+            w->inlined = true;
 
             return w;
         }
 
+        // Pushes a default-constructed T that lives inside the userdata itself.
+        // Saves an allocation (and a pointer chase) for small value types.
+        template<typename T> Wrapper<T>* pushValue(lua_State* L)
+        {
+            auto block = (InlineWrapper<T>*) lua_newuserdata(L, sizeof(InlineWrapper<T>));
+            new(&block->value) T();
+            return pushInline(L, block);
+        }
+
+        // Pushes a copy of value that lives inside the userdata itself.
+        template<typename T> Wrapper<T>* pushValue(lua_State* L, const T& value)
+        {
+            auto block = (InlineWrapper<T>*) lua_newuserdata(L, sizeof(InlineWrapper<T>));
+            new(&block->value) T(value);
+            return pushInline(L, block);
+        }
+
         void initLibrary(lua_State* L);
 
+        void initGCModule(lua_State* L);
         void initTimerModule(lua_State* L);
+        void initProfilerModule(lua_State* L);
+        void initPackModule(lua_State* L);
+        void initCacheModule(lua_State* L);
+        void initAudioModule(lua_State* L);
 
         void initCanvasObject(lua_State* L);
         void initInputObject(lua_State* L);
@@ -375,11 +576,19 @@ namespace plum
         void initSheetObject(lua_State* L);
         void initSongObject(lua_State* L);
         void initSoundObject(lua_State* L);
+        void initBusObject(lua_State* L);
         void initScreenObject(lua_State* L);
         void initSpriteObject(lua_State* L);
         void initTilemapObject(lua_State* L);
         void initJoystickObject(lua_State* L);
         void initTransformObject(lua_State* L);
+        void initParticleEmitterObject(lua_State* L);
+        void initParticleSystemObject(lua_State* L);
+        void initSpatialHashObject(lua_State* L);
+        void initFontObject(lua_State* L);
+        void initTextObject(lua_State* L);
+        void initWorkerObject(lua_State* L);
+        void initBufferObject(lua_State* L);
 
         void pushAxisObject(lua_State* L, Axis& mouse);
         void pushMouseObject(lua_State* L, Mouse& mouse);
@@ -0,0 +1,462 @@
+#include <cmath>
+#include <cstring>
+#include <zlib.h>
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        namespace
+        {
+            // Tables nested deeper than this would risk overflowing the C stack.
+            const int MaxDepth = 200;
+
+            // The header in front of everything made by serialize: a magic number, version and flags.
+            const char Magic[] = {'P', 'L', 'S', 'V'};
+            const uint8_t Version = 1;
+            const uint8_t CompressedFlag = 1;
+            const size_t HeaderSize = sizeof(Magic) + 2;
+
+            enum Tag : char
+            {
+                NilTag = 'n',
+                FalseTag = 'f',
+                TrueTag = 't',
+                NumberTag = 'd',
+                // A number with no fractional part that fits in an int32, stored in 4 bytes instead of 8.
+                IntegerTag = 'i',
+                StringTag = 's',
+                TableTag = 'T',
+                EndTag = 'e',
+                // A table already packed earlier in the same value, followed by its uint32 number
+                // (the order that tables were first seen in). This is how shared and cyclic tables survive.
+                ReferenceTag = 'r',
+                // Buffer bytes stored inline, with a uint32 length like strings.
+                BufferTag = 'b',
+                // A buffer moved into the attachments, followed by its uint32 index there.
+                AttachmentTag = 'B'
+            };
+
+            // Tables that have been packed so far are kept in a table at seen, mapping each to its number.
+            // Unpacking keeps the reverse, each number to the table made for it.
+            // Buffers headed for the attachments are mapped to their slot in seen too, and listed in order
+            // at buffers, so they're only released once the whole value has packed without an error.
+            struct Packer
+            {
+                int seen;
+                int buffers;
+                uint32_t tables;
+                uint32_t slots;
+                std::string& out;
+                Attachments* attachments;
+            };
+
+            struct Unpacker
+            {
+                int seen;
+                uint32_t tables;
+                const char* data;
+                size_t size;
+                size_t& pos;
+                const Attachments* attachments;
+            };
+
+            void packValue(lua_State* L, int index, Packer& packer, int depth)
+            {
+                std::string& out(packer.out);
+                switch(lua_type(L, index))
+                {
+                    case LUA_TNIL:
+                        out.push_back(NilTag);
+                        break;
+                    case LUA_TBOOLEAN:
+                        out.push_back(lua_toboolean(L, index) ? TrueTag : FalseTag);
+                        break;
+                    case LUA_TNUMBER:
+                    {
+                        lua_Number value = lua_tonumber(L, index);
+                        // Range and integrality are checked before the cast, which is undefined
+                        // for NaN, infinities and anything outside int32. The sign check keeps -0
+                        // a double, since it would come back as 0.
+                        if(value >= -2147483648.0 && value <= 2147483647.0 && std::trunc(value) == value
+                            && (value != 0 || !std::signbit(value)))
+                        {
+                            int32_t integer = int32_t(value);
+                            out.push_back(IntegerTag);
+                            out.append((const char*) &integer, sizeof(integer));
+                        }
+                        else
+                        {
+                            out.push_back(NumberTag);
+                            out.append((const char*) &value, sizeof(value));
+                        }
+                        break;
+                    }
+                    case LUA_TSTRING:
+                    {
+                        size_t length = 0;
+                        const char* s = lua_tolstring(L, index, &length);
+                        uint32_t size = uint32_t(length);
+                        out.push_back(StringTag);
+                        out.append((const char*) &size, sizeof(size));
+                        out.append(s, length);
+                        break;
+                    }
+                    case LUA_TTABLE:
+                    {
+                        luaL_checkstack(L, 3, "table too deeply nested");
+                        index = lua_absindex(L, index);
+
+                        lua_pushvalue(L, index);
+                        lua_rawget(L, packer.seen);
+                        if(lua_isnumber(L, -1))
+                        {
+                            uint32_t number = uint32_t(lua_tointeger(L, -1));
+                            lua_pop(L, 1);
+                            out.push_back(ReferenceTag);
+                            out.append((const char*) &number, sizeof(number));
+                            break;
+                        }
+                        lua_pop(L, 1);
+
+                        if(depth >= MaxDepth)
+                        {
+                            luaL_error(L, "cannot pack a table nested more than %d deep", MaxDepth);
+                        }
+
+                        // Numbered before its contents are packed, so anything inside can refer back to it.
+                        lua_pushvalue(L, index);
+                        lua_pushinteger(L, lua_Integer(packer.tables++));
+                        lua_rawset(L, packer.seen);
+
+                        out.push_back(TableTag);
+                        lua_pushnil(L);
+                        while(lua_next(L, index))
+                        {
+                            packValue(L, -2, packer, depth + 1);
+                            packValue(L, -1, packer, depth + 1);
+                            lua_pop(L, 1);
+                        }
+                        out.push_back(EndTag);
+                        break;
+                    }
+                    case LUA_TUSERDATA:
+                    {
+                        auto wrapper = (Wrapper<Buffer>*) luaL_testudata(L, index, meta<Buffer>());
+                        if(!wrapper)
+                        {
+                            luaL_error(L, "cannot pack a value of type %s", luaL_typename(L, index));
+                        }
+
+                        Buffer& buffer(*wrapper->data);
+                        if(packer.attachments)
+                        {
+                            // A buffer that shows up more than once is attached once, and every mention shares the slot.
+                            uint32_t slot;
+                            lua_pushvalue(L, index);
+                            lua_rawget(L, packer.seen);
+                            if(lua_isnumber(L, -1))
+                            {
+                                slot = uint32_t(lua_tointeger(L, -1));
+                                lua_pop(L, 1);
+                            }
+                            else
+                            {
+                                lua_pop(L, 1);
+                                slot = uint32_t(packer.attachments->size()) + packer.slots++;
+                                lua_pushvalue(L, index);
+                                lua_pushinteger(L, lua_Integer(slot));
+                                lua_rawset(L, packer.seen);
+                                lua_pushvalue(L, index);
+                                lua_rawseti(L, packer.buffers, int(packer.slots));
+                            }
+                            out.push_back(AttachmentTag);
+                            out.append((const char*) &slot, sizeof(slot));
+                        }
+                        else
+                        {
+                            uint32_t size = uint32_t(buffer.getSize());
+                            out.push_back(BufferTag);
+                            out.append((const char*) &size, sizeof(size));
+                            out.append((const char*) buffer.getData(), size);
+                        }
+                        break;
+                    }
+                    default:
+                        luaL_error(L, "cannot pack a value of type %s", luaL_typename(L, index));
+                }
+            }
+
+            bool unpackValue(lua_State* L, Unpacker& unpacker, int depth)
+            {
+                const char* data = unpacker.data;
+                size_t size = unpacker.size;
+                size_t& pos(unpacker.pos);
+                const Attachments* attachments = unpacker.attachments;
+
+                if(pos >= size || depth >= MaxDepth || !lua_checkstack(L, 3))
+                {
+                    return false;
+                }
+
+                switch(data[pos++])
+                {
+                    case NilTag:
+                        lua_pushnil(L);
+                        return true;
+                    case FalseTag:
+                        lua_pushboolean(L, 0);
+                        return true;
+                    case TrueTag:
+                        lua_pushboolean(L, 1);
+                        return true;
+                    case NumberTag:
+                    {
+                        lua_Number value;
+                        if(size - pos < sizeof(value))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&value, data + pos, sizeof(value));
+                        pos += sizeof(value);
+                        lua_pushnumber(L, value);
+                        return true;
+                    }
+                    case IntegerTag:
+                    {
+                        int32_t value;
+                        if(size - pos < sizeof(value))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&value, data + pos, sizeof(value));
+                        pos += sizeof(value);
+                        lua_pushnumber(L, lua_Number(value));
+                        return true;
+                    }
+                    case StringTag:
+                    {
+                        uint32_t length;
+                        if(size - pos < sizeof(length))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&length, data + pos, sizeof(length));
+                        pos += sizeof(length);
+                        if(size - pos < length)
+                        {
+                            return false;
+                        }
+                        lua_pushlstring(L, data + pos, length);
+                        pos += length;
+                        return true;
+                    }
+                    case TableTag:
+                    {
+                        lua_newtable(L);
+                        lua_pushvalue(L, -1);
+                        lua_rawseti(L, unpacker.seen, int(unpacker.tables++));
+                        while(pos < size && data[pos] != EndTag)
+                        {
+                            if(!unpackValue(L, unpacker, depth + 1))
+                            {
+                                lua_pop(L, 1);
+                                return false;
+                            }
+                            if(!unpackValue(L, unpacker, depth + 1))
+                            {
+                                lua_pop(L, 2);
+                                return false;
+                            }
+                            // A nil or NaN key can't come out of lua_next, so it means corrupt data.
+                            // Checked here, since lua_rawset would raise an error for either.
+                            if(lua_isnil(L, -2) || (lua_type(L, -2) == LUA_TNUMBER && lua_tonumber(L, -2) != lua_tonumber(L, -2)))
+                            {
+                                lua_pop(L, 3);
+                                return false;
+                            }
+                            lua_rawset(L, -3);
+                        }
+                        if(pos >= size)
+                        {
+                            lua_pop(L, 1);
+                            return false;
+                        }
+                        ++pos;
+                        return true;
+                    }
+                    case ReferenceTag:
+                    {
+                        uint32_t number;
+                        if(size - pos < sizeof(number))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&number, data + pos, sizeof(number));
+                        pos += sizeof(number);
+                        // Only tables that have already started unpacking can be referred to.
+                        if(number >= unpacker.tables)
+                        {
+                            return false;
+                        }
+                        lua_rawgeti(L, unpacker.seen, int(number));
+                        return true;
+                    }
+                    case BufferTag:
+                    {
+                        uint32_t length;
+                        if(size - pos < sizeof(length))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&length, data + pos, sizeof(length));
+                        pos += sizeof(length);
+                        if(size - pos < length)
+                        {
+                            return false;
+                        }
+                        pushValue(L, Buffer(data + pos, length));
+                        pos += length;
+                        return true;
+                    }
+                    case AttachmentTag:
+                    {
+                        uint32_t slot;
+                        if(!attachments || size - pos < sizeof(slot))
+                        {
+                            return false;
+                        }
+                        std::memcpy(&slot, data + pos, sizeof(slot));
+                        pos += sizeof(slot);
+                        if(slot >= attachments->size() || !(*attachments)[slot])
+                        {
+                            return false;
+                        }
+                        // Every mention of the same slot unpacks as the same buffer. They're kept at negative
+                        // numbers in seen, out of the way of the tables.
+                        lua_rawgeti(L, unpacker.seen, -1 - int(slot));
+                        if(lua_isnil(L, -1))
+                        {
+                            lua_pop(L, 1);
+                            pushValue(L, Buffer((*attachments)[slot]));
+                            lua_pushvalue(L, -1);
+                            lua_rawseti(L, unpacker.seen, -1 - int(slot));
+                        }
+                        return true;
+                    }
+                    default:
+                        return false;
+                }
+            }
+        }
+
+        void pack(lua_State* L, int index, std::string& out, Attachments* attachments)
+        {
+            index = lua_absindex(L, index);
+            lua_newtable(L);
+            lua_newtable(L);
+            Packer packer = {lua_gettop(L) - 1, lua_gettop(L), 0, 0, out, attachments};
+            packValue(L, index, packer, 0);
+
+            // Nothing raised an error, so the buffers can be handed over now.
+            for(uint32_t i = 1; i <= packer.slots; ++i)
+            {
+                lua_rawgeti(L, packer.buffers, int(i));
+                auto wrapper = (Wrapper<Buffer>*) lua_touserdata(L, -1);
+                attachments->push_back(wrapper->data->release());
+                lua_pop(L, 1);
+            }
+            lua_pop(L, 2);
+        }
+
+        bool unpack(lua_State* L, const char* data, size_t size, size_t& pos, const Attachments* attachments)
+        {
+            lua_newtable(L);
+            Unpacker unpacker = {lua_gettop(L), 0, data, size, pos, attachments};
+            if(!unpackValue(L, unpacker, 0))
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+            lua_remove(L, -2);
+            return true;
+        }
+
+        void serialize(lua_State* L, int index, bool compress, std::string& out)
+        {
+            std::string packed;
+            pack(L, index, packed);
+
+            out.assign(Magic, sizeof(Magic));
+            out.push_back(char(Version));
+            if(compress && !packed.empty())
+            {
+                // The vendored zlib predates compressBound, so this is its documented worst case.
+                uLongf length = uLongf(packed.size() + packed.size() / 1000 + 12);
+                std::vector<uint8_t> compressed(length);
+                if(compress2(compressed.data(), &length, (const Bytef*) packed.data(), uLong(packed.size()), Z_DEFAULT_COMPRESSION) == Z_OK)
+                {
+                    uint32_t original = uint32_t(packed.size());
+                    out.push_back(char(CompressedFlag));
+                    out.append((const char*) &original, sizeof(original));
+                    out.append((const char*) compressed.data(), length);
+                    return;
+                }
+            }
+            out.push_back(0);
+            out.append(packed);
+        }
+
+        bool deserialize(lua_State* L, const char* data, size_t size)
+        {
+            if(size < HeaderSize || std::memcmp(data, Magic, sizeof(Magic)) != 0 || uint8_t(data[sizeof(Magic)]) != Version)
+            {
+                return false;
+            }
+
+            uint8_t flags = uint8_t(data[sizeof(Magic) + 1]);
+            data += HeaderSize;
+            size -= HeaderSize;
+
+            std::vector<char> uncompressed;
+            if(flags & CompressedFlag)
+            {
+                uint32_t original;
+                if(size < sizeof(original))
+                {
+                    return false;
+                }
+                std::memcpy(&original, data, sizeof(original));
+                // zlib can't shrink anything by more than about 1000 to 1, so a bigger claim is corrupt.
+                if(original / 1000 > size)
+                {
+                    return false;
+                }
+
+                uncompressed.resize(original);
+                uLongf length = original;
+                if(uncompress((Bytef*) uncompressed.data(), &length, (const Bytef*) data + sizeof(original), uLong(size - sizeof(original))) != Z_OK
+                    || length != original)
+                {
+                    return false;
+                }
+                data = uncompressed.data();
+                size = uncompressed.size();
+            }
+
+            // The whole string has to be one value, so trailing junk counts as corruption.
+            size_t pos = 0;
+            if(!unpack(L, data, size, pos))
+            {
+                return false;
+            }
+            if(pos != size)
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+            return true;
+        }
+    }
+}
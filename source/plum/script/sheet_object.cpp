@@ -108,6 +108,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
 
@@ -124,15 +125,15 @@ namespace plum
                     int frameHeight = script::get<int>(L, 2);
                     int columns = script::get<int>(L, 3);
                     int rows = script::get<int>(L, 4);
-                    script::push(L, new Sheet(frameWidth, frameHeight, columns, rows), LUA_NOREF);
+                    script::pushValue(L, Sheet(frameWidth, frameHeight, columns, rows));
                     return 1;
                 }
                 else if(script::is<int>(L, 1) && script::is<int>(L, 2) && script::is<Image>(L, 3))
                 {
                     int frameWidth = script::get<int>(L, 1);
                     int frameHeight = script::get<int>(L, 2);
-                    auto img = script::ptr<Image>(L, 3);
-                    script::push(L, new Sheet(frameWidth, frameHeight, img->canvas().getWidth() / frameWidth, img->canvas().getHeight() / frameHeight), LUA_NOREF);
+                    const Image* img = script::ptr<Image>(L, 3);
+                    script::pushValue(L, Sheet(frameWidth, frameHeight, img->canvas().getWidth() / frameWidth, img->canvas().getHeight() / frameHeight));
                     return 1;
                 }
                 else if(script::is<int>(L, 1) && script::is<int>(L, 2) && script::is<Canvas>(L, 3))
@@ -140,7 +141,7 @@ namespace plum
                     int frameWidth = script::get<int>(L, 1);
                     int frameHeight = script::get<int>(L, 2);
                     auto canvas = script::ptr<Canvas>(L, 3);
-                    script::push(L, new Sheet(frameWidth, frameHeight, canvas->getWidth() / frameWidth, canvas->getHeight() / frameHeight), LUA_NOREF);
+                    script::pushValue(L, Sheet(frameWidth, frameHeight, canvas->getWidth() / frameWidth, canvas->getHeight() / frameHeight));
                     return 1;
                 }
                 luaL_error(L, "Attempt to call plum.Sheet constructor with invalid argument types.\r\n"
@@ -3,6 +3,20 @@
 
 namespace plum
 {
+    namespace
+    {
+        // What channel.sends gives back: a table-like view of the channel's send levels, by bus name.
+        struct ChannelSends
+        {
+            Channel* channel;
+
+            explicit ChannelSends(Channel& channel)
+                : channel(&channel)
+            {
+            }
+        };
+    }
+
     namespace script
     {
         template<> const char* meta<Channel>()
@@ -10,8 +24,63 @@ namespace plum
             return "plum.Channel";
         }
 
+        template<> const char* meta<ChannelSends>()
+        {
+            return "plum.ChannelSends";
+        }
+
+        namespace
+        {
+            void initChannelSends(lua_State* L)
+            {
+                luaL_newmetatable(L, meta<ChannelSends>());
+                const luaL_Reg functions[] = {
+                    {"__gc", [](lua_State* L) { return script::wrapped<ChannelSends>(L, 1)->gc(L); }},
+                    {"__tostring", [](lua_State* L) { return script::wrapped<ChannelSends>(L, 1)->tostring(L); }},
+                    {"__index", [](lua_State* L)
+                    {
+                        auto sends = script::ptr<ChannelSends>(L, 1);
+                        if(lua_type(L, 2) != LUA_TSTRING)
+                        {
+                            lua_pushnil(L);
+                            return 1;
+                        }
+                        script::push(L, sends->channel->getSend(lua_tostring(L, 2)));
+                        return 1;
+                    }},
+                    {"__newindex", [](lua_State* L)
+                    {
+                        auto sends = script::ptr<ChannelSends>(L, 1);
+                        auto bus = script::get<const char*>(L, 2);
+                        auto level = script::get<double>(L, 3, 0.0);
+                        sends->channel->setSend(bus, level);
+                        return 0;
+                    }},
+                    {"__pairs", [](lua_State* L)
+                    {
+                        // Iterates over a copy, so setting a send while looping is fine.
+                        auto sends = script::ptr<ChannelSends>(L, 1);
+                        lua_getglobal(L, "next");
+                        lua_newtable(L);
+                        for(const auto& send : sends->channel->getSends())
+                        {
+                            script::push(L, send.second);
+                            lua_setfield(L, -2, send.first.c_str());
+                        }
+                        lua_pushnil(L);
+                        return 3;
+                    }},
+                    {nullptr, nullptr}
+                };
+                luaL_setfuncs(L, functions, 0);
+                lua_pop(L, 1);
+            }
+        }
+
         void initSongObject(lua_State* L)
         {
+            initChannelSends(L);
+
             luaL_newmetatable(L, meta<Channel>());
             // Duplicate the metatable on the stack.
             lua_pushvalue(L, -1);
@@ -53,6 +122,32 @@ namespace plum
                     chan->stop();
                     return 0;
                 }},
+                {"playAt", [](lua_State* L)
+                {
+                    auto chan = script::ptr<Channel>(L, 1);
+                    auto time = script::get<double>(L, 2);
+                    chan->playAt(time);
+                    return 0;
+                }},
+                {"stopAt", [](lua_State* L)
+                {
+                    auto chan = script::ptr<Channel>(L, 1);
+                    auto time = script::get<double>(L, 2);
+                    chan->stopAt(time);
+                    return 0;
+                }},
+                {"get_sends", [](lua_State* L)
+                {
+                    // channel.sends.cave = 0.3 sends some of the channel to the bus named cave.
+                    auto chan = script::ptr<Channel>(L, 1);
+                    auto sends = script::pushValue(L, ChannelSends(*chan));
+
+                    // Keep the channel around as long as its sends are.
+                    lua_pushvalue(L, 1);
+                    sends->setAttribute(L, 1);
+                    lua_pop(L, 1);
+                    return 1;
+                }},
                 {"get_playing", [](lua_State* L)
                 {
                     auto chan = script::ptr<Channel>(L, 1);
@@ -122,6 +217,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
             lua_pop(L, 1);
 
             // Push plum namespace.
@@ -137,10 +233,8 @@ namespace plum
                 Sound sound;
                 script::instance(L).audio().loadSound(filename, sound);
 
-                auto chan = new Channel();
-                script::instance(L).audio().loadChannel(sound, looped, *chan);
-
-                script::push(L, chan, LUA_NOREF);
+                auto chan = script::pushValue<Channel>(L)->data;
+                script::instance(L).audio().loadChannel(sound, looped, true, *chan);
                 return 1;
             });
             lua_settable(L, -3);
@@ -32,19 +32,61 @@ namespace plum
                     auto pan = script::get<double>(L, 3, 0.0);
                     auto pitch = script::get<double>(L, 4, 1.0);
 
-                    auto chan = new Channel();
-                    script::instance(L).audio().loadChannel(*sound, false, *chan);
+                    auto chan = script::pushValue<Channel>(L)->data;
+                    script::instance(L).audio().loadChannel(*sound, false, false, *chan);
                     chan->setVolume(volume);
                     chan->setPan(pan);
                     chan->setPitch(pitch);
                     chan->play();
-                    
-                    script::push(L, chan, LUA_NOREF);
                     return 1;
                 }},
+                {"playAt", [](lua_State* L)
+                {
+                    // sound:playAt(time, volume, pan, pitch) schedules a voice to start at plum.audio.time() seconds.
+                    auto sound = script::ptr<Sound>(L, 1);
+                    auto time = script::get<double>(L, 2);
+                    auto volume = script::get<double>(L, 3, 1.0);
+                    auto pan = script::get<double>(L, 4, 0.0);
+                    auto pitch = script::get<double>(L, 5, 1.0);
+
+                    auto chan = script::pushValue<Channel>(L)->data;
+                    script::instance(L).audio().loadChannel(*sound, false, false, *chan);
+                    chan->setVolume(volume);
+                    chan->setPan(pan);
+                    chan->setPitch(pitch);
+                    chan->playAt(time);
+                    return 1;
+                }},
+                {"get_polyphony", [](lua_State* L)
+                {
+                    auto sound = script::ptr<Sound>(L, 1);
+                    script::push(L, sound->getPolyphony());
+                    return 1;
+                }},
+                {"set_polyphony", [](lua_State* L)
+                {
+                    auto sound = script::ptr<Sound>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    sound->setPolyphony(value);
+                    return 0;
+                }},
+                {"get_priority", [](lua_State* L)
+                {
+                    auto sound = script::ptr<Sound>(L, 1);
+                    script::push(L, sound->getPriority());
+                    return 1;
+                }},
+                {"set_priority", [](lua_State* L)
+                {
+                    auto sound = script::ptr<Sound>(L, 1);
+                    auto value = script::get<int>(L, 2);
+                    sound->setPriority(value);
+                    return 0;
+                }},
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
             lua_pop(L, 1);
 
             // Push plum namespace.
@@ -55,9 +97,8 @@ namespace plum
             lua_pushcfunction(L, [](lua_State* L)
             {
                 auto filename = script::get<const char*>(L, 1);
-                auto sound = new Sound();
+                auto sound = script::pushValue<Sound>(L)->data;
                 script::instance(L).audio().loadSound(filename, *sound);
-                script::push(L, sound, LUA_NOREF);
                 return 1;
             });
             lua_settable(L, -3);
@@ -0,0 +1,210 @@
+#include <vector>
+#include "../core/spatial_hash.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<SpatialHash>()
+        {
+            return "plum.SpatialHash";
+        }
+
+        namespace
+        {
+            // Writes the handles into the table at the given index (or a new one if it's nil), and leaves it on the stack.
+            // Reusing a table from frame to frame saves making garbage for every query.
+            void pushResults(lua_State* L, int index, const std::vector<int>& results)
+            {
+                int previous = 0;
+                if(lua_istable(L, index))
+                {
+                    lua_pushvalue(L, index);
+                    previous = int(lua_rawlen(L, -1));
+                }
+                else
+                {
+                    lua_createtable(L, int(results.size()), 0);
+                }
+
+                int count = int(results.size());
+                for(int i = 0; i < count; ++i)
+                {
+                    lua_pushinteger(L, results[i]);
+                    lua_rawseti(L, -2, i + 1);
+                }
+                // Trim whatever was left over from the last time.
+                for(int i = previous; i > count; --i)
+                {
+                    lua_pushnil(L);
+                    lua_rawseti(L, -2, i);
+                }
+            }
+        }
+
+        void initSpatialHashObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<SpatialHash>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<SpatialHash>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<SpatialHash>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<SpatialHash>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<SpatialHash>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<SpatialHash>(L, 1)->pairs(L); }},
+                {"clear", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    hash->clear();
+                    return 0;
+                }},
+                {"contains", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto handle = script::get<int>(L, 2);
+
+                    script::push(L, hash->contains(handle));
+                    return 1;
+                }},
+                {"get", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto handle = script::get<int>(L, 2);
+                    int x, y, width, height;
+
+                    if(hash->get(handle, x, y, width, height))
+                    {
+                        script::push(L, x);
+                        script::push(L, y);
+                        script::push(L, width);
+                        script::push(L, height);
+                        return 4;
+                    }
+                    return 0;
+                }},
+                {"insert", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto handle = script::get<int>(L, 2);
+                    auto x = script::get<int>(L, 3);
+                    auto y = script::get<int>(L, 4);
+                    auto width = script::get<int>(L, 5);
+                    auto height = script::get<int>(L, 6);
+
+                    hash->insert(handle, x, y, width, height);
+                    return 0;
+                }},
+                {"insertAll", [](lua_State* L)
+                {
+                    // Takes a flat array of handle, x, y, width, height, ... and inserts or moves each box.
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    luaL_checktype(L, 2, LUA_TTABLE);
+
+                    int length = int(lua_rawlen(L, 2));
+                    for(int i = 1; i + 4 <= length; i += 5)
+                    {
+                        int values[5];
+                        for(int j = 0; j < 5; ++j)
+                        {
+                            lua_rawgeti(L, 2, i + j);
+                            values[j] = int(luaL_checkinteger(L, -1));
+                            lua_pop(L, 1);
+                        }
+                        hash->insert(values[0], values[1], values[2], values[3], values[4]);
+                    }
+                    return 0;
+                }},
+                {"remove", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto handle = script::get<int>(L, 2);
+
+                    hash->remove(handle);
+                    return 0;
+                }},
+                {"queryRect", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto x = script::get<int>(L, 2);
+                    auto y = script::get<int>(L, 3);
+                    auto width = script::get<int>(L, 4);
+                    auto height = script::get<int>(L, 5);
+                    std::vector<int> results;
+
+                    hash->queryRect(x, y, width, height, results);
+                    pushResults(L, 6, results);
+                    return 1;
+                }},
+                {"queryPoint", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto x = script::get<int>(L, 2);
+                    auto y = script::get<int>(L, 3);
+                    std::vector<int> results;
+
+                    hash->queryPoint(x, y, results);
+                    pushResults(L, 4, results);
+                    return 1;
+                }},
+                {"queryPairs", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    std::vector<int> results;
+
+                    hash->queryPairs(results);
+                    pushResults(L, 2, results);
+                    return 1;
+                }},
+                {"get_count", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+
+                    script::push(L, int(hash->getCount()));
+                    return 1;
+                }},
+                {"get_cellSize", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+
+                    script::push(L, hash->getCellSize());
+                    return 1;
+                }},
+                {"set_cellSize", [](lua_State* L)
+                {
+                    auto hash = script::ptr<SpatialHash>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    hash->setCellSize(value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.SpatialHash = <function create>
+            script::push(L, "SpatialHash");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto cellSize = script::get<int>(L, 1, 64);
+                auto hash = new SpatialHash(cellSize);
+                script::push(L, hash, LUA_NOREF);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
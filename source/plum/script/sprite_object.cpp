@@ -62,19 +62,18 @@ namespace plum
                     auto index = script::get<int>(L, 2);
 
                     int x, y, frame;
-                    Transform* transform = new Transform();
+                    Transform transform;
 
-                    if(sprite->get(size_t(index - 1), x, y, frame, *transform))
+                    if(sprite->get(size_t(index - 1), x, y, frame, transform))
                     {
                         script::push(L, x);
                         script::push(L, y);
                         script::push(L, frame);
-                        script::push(L, transform, LUA_NOREF);
+                        script::pushValue(L, transform);
                         return 1;
                     }
                     else
                     {
-                        delete transform;
                         return 0;
                     }
                 }},
@@ -142,6 +141,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
             lua_pop(L, 1);
 
             // Push plum namespace.
@@ -0,0 +1,141 @@
+#include "../core/text.h"
+#include "../core/screen.h"
+#include "../core/transform.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<Text>()
+        {
+            return "plum.Text";
+        }
+
+        namespace
+        {
+            enum
+            {
+                FontAttribute = 1
+            };
+        }
+
+        void initTextObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<Text>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<Text>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<Text>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<Text>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<Text>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<Text>(L, 1)->pairs(L); }},
+                {"draw", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+                    auto x = script::get<int>(L, 2);
+                    auto y = script::get<int>(L, 3);
+
+                    auto transform = script::is<std::nullptr_t>(L, 5) ? nullptr : script::ptr<Transform>(L, 4);
+                    auto screen = script::is<std::nullptr_t>(L, 5) ? script::ptr<Screen>(L, 4) : script::ptr<Screen>(L, 5);
+
+                    if(transform)
+                    {
+                        text->draw(x, y, *transform, *screen);
+                    }
+                    else
+                    {
+                        text->draw(x, y, *screen);
+                    }
+
+                    return 0;
+                }},
+                {"get_font", [](lua_State* L)
+                {
+                    script::wrapped<Text>(L, 1)->getAttribute(L, FontAttribute);
+                    return 1;
+                }},
+                {"get_text", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+
+                    script::push(L, text->getText().c_str());
+                    return 1;
+                }},
+                {"get_align", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+
+                    script::push(L, (int) text->getAlign());
+                    return 1;
+                }},
+                {"get_width", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+
+                    script::push(L, text->getWidth());
+                    return 1;
+                }},
+                {"get_height", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+
+                    script::push(L, text->getHeight());
+                    return 1;
+                }},
+                {"set_text", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+                    auto value = script::get<const char*>(L, 2);
+
+                    text->setText(value);
+                    return 0;
+                }},
+                {"set_align", [](lua_State* L)
+                {
+                    auto text = script::ptr<Text>(L, 1);
+                    auto value = script::get<int>(L, 2);
+
+                    text->setAlign((TextAlign) value);
+                    return 0;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.Text = <function create>
+            script::push(L, "Text");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto font = script::ptr<Font>(L, 1);
+                auto str = script::get<const char*>(L, 2, "");
+                auto text = new Text(*font, str);
+                if(!lua_isnoneornil(L, 3))
+                {
+                    text->setAlign((TextAlign) script::get<int>(L, 3));
+                }
+
+                auto wrap = script::push(L, text, LUA_NOREF);
+                // Keep the font alive for as long as the text uses it.
+                lua_pushvalue(L, 1);
+                wrap->setAttribute(L, FontAttribute);
+                lua_pop(L, 1);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -1,5 +1,8 @@
 
+#include <cstring>
+#include <algorithm>
 #include "../core/tilemap.h"
+#include "../core/buffer.h"
 #include "../core/transform.h"
 #include "script.h"
 
@@ -115,6 +118,39 @@ namespace plum
                     m->stamp(tx, ty, dest);
                     return 0;
                 }},
+                {"exportTiles", [](lua_State* L)
+                {
+                    // Copies the tiles out as 32-bit indices, row by row, into the given buffer or a new one.
+                    auto m = script::ptr<Tilemap>(L, 1);
+                    size_t size = m->getWidth() * m->getHeight() * sizeof(uint32_t);
+
+                    if(lua_isnoneornil(L, 2))
+                    {
+                        script::pushValue(L, Buffer(size));
+                    }
+                    else
+                    {
+                        lua_pushvalue(L, 2);
+                    }
+                    auto buffer = script::ptr<Buffer>(L, -1);
+                    if(buffer->getSize() < size && !buffer->resize(size))
+                    {
+                        return luaL_error(L, "Buffer is too small to hold the tilemap.");
+                    }
+
+                    std::memcpy(buffer->getData(), m->getData(), size);
+                    return 1;
+                }},
+                {"importTiles", [](lua_State* L)
+                {
+                    auto m = script::ptr<Tilemap>(L, 1);
+                    auto buffer = script::ptr<Buffer>(L, 2);
+                    size_t size = std::min(size_t(m->getWidth() * m->getHeight()), buffer->getSize() / sizeof(uint32_t)) * sizeof(uint32_t);
+
+                    std::memcpy(m->getData(), buffer->getData(), size);
+                    m->setModified(true);
+                    return 0;
+                }},
                 {"draw", [](lua_State* L)
                 {
                     auto m = script::ptr<Tilemap>(L, 1);
@@ -138,6 +174,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
 
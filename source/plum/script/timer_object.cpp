@@ -21,29 +21,8 @@ namespace plum
             lua_setfield(L, -2, "__index");
             // Put the members into the metatable.
             const luaL_Reg functions[] = {
-                {"__index", [](lua_State* L)
-                {
-                    std::string fieldName(script::get<const char*>(L, 2));
-                    if(luaL_getmetafield(L, 1, std::string("get_" + fieldName).c_str()))
-                    {
-                        lua_pushvalue(L, 1);
-                        lua_call(L, 1, 1);
-                        return 1;
-                    }
-                    return luaL_getmetafield(L, 1, fieldName.c_str());
-                }},
-                {"__newindex", [](lua_State* L)
-                {
-                    std::string fieldName(script::get<const char*>(L, 2));
-                    /* L, 3 is the value to set. */
-                    if(luaL_getmetafield(L, 1, std::string("set_" + fieldName).c_str()))
-                    {
-                        lua_pushvalue(L, 1);
-                        lua_pushvalue(L, 3);
-                        lua_call(L, 2, 0);
-                    }
-                    return 0;
-                }},
+                {"__index", [](lua_State* L) { return script::index(L); }},
+                {"__newindex", [](lua_State* L) { return script::newindex(L); }},
                 {"__tostring", [](lua_State* L)
                 {
                     script::push(L, Meta);
@@ -96,6 +75,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
             lua_pop(L, 1);
 
             // Push plum namespace.
@@ -107,6 +107,7 @@ namespace plum
                 {nullptr, nullptr}
             };
             luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
 
             lua_pop(L, 1);
                 
@@ -117,7 +118,7 @@ namespace plum
             script::push(L, "Transform");
             lua_pushcfunction(L, [](lua_State* L)
             {
-                auto w = script::push(L, new Transform(), LUA_NOREF);
+                script::pushValue<Transform>(L);
                 return 1;
             });
             lua_settable(L, -3);
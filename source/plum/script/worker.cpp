@@ -0,0 +1,221 @@
+#include "worker.h"
+
+namespace plum
+{
+    namespace
+    {
+        // How many instructions a worker runs between checks for whether it was told to stop.
+        const int StopCheckInterval = 1000;
+
+        // Its address identifies the worker in its state's registry.
+        const char WorkerKey = 0;
+    }
+
+    MessageQueue::MessageQueue()
+        : head(new Node()), tail(head), sleeping(false)
+    {
+    }
+
+    MessageQueue::~MessageQueue()
+    {
+        while(head)
+        {
+            Node* next = head->next.load();
+            delete head;
+            head = next;
+        }
+    }
+
+    void MessageQueue::push(Message&& message)
+    {
+        Node* node = new Node();
+        node->message = std::move(message);
+        tail->next.store(node);
+        tail = node;
+
+        if(sleeping.load())
+        {
+            notify();
+        }
+    }
+
+    bool MessageQueue::pop(Message& message)
+    {
+        Node* next = head->next.load();
+        if(!next)
+        {
+            return false;
+        }
+
+        // The popped node becomes the new placeholder.
+        message = std::move(next->message);
+        delete head;
+        head = next;
+        return true;
+    }
+
+    bool MessageQueue::wait(const std::atomic<bool>& cancel)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // Either the producer sees this flag and signals, or this sees the producer's message.
+        sleeping.store(true);
+        while(!head->next.load() && !cancel.load())
+        {
+            signal.wait(lock);
+        }
+        sleeping.store(false);
+        return head->next.load() != nullptr;
+    }
+
+    void MessageQueue::notify()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        signal.notify_all();
+    }
+
+    Worker::Worker(const std::string& filename)
+        : filename(filename), stopping(false), finished(false)
+    {
+        thread = std::thread([this](){ run(); });
+    }
+
+    Worker::~Worker()
+    {
+        terminate();
+        if(thread.joinable())
+        {
+            thread.join();
+        }
+    }
+
+    bool Worker::isRunning() const
+    {
+        return !finished.load();
+    }
+
+    const std::string& Worker::getError() const
+    {
+        return error;
+    }
+
+    void Worker::send(Message&& message)
+    {
+        inbox.push(std::move(message));
+    }
+
+    bool Worker::receive(Message& message, bool wait)
+    {
+        while(!outbox.pop(message))
+        {
+            if(!wait || finished.load())
+            {
+                // Anything sent just before finishing is still worth picking up.
+                return outbox.pop(message);
+            }
+            outbox.wait(finished);
+        }
+        return true;
+    }
+
+    void Worker::terminate()
+    {
+        stopping.store(true);
+        inbox.notify();
+    }
+
+    void Worker::run()
+    {
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+        luaL_dostring(L, "package.path = package.path .. ';?.lua;?/init.lua;?\\\\init.lua'");
+        initLibrary(L, this);
+
+        lua_pushlightuserdata(L, this);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, &WorkerKey);
+        lua_sethook(L, [](lua_State* L, lua_Debug* ar)
+        {
+            lua_rawgetp(L, LUA_REGISTRYINDEX, &WorkerKey);
+            auto worker = (Worker*) lua_touserdata(L, -1);
+            lua_pop(L, 1);
+            if(worker->stopping.load())
+            {
+                luaL_error(L, "worker terminated");
+            }
+        }, LUA_MASKCOUNT, StopCheckInterval);
+
+        int status = script::loadFile(L, filename, false);
+        if(status == LUA_OK)
+        {
+            status = lua_pcall(L, 0, 0, 0);
+        }
+        if(status != LUA_OK && !stopping.load())
+        {
+            const char* message = lua_tostring(L, -1);
+            error = message ? message : "(error object is not a string)";
+        }
+        lua_close(L);
+
+        finished.store(true);
+        outbox.notify();
+    }
+
+    void Worker::initLibrary(lua_State* L, Worker* worker)
+    {
+        // plum = { worker = { ... } }
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setglobal(L, "plum");
+
+        lua_newtable(L);
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, "worker");
+
+        // Each function gets the worker as an upvalue.
+        const luaL_Reg functions[] = {
+            {"send", [](lua_State* L)
+            {
+                auto worker = (Worker*) lua_touserdata(L, lua_upvalueindex(1));
+                Message message;
+
+                script::pack(L, 1, message.data, &message.attachments);
+                worker->outbox.push(std::move(message));
+                return 0;
+            }},
+            {"receive", [](lua_State* L)
+            {
+                auto worker = (Worker*) lua_touserdata(L, lua_upvalueindex(1));
+                auto wait = lua_toboolean(L, 1) != 0;
+                Message message;
+
+                while(!worker->inbox.pop(message))
+                {
+                    if(worker->stopping.load())
+                    {
+                        return luaL_error(L, "worker terminated");
+                    }
+                    if(!wait)
+                    {
+                        return 0;
+                    }
+                    worker->inbox.wait(worker->stopping);
+                }
+
+                size_t pos = 0;
+                if(!script::unpack(L, message.data.data(), message.data.size(), pos, &message.attachments))
+                {
+                    return luaL_error(L, "received a malformed message");
+                }
+                return 1;
+            }},
+            {nullptr, nullptr}
+        };
+        lua_pushlightuserdata(L, worker);
+        luaL_setfuncs(L, functions, 1);
+
+        // Pop worker and plum.
+        lua_pop(L, 2);
+
+        // Buffers are plain memory, so they're safe to have here, and let big messages be moved instead of copied.
+        script::initBufferObject(L);
+    }
+}
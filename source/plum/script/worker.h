@@ -0,0 +1,97 @@
+#ifndef PLUM_WORKER_H
+#define PLUM_WORKER_H
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <condition_variable>
+#include "script.h"
+
+namespace plum
+{
+    // A packed value, along with any buffers that were moved out of the sender rather than copied.
+    struct Message
+    {
+        std::string data;
+        script::Attachments attachments;
+    };
+
+    // A queue of packed messages with one producer thread and one consumer thread.
+    // Pushing and popping never lock. The lock is only used to put an idle consumer to sleep.
+    class MessageQueue
+    {
+        public:
+            MessageQueue();
+            ~MessageQueue();
+
+            void push(Message&& message);
+            bool pop(Message& message);
+            // Blocks until a message arrives or cancel is set. Returns false if cancelled.
+            bool wait(const std::atomic<bool>& cancel);
+            // Wakes a waiting consumer, so it can notice cancellation.
+            void notify();
+
+        private:
+            struct Node
+            {
+                Message message;
+                std::atomic<Node*> next;
+
+                Node()
+                    : next(nullptr)
+                {
+                }
+            };
+
+            // The consumer owns the head, which is always an already-consumed placeholder node.
+            // The producer owns the tail.
+            Node* head;
+            Node* tail;
+
+            std::atomic<bool> sleeping;
+            std::mutex mutex;
+            std::condition_variable signal;
+
+            MessageQueue(const MessageQueue&);
+            void operator =(const MessageQueue&);
+    };
+
+    // Runs a script on its own thread, with its own Lua state.
+    // It only gets the standard Lua libraries and plum.worker, since the rest of plum isn't thread-safe.
+    class Worker
+    {
+        public:
+            Worker(const std::string& filename);
+            // Stops the script at its next opportunity and waits for the thread to finish.
+            ~Worker();
+
+            bool isRunning() const;
+            // The error that stopped the script, if any. Only valid once the worker is no longer running.
+            const std::string& getError() const;
+
+            // Sends a packed message to the worker.
+            void send(Message&& message);
+            // Takes the next packed message from the worker, if there is one. If wait is set,
+            // blocks until a message arrives or the worker finishes.
+            bool receive(Message& message, bool wait);
+            void terminate();
+
+        private:
+            std::string filename;
+            std::string error;
+            MessageQueue inbox;
+            MessageQueue outbox;
+            std::atomic<bool> stopping;
+            std::atomic<bool> finished;
+            std::thread thread;
+
+            void run();
+            static void initLibrary(lua_State* L, Worker* worker);
+
+            Worker(const Worker&);
+            void operator =(const Worker&);
+    };
+}
+
+#endif
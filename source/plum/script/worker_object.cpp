@@ -0,0 +1,103 @@
+#include "worker.h"
+#include "script.h"
+
+namespace plum
+{
+    namespace script
+    {
+        template<> const char* meta<Worker>()
+        {
+            return "plum.Worker";
+        }
+
+        void initWorkerObject(lua_State* L)
+        {
+            luaL_newmetatable(L, meta<Worker>());
+            // Duplicate the metatable on the stack.
+            lua_pushvalue(L, -1);
+            // metatable.__index = metatable
+            lua_setfield(L, -2, "__index");
+
+            // Put the members into the metatable.
+            const luaL_Reg functions[] = {
+                {"__gc", [](lua_State* L) { return script::wrapped<Worker>(L, 1)->gc(L); }},
+                {"__index", [](lua_State* L) { return script::wrapped<Worker>(L, 1)->index(L); }},
+                {"__newindex", [](lua_State* L) { return script::wrapped<Worker>(L, 1)->newindex(L); }},
+                {"__tostring", [](lua_State* L) { return script::wrapped<Worker>(L, 1)->tostring(L); }},
+                {"__pairs", [](lua_State* L) { return script::wrapped<Worker>(L, 1)->pairs(L); }},
+                {"send", [](lua_State* L)
+                {
+                    auto worker = script::ptr<Worker>(L, 1);
+                    Message message;
+
+                    script::pack(L, 2, message.data, &message.attachments);
+                    worker->send(std::move(message));
+                    return 0;
+                }},
+                {"receive", [](lua_State* L)
+                {
+                    auto worker = script::ptr<Worker>(L, 1);
+                    auto wait = lua_toboolean(L, 2) != 0;
+                    Message message;
+
+                    if(!worker->receive(message, wait))
+                    {
+                        return 0;
+                    }
+
+                    size_t pos = 0;
+                    if(!script::unpack(L, message.data.data(), message.data.size(), pos, &message.attachments))
+                    {
+                        return luaL_error(L, "received a malformed message");
+                    }
+                    return 1;
+                }},
+                {"terminate", [](lua_State* L)
+                {
+                    auto worker = script::ptr<Worker>(L, 1);
+                    worker->terminate();
+                    return 0;
+                }},
+                {"get_running", [](lua_State* L)
+                {
+                    auto worker = script::ptr<Worker>(L, 1);
+
+                    script::push(L, worker->isRunning());
+                    return 1;
+                }},
+                {"get_error", [](lua_State* L)
+                {
+                    auto worker = script::ptr<Worker>(L, 1);
+
+                    if(worker->isRunning() || worker->getError().empty())
+                    {
+                        return 0;
+                    }
+                    script::push(L, worker->getError().c_str());
+                    return 1;
+                }},
+                {nullptr, nullptr}
+            };
+            luaL_setfuncs(L, functions, 0);
+            script::initProperties(L);
+            lua_pop(L, 1);
+
+            // Push plum namespace.
+            lua_getglobal(L, "plum");
+
+            // plum.Worker = <function create>
+            script::push(L, "Worker");
+            lua_pushcfunction(L, [](lua_State* L)
+            {
+                auto filename = script::get<const char*>(L, 1);
+                auto worker = new Worker(filename);
+                script::push(L, worker, LUA_NOREF);
+                return 1;
+            });
+            lua_settable(L, -3);
+
+            // Pop plum namespace.
+            lua_pop(L, 1);
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include <plaid/audio.h>
+#include <plaid/audio/effects.h>
+#include <plaid/audio/implementation.h>
+#include "check.h"
+
+namespace plaidgadget
+{
+    // Only headless audio is tested, so there's no device to open.
+    AudioImp* Implementation_Audio(Audio& audio, AudioScheduler& scheduler)
+    {
+        return nullptr;
+    }
+}
+
+namespace
+{
+    // A single full-scale sample at the very start, then silence.
+    class Impulse : public plaidgadget::AudioStream
+    {
+        public:
+            Impulse(const plaidgadget::AudioFormat& format)
+                : output(format), position(0)
+            {
+            }
+
+        protected:
+            virtual plaidgadget::AudioFormat format()
+            {
+                return output;
+            }
+
+            virtual void tick(plaidgadget::Uint64 frame)
+            {
+            }
+
+            virtual bool exhausted()
+            {
+                return false;
+            }
+
+            virtual void pull(plaidgadget::AudioChunk& chunk)
+            {
+                chunk.silence();
+                if(position == 0)
+                {
+                    for(plaidgadget::Uint32 i = 0; i < chunk.channels(); ++i)
+                    {
+                        chunk.start(i)[0] = 1 << 23;
+                    }
+                }
+                position += chunk.length();
+            }
+
+        private:
+            plaidgadget::AudioFormat output;
+            plaidgadget::Uint64 position;
+    };
+
+    // Where the impulse comes out of a Pitch at rate 1, or -1 if it never does.
+    int findImpulse(plaidgadget::Audio& audio, plaidgadget::Uint32 algorithm)
+    {
+        const plaidgadget::Uint32 ChunkLength = 50;
+        plaidgadget::AudioFormat format(audio.format());
+        format.channels = 1;
+
+        plaidgadget::Sound pitch(new plaidgadget::Pitch(plaidgadget::Signal(plaidgadget::Sound(new Impulse(format))), 1.0f, algorithm));
+        plaidgadget::Signal signal(pitch);
+
+        plaidgadget::Sint32 samples[ChunkLength];
+        plaidgadget::Sint32* data[PG_MAX_CHANNELS] = {samples};
+        for(plaidgadget::Uint64 frame = 1; frame <= 4; ++frame)
+        {
+            signal.tick(frame);
+            plaidgadget::AudioChunk chunk(audio, format, data, ChunkLength, frame, 0.0f, 1.0f);
+            signal.pull(chunk);
+            for(plaidgadget::Uint32 i = 0; i < ChunkLength; ++i)
+            {
+                if(samples[i] > (1 << 22))
+                {
+                    return int((frame - 1) * ChunkLength + i);
+                }
+            }
+        }
+        return -1;
+    }
+
+    void testPitchDelay()
+    {
+        plaidgadget::Audio audio(true);
+        const int delay = int(plaidgadget::Pitch::DELAY);
+        CHECK(findImpulse(audio, plaidgadget::Pitch::LINEAR) == delay);
+        CHECK(findImpulse(audio, plaidgadget::Pitch::HERMITE) == delay);
+        CHECK(findImpulse(audio, plaidgadget::Pitch::SINC_8) == delay);
+        CHECK(findImpulse(audio, plaidgadget::Pitch::SINC_32) == delay);
+    }
+
+    void testFramesAreClamped()
+    {
+        plaidgadget::AudioSettings settings;
+        settings.frames = 100000;
+        plaidgadget::Audio audio(true, settings);
+        CHECK(audio.settings().frames == plaidgadget::AudioSettings::MAX_FRAMES);
+
+        settings.frames = 256;
+        plaidgadget::Audio small(true, settings);
+        CHECK(small.settings().frames == 256);
+    }
+}
+
+int main()
+{
+    testFramesAreClamped();
+    testPitchDelay();
+    return plum::tests::finish("audio_test");
+}
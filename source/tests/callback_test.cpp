@@ -0,0 +1,75 @@
+#include <string>
+#include "../plum/script/script.h"
+#include "check.h"
+
+namespace
+{
+    int raise(lua_State* L)
+    {
+        plum::script::raiseCallbackError(L);
+        return 0;
+    }
+
+    // Counts how many times it's been destroyed, to show a frame was left normally.
+    struct Guard
+    {
+        int& destroyed;
+
+        ~Guard()
+        {
+            ++destroyed;
+        }
+    };
+
+    // Stands in for an engine update hook that runs a failing callback.
+    // An unprotected call would jump straight past the rest of this, and past the guard's destructor.
+    bool runHook(lua_State* L, int& destroyed)
+    {
+        Guard guard = {destroyed};
+        luaL_loadstring(L, "error('first', 0)");
+        return plum::script::callback(L, 0);
+    }
+
+    void testErrorIsHeldUntilRaised()
+    {
+        lua_State* L = luaL_newstate();
+        luaL_openlibs(L);
+        int top = lua_gettop(L);
+
+        int destroyed = 0;
+        CHECK(!runHook(L, destroyed));
+        CHECK(destroyed == 1);
+        CHECK(lua_gettop(L) == top);
+        CHECK(plum::script::hasCallbackError(L));
+
+        // Later errors don't replace the one that came first.
+        luaL_loadstring(L, "error('second', 0)");
+        CHECK(!plum::script::callback(L, 0));
+
+        // Callbacks after a failure still run.
+        luaL_loadstring(L, "return ...");
+        lua_pushinteger(L, 7);
+        CHECK(plum::script::callback(L, 1, 1));
+        CHECK(lua_tointeger(L, -1) == 7);
+        lua_pop(L, 1);
+
+        lua_pushcfunction(L, raise);
+        CHECK(lua_pcall(L, 0, 0, 0) != LUA_OK);
+        CHECK(std::string(lua_tostring(L, -1)) == "first");
+        lua_pop(L, 1);
+        CHECK(!plum::script::hasCallbackError(L));
+
+        // With nothing held, raising does nothing.
+        lua_pushcfunction(L, raise);
+        CHECK(lua_pcall(L, 0, 0, 0) == LUA_OK);
+        CHECK(lua_gettop(L) == top);
+
+        lua_close(L);
+    }
+}
+
+int main()
+{
+    testErrorIsHeldUntilRaised();
+    return plum::tests::finish("callback_test");
+}
@@ -0,0 +1,37 @@
+#ifndef PLUM_TESTS_CHECK_H
+#define PLUM_TESTS_CHECK_H
+
+#include <cstdio>
+
+namespace plum
+{
+    namespace tests
+    {
+        // Counts the checks that have failed, so main can report them in its exit code.
+        inline int& failures()
+        {
+            static int count = 0;
+            return count;
+        }
+
+        inline void check(bool passed, const char* expression, const char* file, int line)
+        {
+            if(!passed)
+            {
+                std::printf("%s:%d: check failed: %s\n", file, line, expression);
+                ++failures();
+            }
+        }
+
+        inline int finish(const char* name)
+        {
+            std::printf("%s: %s\n", name, failures() ? "FAILED" : "passed");
+            return failures() ? 1 : 0;
+        }
+    }
+}
+
+// A macro, so that a failure can say where it was and what it checked.
+#define CHECK(condition) plum::tests::check((condition), #condition, __FILE__, __LINE__)
+
+#endif
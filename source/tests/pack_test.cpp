@@ -0,0 +1,52 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../plum/core/pack.h"
+#include "check.h"
+
+namespace
+{
+    bool writeFile(const std::string& filename, const std::string& text)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if(!file)
+        {
+            return false;
+        }
+        bool success = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+        std::fclose(file);
+        return success;
+    }
+
+    void testDuplicateNamesAreStoredOnce()
+    {
+        const std::string loose("obj/tests/pack_test.txt");
+        const std::string filename("obj/tests/pack_test.pak");
+        CHECK(writeFile(loose, "hello"));
+
+        std::vector<std::string> names;
+        names.push_back(loose);
+        names.push_back("./" + loose);
+        names.push_back(loose);
+        CHECK(plum::buildPack(filename, names, false));
+
+        plum::Pack pack(filename);
+        CHECK(pack.isActive());
+        CHECK(pack.getCount() == 1);
+
+        plum::PackEntry entry;
+        std::vector<uint8_t> data;
+        CHECK(pack.find(loose, entry));
+        CHECK(pack.read(entry, data));
+        CHECK(std::string(data.begin(), data.end()) == "hello");
+
+        std::remove(loose.c_str());
+        std::remove(filename.c_str());
+    }
+}
+
+int main()
+{
+    testDuplicateNamesAreStoredOnce();
+    return plum::tests::finish("pack_test");
+}
@@ -0,0 +1,190 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+#include "../plum/script/script.h"
+#include "check.h"
+
+namespace plum
+{
+    namespace script
+    {
+        // The test only needs buffers to be recognised and collected, not the rest of their methods.
+        template<> const char* meta<Buffer>()
+        {
+            return "plum.Buffer";
+        }
+    }
+}
+
+namespace
+{
+    void initBuffer(lua_State* L)
+    {
+        luaL_newmetatable(L, plum::script::meta<plum::Buffer>());
+        lua_pushcfunction(L, [](lua_State* L)
+        {
+            return ((plum::script::Wrapper<plum::Buffer>*) lua_touserdata(L, 1))->gc(L);
+        });
+        lua_setfield(L, -2, "__gc");
+        lua_pop(L, 1);
+    }
+
+    plum::Buffer& pushBuffer(lua_State* L, const char* text)
+    {
+        return *plum::script::pushValue(L, plum::Buffer(text, std::strlen(text)))->data;
+    }
+
+    // Packs the value at index 1 into the attachments passed as an upvalue, so errors can be caught.
+    int packAttached(lua_State* L)
+    {
+        auto attachments = (plum::script::Attachments*) lua_touserdata(L, lua_upvalueindex(1));
+        std::string out;
+        plum::script::pack(L, 1, out, attachments);
+        lua_pushlstring(L, out.data(), out.size());
+        return 1;
+    }
+
+    void testFailedPackKeepsBuffers()
+    {
+        lua_State* L = luaL_newstate();
+        initBuffer(L);
+
+        plum::script::Attachments attachments;
+        lua_pushlightuserdata(L, &attachments);
+        lua_pushcclosure(L, packAttached, 1);
+
+        // The buffer is packed before the function, which can't be.
+        lua_createtable(L, 2, 0);
+        plum::Buffer& buffer(pushBuffer(L, "hello"));
+        lua_rawseti(L, -2, 1);
+        lua_pushcfunction(L, packAttached);
+        lua_rawseti(L, -2, 2);
+
+        CHECK(lua_pcall(L, 1, 1, 0) != LUA_OK);
+        CHECK(attachments.empty());
+        CHECK(buffer.getSize() == 5);
+
+        lua_close(L);
+    }
+
+    void testSharedBufferAttachesOnce()
+    {
+        lua_State* L = luaL_newstate();
+        initBuffer(L);
+
+        plum::script::Attachments attachments;
+        lua_pushlightuserdata(L, &attachments);
+        lua_pushcclosure(L, packAttached, 1);
+
+        lua_newtable(L);
+        plum::Buffer& buffer(pushBuffer(L, "shared"));
+        lua_pushvalue(L, -1);
+        lua_setfield(L, -3, "a");
+        lua_setfield(L, -2, "b");
+
+        CHECK(lua_pcall(L, 1, 1, 0) == LUA_OK);
+        CHECK(attachments.size() == 1);
+        CHECK(attachments.size() == 1 && attachments[0]->size() == 6);
+        CHECK(buffer.getSize() == 0);
+
+        size_t size = 0;
+        const char* data = lua_tolstring(L, -1, &size);
+        size_t pos = 0;
+        CHECK(plum::script::unpack(L, data, size, pos, &attachments));
+        lua_getfield(L, -1, "a");
+        lua_getfield(L, -2, "b");
+        CHECK(lua_rawequal(L, -1, -2));
+        auto wrapper = (plum::script::Wrapper<plum::Buffer>*) luaL_testudata(L, -1, plum::script::meta<plum::Buffer>());
+        CHECK(wrapper && std::string((const char*) wrapper->data->getData(), wrapper->data->getSize()) == "shared");
+
+        lua_close(L);
+    }
+
+    // Packs and unpacks a single number, returning what came back.
+    double roundTrip(lua_State* L, double value)
+    {
+        std::string out;
+        lua_pushnumber(L, value);
+        plum::script::pack(L, -1, out);
+        lua_pop(L, 1);
+
+        size_t pos = 0;
+        CHECK(plum::script::unpack(L, out.data(), out.size(), pos));
+        CHECK(pos == out.size());
+        double result = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+        return result;
+    }
+
+    void testSpecialNumbersRoundTrip()
+    {
+        lua_State* L = luaL_newstate();
+
+        CHECK(roundTrip(L, 42.0) == 42.0);
+        CHECK(roundTrip(L, -2147483648.0) == -2147483648.0);
+        CHECK(roundTrip(L, 2147483648.0) == 2147483648.0);
+        CHECK(roundTrip(L, -2147483649.0) == -2147483649.0);
+        CHECK(roundTrip(L, 1e300) == 1e300);
+        CHECK(roundTrip(L, 0.5) == 0.5);
+        CHECK(roundTrip(L, HUGE_VAL) == HUGE_VAL);
+        CHECK(roundTrip(L, -HUGE_VAL) == -HUGE_VAL);
+        CHECK(std::isnan(roundTrip(L, NAN)));
+        CHECK(std::signbit(roundTrip(L, -0.0)));
+
+        lua_close(L);
+    }
+
+    void testBadKeysFailCleanly()
+    {
+        lua_State* L = luaL_newstate();
+        int top = lua_gettop(L);
+
+        double nan = NAN;
+        const char* keys[] = {"n", "d"};
+        for(auto key : keys)
+        {
+            // A table with one entry, whose key is nil or NaN, and whose value is true.
+            std::string data("T");
+            data += key;
+            if(key[0] == 'd')
+            {
+                data.append((const char*) &nan, sizeof(nan));
+            }
+            data += "te";
+
+            size_t pos = 0;
+            CHECK(!plum::script::unpack(L, data.data(), data.size(), pos));
+            CHECK(lua_gettop(L) == top);
+        }
+
+        lua_close(L);
+    }
+
+    void testOutOfRangeValuesWrap()
+    {
+        plum::Buffer buffer(4);
+        double value = -1.0;
+
+        buffer.set(0, plum::DataType::Unsigned32, plum::ByteOrder::Little, 4294967297.0);
+        CHECK(buffer.get(0, plum::DataType::Unsigned32, plum::ByteOrder::Little, value) && value == 1.0);
+
+        buffer.set(0, plum::DataType::Unsigned32, plum::ByteOrder::Little, -1.0);
+        CHECK(buffer.get(0, plum::DataType::Unsigned32, plum::ByteOrder::Little, value) && value == 4294967295.0);
+
+        buffer.set(0, plum::DataType::Int32, plum::ByteOrder::Little, 1e300);
+        CHECK(buffer.get(0, plum::DataType::Int32, plum::ByteOrder::Little, value) && value == 0.0);
+
+        buffer.set(0, plum::DataType::Int32, plum::ByteOrder::Little, NAN);
+        CHECK(buffer.get(0, plum::DataType::Int32, plum::ByteOrder::Little, value) && value == 0.0);
+    }
+}
+
+int main()
+{
+    testFailedPackKeepsBuffers();
+    testSharedBufferAttachesOnce();
+    testSpecialNumbersRoundTrip();
+    testBadKeysFailCleanly();
+    testOutOfRangeValuesWrap();
+    return plum::tests::finish("serialize_test");
+}